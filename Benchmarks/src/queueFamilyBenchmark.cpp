@@ -0,0 +1,68 @@
+#include "queue_families.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Times solveQueueFamilies() on tables with many families. The random tables stand in for
+// real devices, the adversarial ones have no solution and every graphics family looks alike.
+
+namespace
+{
+    constexpr VkQueueFlags G = VK_QUEUE_GRAPHICS_BIT;
+    constexpr VkQueueFlags C = VK_QUEUE_COMPUTE_BIT;
+    constexpr VkQueueFlags T = VK_QUEUE_TRANSFER_BIT;
+
+    void run(const std::string &name, const std::vector<QueueFamilyInfo> &table)
+    {
+        QueueFamilySolveStats stats = {};
+        bool complete = solveQueueFamilies(table, &stats).isComplete();
+
+        uint32_t iterations = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::duration::zero();
+        while (elapsed < std::chrono::milliseconds(200))
+        {
+            solveQueueFamilies(table);
+            iterations++;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+
+        double microseconds = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+        std::printf("%-40s %10.2f us  visited %8u  memo hits %8u  %s\n",
+                    name.c_str(), microseconds, stats.visited, stats.memoHits, complete ? "solved" : "unsolved");
+    }
+
+    std::vector<QueueFamilyInfo> randomTable(uint32_t familyCount, std::mt19937 &random)
+    {
+        std::vector<QueueFamilyInfo> table(familyCount);
+        for (auto &family : table)
+            family = {static_cast<VkQueueFlags>(random() % 8), static_cast<uint32_t>(random() % 4), random() % 3 == 0};
+        return table;
+    }
+
+    // Family 0 is the only compute and present family, every other family is graphics and
+    // transfer with a single queue
+    std::vector<QueueFamilyInfo> adversarialTable(uint32_t familyCount, uint32_t presentQueues)
+    {
+        std::vector<QueueFamilyInfo> table(familyCount, {G | T, 1, false});
+        table[0] = {C | T, presentQueues, true};
+        return table;
+    }
+}
+
+int main()
+{
+    std::mt19937 random(7);
+
+    for (uint32_t familyCount : {64u, 256u, 1024u, 4096u})
+        run("random, " + std::to_string(familyCount) + " families", randomTable(familyCount, random));
+
+    for (uint32_t familyCount : {256u, 1024u, 4096u})
+    {
+        run("single compute family, " + std::to_string(familyCount) + " families", adversarialTable(familyCount, 1));
+        run("present without queues, " + std::to_string(familyCount) + " families", adversarialTable(familyCount, 0));
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef COMMAND_ENCODER_HPP
+#define COMMAND_ENCODER_HPP
+#include "Engine.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace Engine {
+
+    // Records binds and dynamic state into a command buffer and shadows what is bound, calls
+    // that would set the state it already has are skipped. Pipeline, descriptor set and
+    // dynamic state outlive render passes in a primary command buffer, so the shadow is only
+    // reset by begin(). Commands recorded around the encoder that bind or set state have to
+    // be followed by invalidate(). Every graphics pipeline is expected to take viewport and
+    // scissor as dynamic state, a pipeline with static ones would overwrite them unseen.
+    class CommandEncoder {
+    public:
+        enum Command : uint32_t {
+            BindPipeline,
+            SetViewport,
+            SetScissor,
+            BindVertexBuffer,
+            BindIndexBuffer,
+            BindDescriptorSet,
+            CommandCount
+        };
+
+        static constexpr uint32_t maxVertexBindings = 4;
+        static constexpr uint32_t maxDescriptorSets = 4;
+
+        // Starts shadowing a command buffer that is recording, nothing is known to be bound
+        void begin(VkCommandBuffer commandBuffer);
+
+        // Forgets the shadowed state, the next call of every kind is issued
+        void invalidate();
+
+        VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+
+        void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+        void setViewport(const VkViewport &viewport);
+        void setScissor(const VkRect2D &scissor);
+        void bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset);
+        void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+        // Without dynamic offsets. A set bound with another layout than the shadowed one may
+        // disturb the sets above it, those are issued again on their next bind.
+        void bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet);
+
+        uint64_t getIssued() const;
+        uint64_t getElided() const;
+        void printStatistics() const;
+
+    private:
+        struct BindPointState {
+            VkPipeline pipeline;
+            std::array<VkPipelineLayout, maxDescriptorSets> layouts;
+            std::array<VkDescriptorSet, maxDescriptorSets> descriptorSets;
+        };
+
+        BindPointState &getBindPointState(VkPipelineBindPoint bindPoint);
+        bool elide(Command command, bool redundant);
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+        BindPointState graphics = {};
+        BindPointState compute = {};
+
+        bool viewportSet = false;
+        VkViewport viewport = {};
+        bool scissorSet = false;
+        VkRect2D scissor = {};
+
+        std::array<VkBuffer, maxVertexBindings> vertexBuffers = {};
+        std::array<VkDeviceSize, maxVertexBindings> vertexOffsets = {};
+
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize indexOffset = 0;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+
+        std::array<uint64_t, CommandCount> issued = {};
+        std::array<uint64_t, CommandCount> elided = {};
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "CommandEncoder.hpp"
+#include <iostream>
+#include <stdexcept>
+
+namespace Engine {
+
+    namespace {
+        const char *commandNames[CommandEncoder::CommandCount] = {
+            "pipeline", "viewport", "scissor", "vertex buffer", "index buffer", "descriptor set"
+        };
+    }
+
+    void CommandEncoder::begin(VkCommandBuffer _commandBuffer) {
+        commandBuffer = _commandBuffer;
+        invalidate();
+    }
+
+    void CommandEncoder::invalidate() {
+        graphics = {};
+        compute = {};
+
+        viewportSet = false;
+        scissorSet = false;
+
+        vertexBuffers.fill(VK_NULL_HANDLE);
+        vertexOffsets.fill(0);
+
+        indexBuffer = VK_NULL_HANDLE;
+    }
+
+    void CommandEncoder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+        BindPointState &state = getBindPointState(bindPoint);
+        if (elide(BindPipeline, state.pipeline == pipeline))
+            return;
+
+        vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+        state.pipeline = pipeline;
+    }
+
+    void CommandEncoder::setViewport(const VkViewport &_viewport) {
+        bool redundant = viewportSet && viewport.x == _viewport.x && viewport.y == _viewport.y && viewport.width == _viewport.width &&
+                         viewport.height == _viewport.height && viewport.minDepth == _viewport.minDepth && viewport.maxDepth == _viewport.maxDepth;
+        if (elide(SetViewport, redundant))
+            return;
+
+        vkCmdSetViewport(commandBuffer, 0, 1, &_viewport);
+        viewport = _viewport;
+        viewportSet = true;
+    }
+
+    void CommandEncoder::setScissor(const VkRect2D &_scissor) {
+        bool redundant = scissorSet && scissor.offset.x == _scissor.offset.x && scissor.offset.y == _scissor.offset.y &&
+                         scissor.extent.width == _scissor.extent.width && scissor.extent.height == _scissor.extent.height;
+        if (elide(SetScissor, redundant))
+            return;
+
+        vkCmdSetScissor(commandBuffer, 0, 1, &_scissor);
+        scissor = _scissor;
+        scissorSet = true;
+    }
+
+    void CommandEncoder::bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset) {
+        if (binding >= maxVertexBindings)
+            throw std::runtime_error("failed to bind vertex buffer, binding is above the shadowed bindings!");
+
+        if (elide(BindVertexBuffer, vertexBuffers[binding] == buffer && vertexOffsets[binding] == offset))
+            return;
+
+        vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &offset);
+        vertexBuffers[binding] = buffer;
+        vertexOffsets[binding] = offset;
+    }
+
+    void CommandEncoder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType _indexType) {
+        if (elide(BindIndexBuffer, indexBuffer == buffer && indexOffset == offset && indexType == _indexType))
+            return;
+
+        vkCmdBindIndexBuffer(commandBuffer, buffer, offset, _indexType);
+        indexBuffer = buffer;
+        indexOffset = offset;
+        indexType = _indexType;
+    }
+
+    void CommandEncoder::bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, VkDescriptorSet descriptorSet) {
+        if (set >= maxDescriptorSets)
+            throw std::runtime_error("failed to bind descriptor set, set index is above the shadowed sets!");
+
+        BindPointState &state = getBindPointState(bindPoint);
+        if (elide(BindDescriptorSet, state.layouts[set] == layout && state.descriptorSets[set] == descriptorSet))
+            return;
+
+        vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, set, 1, &descriptorSet, 0, nullptr);
+
+        // Layout compatibility isn't tracked, another layout counts as disturbing every set above
+        if (state.layouts[set] != layout) {
+            for (uint32_t i = set + 1; i < maxDescriptorSets; i++) {
+                state.layouts[i] = VK_NULL_HANDLE;
+                state.descriptorSets[i] = VK_NULL_HANDLE;
+            }
+        }
+
+        state.layouts[set] = layout;
+        state.descriptorSets[set] = descriptorSet;
+    }
+
+    uint64_t CommandEncoder::getIssued() const {
+        uint64_t total = 0;
+        for (uint64_t count : issued)
+            total += count;
+        return total;
+    }
+
+    uint64_t CommandEncoder::getElided() const {
+        uint64_t total = 0;
+        for (uint64_t count : elided)
+            total += count;
+        return total;
+    }
+
+    void CommandEncoder::printStatistics() const {
+        std::cerr << "Command encoder: " << getIssued() << " commands issued, " << getElided() << " elided (";
+        for (uint32_t i = 0; i < CommandCount; i++)
+            std::cerr << (i > 0 ? ", " : "") << commandNames[i] << " " << issued[i] << "/" << elided[i];
+        std::cerr << " issued/elided)" << std::endl;
+    }
+
+    CommandEncoder::BindPointState &CommandEncoder::getBindPointState(VkPipelineBindPoint bindPoint) {
+        if (bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+            return compute;
+        if (bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+            return graphics;
+
+        throw std::runtime_error("failed to shadow state, unsupported pipeline bind point!");
+    }
+
+    bool CommandEncoder::elide(Command command, bool redundant) {
+        if (redundant)
+            elided[command]++;
+        else
+            issued[command]++;
+        return redundant;
+    }
+}
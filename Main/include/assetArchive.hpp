@@ -0,0 +1,82 @@
+#pragma once
+
+#include "mappedFile.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class AssetType : uint32_t
+{
+    Raw,
+    Mesh,    // MeshAsset, vertices and 32 bit indices
+    Texture, // a KTX2 file as it is on disk
+    Shader   // SPIR-V
+};
+
+// Points into the mapped archive, valid until it is closed
+struct MeshAsset
+{
+    const void *vertices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t vertexStride = 0;
+    const uint32_t *indices = nullptr;
+    uint32_t indexCount = 0;
+};
+
+// Read only, memory mapped pack of assets. A header, an index sorted by name hash and
+// the names are followed by the blobs, each aligned to blobAlignment so they can be
+// copied straight from the mapped pages into staging memory. Lookups search the
+// mapped index in place, nothing is parsed or allocated after open().
+struct AssetArchive
+{
+    static constexpr uint64_t blobAlignment = 256;
+
+    // Returns false when the file is missing or not a valid archive
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    // nullptr when there is no asset with that name and type
+    const void *find(const std::string &name, AssetType type, size_t &size) const;
+    bool findMesh(const std::string &name, MeshAsset &mesh) const;
+
+    uint32_t getEntryCount() const { return entryCount; }
+    size_t getSize() const { return file.size(); }
+
+    // What the writer was given with setSourceHash(), tells whether the archive is stale
+    uint64_t getSourceHash() const { return sourceHash; }
+
+private:
+    MappedFile file;
+    const void *index = nullptr; // entries sorted by name hash, followed by the names
+    uint32_t entryCount = 0;
+    uint64_t sourceHash = 0;
+};
+
+// Collects assets in memory and writes them out as an archive AssetArchive can open
+struct AssetArchiveWriter
+{
+    void add(const std::string &name, AssetType type, const void *data, size_t size);
+    void addMesh(const std::string &name, const void *vertices, uint32_t vertexCount, uint32_t vertexStride,
+                 const uint32_t *indices, uint32_t indexCount);
+
+    // Returns false when the file can't be read
+    bool addFile(const std::string &name, AssetType type, const std::string &path);
+
+    // Stored in the header, a hash of whatever the assets were built from
+    void setSourceHash(uint64_t hash) { sourceHash = hash; }
+
+    // Writes to a temporary file and renames it over path
+    bool write(const std::string &path) const;
+
+private:
+    struct Asset
+    {
+        std::string name;
+        AssetType type;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<Asset> assets;
+    uint64_t sourceHash = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "deviceProfile.hpp"
+#include "layoutCache.hpp"
+#include <vector>
+
+struct BindlessHeapCreateInfo
+{
+    uint32_t textureCapacity = 4096;
+    uint32_t bufferCapacity = 1024;
+};
+
+// Every texture and storage buffer lives in one partially bound, update after bind
+// descriptor set that is bound once per pass, shaders index into it with a push constant
+// or instance data instead of getting a set per draw. Shaders declare it as
+//   layout(set = 1, binding = 0) uniform sampler2D textures[];
+//   layout(set = 1, binding = 1) buffer Buffers { ... } buffers[];
+struct BindlessHeap
+{
+    static constexpr uint32_t set = 1;
+    static constexpr uint32_t textureBinding = 0;
+    static constexpr uint32_t bufferBinding = 1;
+    static constexpr uint32_t invalidIndex = ~0u;
+
+    // Per stage resources kept out of the heap for the other sets of a pipeline layout
+    static constexpr uint32_t reservedResources = 32;
+
+    // The descriptor indexing extension plus the features the heap relies on
+    static bool isSupported(const DeviceProfile &profile);
+    static VkPhysicalDeviceDescriptorIndexingFeaturesEXT requiredFeatures();
+
+    void init(VkDevice device, const DeviceProfile &profile, LayoutCache *layoutCache, BindlessHeapCreateInfo createInfo = {});
+    void cleanup();
+
+    uint32_t addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    // Rewrites a slot in place, only while no submitted frame reads it
+    void setTexture(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    void setBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    // Slots are handed out again once the frames that could still read them finished
+    void releaseTexture(uint32_t index, uint64_t frameNumber);
+    void releaseBuffer(uint32_t index, uint64_t frameNumber);
+    void update(uint64_t frameNumber, uint32_t framesInFlight);
+
+    VkDescriptorSetLayout getSetLayout() const { return setLayout; }
+    VkDescriptorSet getSet() const { return descriptorSet; }
+
+    void printStatistics() const;
+
+private:
+    struct Slots
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> free;
+        std::vector<std::pair<uint32_t, uint64_t>> retired; // index, frame it was released in
+
+        uint32_t allocate(const char *kind);
+        uint32_t used() const;
+    };
+
+    void write(uint32_t binding, uint32_t index, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    Slots textures;
+    Slots buffers;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Real time BC1 and BC3 encoding: endpoints from the inset bounding box of the block,
+// every texel gets the nearest palette entry. Worse than an offline encoder, but fast
+// enough to run on load. Color indices and bounding boxes use SSE2 when available.
+namespace BlockEncoder
+{
+    // 4x4 RGBA8 texels, row major. BC1 writes 8 bytes, alpha is ignored.
+    void encodeBC1(const uint8_t *texels, uint8_t *block);
+
+    // Writes 16 bytes, an interpolated alpha block followed by a BC1 color block
+    void encodeBC3(const uint8_t *texels, uint8_t *block);
+
+    // A whole level, partial blocks at the right and bottom edges repeat the last column and row
+    std::vector<uint8_t> encodeImage(const uint8_t *texels, uint32_t width, uint32_t height, bool alpha);
+}
@@ -36,6 +36,7 @@ struct CreateBufferInfo
     VmaMemoryUsage memoryUsage;
     VmaAllocationCreateFlags flags = {};
     std::vector<uint32_t> queueFamilyIndices = {};
+    VmaPool pool = VK_NULL_HANDLE;
 };
 
 
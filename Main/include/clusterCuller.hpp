@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "buffer.hpp"
+#include "computePipeline.hpp"
+#include "descriptorAllocator.hpp"
+#include "deviceProfile.hpp"
+#include "layoutCache.hpp"
+#include "lodSelector.hpp"
+#include "shaderStore.hpp"
+#include <vector>
+
+struct ClusterCullerCreateInfo
+{
+    VkDevice device;
+    const DeviceProfile *deviceProfile;
+    VmaAllocator allocator;
+    LayoutCache *layoutCache;
+    ShaderStore *shaderStore;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+};
+
+// Culls the clusters of LodMesh levels on the GPU, shaders/cull.comp writes one indexed
+// indirect draw per cluster of the level each mesh is drawn at and zeroes the instance
+// count of clusters outside the frustum or facing away from the camera. Every cluster has
+// a fixed draw slot, a level is drawn with one multi draw over its range.
+struct ClusterCuller
+{
+    void init(const ClusterCullerCreateInfo &createInfo);
+    void cleanup();
+
+    // Copies the clusters of every mesh to the GPU and assigns LodMesh::firstCluster.
+    // The meshes have to stay in the geometry pool where they were allocated.
+    void upload(std::vector<LodMesh> &meshes);
+
+    // Outside of a render pass, model is the transform the meshes are drawn with
+    void cull(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const std::vector<LodMesh> &meshes,
+              const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &proj, glm::vec3 cameraPosition);
+
+    // Inside the render pass the draws go to, after cull() on the same command buffer
+    void draw(VkCommandBuffer commandBuffer, const std::vector<LodMesh> &meshes);
+
+    // One mesh of the meshes cull() was called with, for callers ordering the draws themselves
+    void drawMesh(VkCommandBuffer commandBuffer, const LodMesh &mesh);
+
+    // VK_EXT_mesh_shader is reported but not used, clusters are drawn as indirect draws either way
+    bool isMeshShaderSupported() const { return meshShaderSupported; }
+
+    void printStatistics() const;
+
+private:
+    // Same layout as the Cluster struct of shaders/cull.comp
+    struct GpuCluster
+    {
+        float center[3];
+        float radius;
+        float coneAxis[3];
+        float coneCutoff;
+        uint32_t firstIndex; // in the geometry pool
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t padding;
+    };
+
+    struct PushConstants
+    {
+        float planes[6][4];
+        float cameraPosition[3];
+        uint32_t firstCluster;
+        uint32_t clusterCount;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    LayoutCache *layoutCache = nullptr;
+
+    ComputePipeline cullPipeline;
+    bool multiDrawIndirect = false;
+    bool meshShaderSupported = false;
+
+    uint32_t clusterCount = 0;
+    Buffer clusterBuffer = {};
+    Buffer drawBuffer = {};
+
+    uint64_t dispatches = 0;
+    uint64_t clustersTested = 0;
+    uint64_t indirectDraws = 0;
+};
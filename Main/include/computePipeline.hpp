@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "layoutCache.hpp"
+#include "shaderStore.hpp"
+#include <string>
+
+// A compute shader and the layout reflected from it. The entry point is the one the
+// shader declares, there is no fixed function state to key variants by.
+struct ComputePipeline
+{
+    void init(VkDevice device, LayoutCache *layoutCache, ShaderStore *shaderStore, VkPipelineCache pipelineCache, const std::string &path);
+    void cleanup();
+
+    VkPipeline getPipeline() const { return pipeline; }
+    VkPipelineLayout getPipelineLayout() const { return layoutInfo.pipelineLayout; }
+    VkDescriptorSetLayout getDescriptorSetLayout(uint32_t set) const { return layoutInfo.setLayouts.at(set); }
+    VkShaderStageFlags getPushConstantStages() const { return layoutInfo.pushConstantStages; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    ShaderStore *shaderStore = nullptr;
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    PipelineLayoutInfo layoutInfo;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <vector>
+
+struct DescriptorPoolSizeRatio
+{
+    VkDescriptorType type;
+    float ratio; // descriptors of this type per set
+};
+
+// Hands out descriptor sets from a list of pools, creating a bigger pool whenever the
+// current one runs out. Meant to be owned per frame in flight and reset once that
+// frame's fence signaled, so sets are allocated and written fresh every frame.
+struct DescriptorAllocator
+{
+    void init(VkDevice device, uint32_t initialSetsPerPool = 64,
+              std::vector<DescriptorPoolSizeRatio> ratios = defaultRatios());
+    void cleanup();
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    // Every set allocated since the last reset becomes invalid
+    void reset();
+
+    struct Statistics
+    {
+        uint32_t allocations;     // since the last reset
+        uint32_t peakAllocations; // highest per reset interval so far
+        uint32_t poolCount;
+        uint32_t poolsCreated;    // a growing number means setsPerPool started too small
+    };
+
+    Statistics getStatistics() const;
+    void printStatistics(const char *name) const;
+
+    static std::vector<DescriptorPoolSizeRatio> defaultRatios();
+
+private:
+    VkDescriptorPool getPool();
+    VkDescriptorPool createPool(uint32_t setCount);
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<DescriptorPoolSizeRatio> ratios;
+    uint32_t setsPerPool = 0;
+
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> readyPools;
+    std::vector<VkDescriptorPool> fullPools;
+
+    uint32_t allocations = 0;
+    uint32_t peakAllocations = 0;
+    uint32_t poolsCreated = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <array>
+#include <string>
+#include <vector>
+
+struct ProfiledFormat
+{
+    VkFormat format;
+    VkFormatProperties properties;
+};
+
+// What a physical device offers, gathered once and read by device selection and by
+// everything created on the device instead of asking the driver again. Extensions and
+// formats are sorted for lookups. Only the formats the renderer asks about are profiled,
+// getFormatProperties() asks the driver for any other.
+struct DeviceProfile
+{
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+    VkPhysicalDeviceProperties properties = {};
+    VkPhysicalDeviceFeatures features = {};
+    VkPhysicalDeviceMemoryProperties memory = {};
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {}; // zero without the extension
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties = {};
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+    std::vector<VkExtensionProperties> extensions;
+    std::vector<ProfiledFormat> formats;
+
+    // Zero on devices below Vulkan 1.1, their profiles aren't persisted
+    std::array<uint8_t, VK_UUID_SIZE> deviceUUID = {};
+    std::array<uint8_t, VK_UUID_SIZE> driverUUID = {};
+
+    // Fast paths
+    bool resizableBar = false; // the host maps device local memory beyond the old 256 MiB window, or memory is unified
+    bool timelineSemaphores = false;
+    bool dynamicRendering = false;
+
+    bool hasExtension(const char *name) const;
+    bool hasUUID() const;
+
+    VkFormatProperties getFormatProperties(VkFormat format) const;
+    VkDeviceSize getDeviceLocalBytes() const;
+
+    void print() const;
+};
+
+// Profiles of every physical device of the instance, persisted between runs. A device with
+// a stored profile only has its properties read, the stored profile is used while vendor,
+// device, driver version and the device and driver UUIDs still match.
+struct DeviceProfileCache
+{
+    // Without a path every profile is gathered and nothing is saved
+    void init(VkInstance instance, const std::string &path);
+
+    // Rewrites the file when a profile had to be gathered
+    void save();
+
+    const std::vector<DeviceProfile> &getProfiles() const { return profiles; }
+
+    void printStatistics() const;
+
+private:
+    std::vector<DeviceProfile> load() const;
+
+    std::string path;
+    std::vector<DeviceProfile> profiles;
+    bool dirty = false;
+
+    uint32_t loaded = 0;
+    uint32_t gathered = 0;
+    double milliseconds = 0.0;
+};
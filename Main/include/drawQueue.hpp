@@ -0,0 +1,82 @@
+#pragma once
+
+#include "jobSystem.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Passes are drawn in this order
+enum class DrawPass : uint32_t
+{
+    DepthPrepass, // opaque draws once more, depth only
+    Opaque,
+    Transparent
+};
+
+struct Draw
+{
+    DrawPass pass;
+    uint32_t pipeline; // caller's ids, equal ids end up next to each other and are bound once
+    uint32_t material;
+    uint32_t mesh;
+    float depth;      // view space distance
+    uint32_t payload; // what the caller draws for it, not part of the key
+};
+
+// Draws of a frame ordered by 64 bit sort keys. The pass is in the top bits, below it
+// depth only and opaque draws sort by pipeline, material and mesh and front to back
+// among draws sharing all three, which keeps state changes down and feeds early depth
+// rejection. Transparent draws sort back to front first and by state only at equal depth.
+// Keys go through an LSD radix sort, queues large enough run it on the job system.
+struct DrawQueue
+{
+    static constexpr uint32_t pipelineBits = 12;
+    static constexpr uint32_t materialBits = 12;
+    static constexpr uint32_t meshBits = 14;
+    static constexpr uint32_t depthBits = 24;
+
+    void init(JobSystem *jobSystem);
+
+    // Starts the frame's queue, depths are quantized over [0, farDepth]
+    void begin(float farDepth);
+
+    void add(const Draw &draw);
+
+    void sort();
+
+    // In key order after sort()
+    const std::vector<Draw> &getDraws() const { return sorted; }
+
+    void printStatistics() const;
+
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    static constexpr size_t parallelThreshold = 8192; // fewer keys sort faster on one thread
+    static constexpr size_t minChunkSize = 2048;
+
+    uint64_t makeKey(const Draw &draw) const;
+    void runChunks(size_t chunkCount, const std::function<void(size_t)> &task);
+
+    JobSystem *jobSystem = nullptr;
+    float farDepth = 1.0f;
+
+    std::vector<Draw> draws;
+    std::vector<Draw> sorted;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    std::vector<size_t> histograms;
+
+    uint64_t sorts = 0;
+    uint64_t parallelSorts = 0;
+    uint64_t drawCount = 0;
+    uint64_t radixPasses = 0;
+    uint64_t skippedPasses = 0;
+    uint64_t submittedPipelineChanges = 0;
+    uint64_t sortedPipelineChanges = 0;
+    double sortMilliseconds = 0.0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "CommandEncoder.hpp"
+#include "buffer.hpp"
+#include <vector>
+
+// A mesh is only a range inside the shared vertex and index buffers of a GeometryPool.
+// Draw it with vkCmdDrawIndexed(cmd, indexCount, 1, firstIndex, vertexOffset, 0).
+struct Mesh
+{
+    VmaVirtualAllocation vertexAllocation = VK_NULL_HANDLE;
+    VmaVirtualAllocation indexAllocation = VK_NULL_HANDLE;
+
+    VkDeviceSize vertexByteOffset = 0;
+    VkDeviceSize indexByteOffset = 0;
+
+    uint32_t vertexStride = 0;
+    uint32_t vertexCount = 0;
+    int32_t vertexOffset = 0;
+
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+};
+
+struct GeometryPoolCreateInfo
+{
+    VkDeviceSize vertexBufferSize = 64ull * 1024 * 1024;
+    VkDeviceSize indexBufferSize = 32ull * 1024 * 1024;
+    std::vector<uint32_t> queueFamilyIndices = {};
+    VmaPool memoryPool = VK_NULL_HANDLE;
+};
+
+struct GeometryPool
+{
+    static constexpr VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    using Index = uint32_t;
+
+    void init(VmaAllocator allocator, GeometryPoolCreateInfo createInfo);
+    void cleanup();
+
+    // Reserves space for a mesh, the data still has to be copied to
+    // vertexBuffer/indexBuffer at mesh.vertexByteOffset/mesh.indexByteOffset.
+    Mesh allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount);
+    void free(Mesh &mesh);
+
+    // One bind for every mesh of the pool, whatever its vertex layout
+    void bind(Engine::CommandEncoder &encoder) const;
+
+    void printStatistics() const;
+
+    VertexBuffer vertexBuffer = {};
+    IndexBuffer indexBuffer = {};
+
+private:
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    VmaVirtualBlock vertexBlock = VK_NULL_HANDLE;
+    VmaVirtualBlock indexBlock = VK_NULL_HANDLE;
+};
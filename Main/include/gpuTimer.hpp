@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "deviceProfile.hpp"
+#include <string>
+#include <vector>
+
+struct GpuTimerCreateInfo
+{
+    VkDevice device;
+    const DeviceProfile *deviceProfile;
+    uint32_t queueFamilyIndex; // the timed command buffers are submitted to
+    uint32_t framesInFlight;
+    uint32_t maxScopes = 8; // per frame
+};
+
+// Times scopes of a frame's command buffer with timestamp queries. Every frame in flight
+// has its own queries, read back once the frame's fence has signaled, so nothing waits on
+// the GPU and timings lag behind recording by framesInFlight frames. Does nothing on
+// queues without timestamp support.
+struct GpuTimer
+{
+    static constexpr uint32_t invalidScope = UINT32_MAX;
+
+    void init(const GpuTimerCreateInfo &createInfo);
+    void cleanup();
+
+    bool isSupported() const { return supported; }
+
+    // After the frame's fence was waited for, returns false when the frame had nothing timed
+    bool collect(uint32_t frame);
+
+    // Before any scope of the frame, outside of a render pass
+    void begin(VkCommandBuffer commandBuffer, uint32_t frame);
+
+    // Scopes with the same name add up to the same statistics across frames
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char *name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    // Of the last frame read back, 0 until the scope was read back once
+    double getMilliseconds(const char *name) const;
+
+    void printStatistics() const;
+
+private:
+    struct Scope
+    {
+        std::string name;
+        double milliseconds = 0.0;
+        double totalMilliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+        uint64_t samples = 0;
+    };
+
+    struct Frame
+    {
+        std::vector<uint32_t> scopes; // scope of every query pair written, in order
+    };
+
+    uint32_t findScope(const char *name);
+    uint32_t getFirstQuery(uint32_t frame) const { return frame * maxScopes * 2; }
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    bool supported = false;
+    double timestampPeriod = 0.0; // nanoseconds per tick
+    uint64_t timestampMask = 0;
+    uint32_t maxScopes = 0;
+
+    uint32_t currentFrame = 0;
+    std::vector<Frame> frames;
+    std::vector<Scope> scopes;
+    std::vector<uint64_t> results;
+};
@@ -1,15 +1,62 @@
 #pragma once
 
 #include "Engine.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <string>
 #include <vector>
-#include <fstream>
 #include "buffer.hpp"
+#include "hash.hpp"
+#include "layoutCache.hpp"
+#include "shaderStore.hpp"
+#include "vertexLayout.hpp"
 
 struct ShaderInfo {
-    std::string path;
-    std::string entryPoint;
+    const char *path;
+    const char *entryPoint;
 };
 
+// Everything that identifies a pipeline variant, viewport and scissor are dynamic and left out.
+// Plain integers without padding so the key can be hashed and compared bytewise.
+struct PipelineStateKey {
+    uint64_t vertexShader;
+    uint64_t fragmentShader;
+    uint64_t vertexInput;
+
+    uint32_t topology;
+    uint32_t primitiveRestart;
+    uint32_t polygonMode;
+    uint32_t cullMode;
+    uint32_t frontFace;
+    uint32_t depthBias;
+    uint32_t rasterizationSamples;
+    uint32_t sampleShading;
+    uint32_t blendEnable;
+    uint32_t srcColorBlendFactor;
+    uint32_t dstColorBlendFactor;
+    uint32_t colorBlendOp;
+    uint32_t srcAlphaBlendFactor;
+    uint32_t dstAlphaBlendFactor;
+    uint32_t alphaBlendOp;
+    uint32_t colorWriteMask;
+    uint32_t depthTest;
+    uint32_t depthWrite;
+    uint32_t depthCompareOp;
+    uint32_t stencilTest;
+
+    uint64_t hash() const {
+        return Hash::fnv1a(this, sizeof(*this));
+    }
+
+    bool operator==(const PipelineStateKey &other) const {
+        return std::memcmp(this, &other, sizeof(*this)) == 0;
+    }
+};
+
+static_assert(sizeof(PipelineStateKey) == 3 * sizeof(uint64_t) + 20 * sizeof(uint32_t), "PipelineStateKey must not have padding");
+
 
 struct GraphicsPipeline {
 
@@ -18,14 +65,14 @@ struct GraphicsPipeline {
 
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        shaderStore->release(fragShaderModule);
+        shaderStore->release(vertShaderModule);
     }
 
     virtual ShaderInfo getVertexShader() = 0;
     virtual ShaderInfo getFragmentShader() = 0;
 
-    virtual std::vector<VkVertexInputBindingDescription> getBindingDescription() = 0;
-    virtual std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() = 0; 
+    virtual VertexInputDescription getVertexInput() = 0;
 
     virtual VkPipelineInputAssemblyStateCreateInfo getVertexInputInfo() {
         VkPipelineInputAssemblyStateCreateInfo vertexInputInfo{};
@@ -82,7 +129,7 @@ struct GraphicsPipeline {
         return multisampling;
     }
 
-    virtual std::vector<VkPipelineColorBlendAttachmentState> getPipelineColorBlendAttachment() {
+    virtual VkPipelineColorBlendAttachmentState getPipelineColorBlendAttachment() {
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
@@ -93,7 +140,21 @@ struct GraphicsPipeline {
         colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
         colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-        return {colorBlendAttachment};
+        return colorBlendAttachment;
+    }
+
+    // Ignored in render passes without a depth attachment
+    virtual VkPipelineDepthStencilStateCreateInfo getDepthStencilInfo() {
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = VK_FALSE;
+        depthStencil.depthWriteEnable = VK_FALSE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+        depthStencil.minDepthBounds = 0.0f;
+        depthStencil.maxDepthBounds = 1.0f;
+        return depthStencil;
     }
 
     
@@ -106,50 +167,225 @@ struct GraphicsPipeline {
         return graphicsPipeline;
     }
 
+    PipelineStateKey getStateKey() {
+        ShaderInfo vertexShader = getVertexShader();
+        ShaderInfo fragmentShader = getFragmentShader();
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = getVertexInputInfo();
+        VkPipelineRasterizationStateCreateInfo rasterizer = getPipelineRasterizationInfo();
+        VkPipelineMultisampleStateCreateInfo multisampling = getPipelineMultisampleInfo();
+        VkPipelineColorBlendAttachmentState blend = getPipelineColorBlendAttachment();
+        VkPipelineDepthStencilStateCreateInfo depthStencil = getDepthStencilInfo();
+
+        PipelineStateKey key{};
+        key.vertexShader = Hash::fnv1a(vertexShader.entryPoint, Hash::fnv1a(vertexShader.path));
+        key.fragmentShader = Hash::fnv1a(fragmentShader.entryPoint, Hash::fnv1a(fragmentShader.path));
+        key.vertexInput = getVertexInput().hash;
+        key.topology = inputAssembly.topology;
+        key.primitiveRestart = inputAssembly.primitiveRestartEnable;
+        key.polygonMode = rasterizer.polygonMode;
+        key.cullMode = rasterizer.cullMode;
+        key.frontFace = rasterizer.frontFace;
+        key.depthBias = rasterizer.depthBiasEnable;
+        key.rasterizationSamples = multisampling.rasterizationSamples;
+        key.sampleShading = multisampling.sampleShadingEnable;
+        key.blendEnable = blend.blendEnable;
+        key.srcColorBlendFactor = blend.srcColorBlendFactor;
+        key.dstColorBlendFactor = blend.dstColorBlendFactor;
+        key.colorBlendOp = blend.colorBlendOp;
+        key.srcAlphaBlendFactor = blend.srcAlphaBlendFactor;
+        key.dstAlphaBlendFactor = blend.dstAlphaBlendFactor;
+        key.alphaBlendOp = blend.alphaBlendOp;
+        key.colorWriteMask = blend.colorWriteMask;
+        key.depthTest = depthStencil.depthTestEnable;
+        key.depthWrite = depthStencil.depthWriteEnable;
+        key.depthCompareOp = depthStencil.depthCompareOp;
+        key.stencilTest = depthStencil.stencilTestEnable;
+        return key;
+    }
+
     struct PipelineInitInfo {
         VkDevice device; VkRenderPass renderPass; VkExtent2D swapChainExtent;
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
-
+        LayoutCache *layoutCache;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        ShaderStore *shaderStore = nullptr;
     };
 
-    void init(PipelineInitInfo info) {
+    void init(const PipelineInitInfo &info) {
         this->swapChainExtent = info.swapChainExtent;
         this->device = info.device;
+        this->renderPass = info.renderPass;
+        this->pipelineCache = info.pipelineCache;
+        this->shaderStore = info.shaderStore;
+        this->layoutCache = info.layoutCache;
 
-        ShaderInfo vertexShader = getVertexShader();
-        ShaderInfo fragmentShader = getFragmentShader();
+        vertShaderModule = shaderStore->acquire(getVertexShader().path);
+        fragShaderModule = shaderStore->acquire(getFragmentShader().path);
+
+        // Layouts come from the shaders, the cache owns them and hands identical ones out once
+        layoutInfo = reflectLayout(vertShaderModule, fragShaderModule);
+        pipelineLayout = layoutInfo.pipelineLayout;
+
+        defaultKey = getStateKey();
+        graphicsPipeline = createPipeline(defaultKey, vertShaderModule, fragShaderModule);
+    }
+
+    VkDescriptorSetLayout getDescriptorSetLayout(uint32_t set) const {
+        return layoutInfo.setLayouts.at(set);
+    }
+
+    VkShaderStageFlags getPushConstantStages() const {
+        return layoutInfo.pushConstantStages;
+    }
+
+    // The key init() built the default pipeline from, variants are copies of it with
+    // some fixed function fields changed.
+    const PipelineStateKey &getDefaultKey() const {
+        return defaultKey;
+    }
+
+    // Shaders and vertex input identify the pipeline, a key with other ones belongs to someone else
+    bool ownsKey(const PipelineStateKey &key) const {
+        return key.vertexShader == defaultKey.vertexShader &&
+               key.fragmentShader == defaultKey.fragmentShader &&
+               key.vertexInput == defaultKey.vertexInput;
+    }
+
+    bool usesShader(const std::string &path) {
+        return path == getVertexShader().path || path == getFragmentShader().path;
+    }
+
+    // Builds a variant sharing this pipeline's shader modules and layout. Worker threads may
+    // call it concurrently with each other and with swap(), the caller owns the result.
+    VkPipeline createVariant(const PipelineStateKey &key) {
+        if (!ownsKey(key)) {
+            throw std::runtime_error("failed to create pipeline variant, key belongs to another pipeline!");
+        }
+
+        // Retained so a swap() during compilation can't free the modules underneath us
+        VkShaderModule vertModule, fragModule;
+        {
+            std::lock_guard<std::mutex> lock(moduleMutex);
+            vertModule = vertShaderModule;
+            fragModule = fragShaderModule;
+            shaderStore->retain(vertModule);
+            shaderStore->retain(fragModule);
+        }
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = createPipeline(key, vertModule, fragModule);
+        } catch (...) {
+            shaderStore->release(fragModule);
+            shaderStore->release(vertModule);
+            throw;
+        }
+
+        shaderStore->release(fragModule);
+        shaderStore->release(vertModule);
+        return pipeline;
+    }
+
+    // Shader modules and default pipeline, what a hot reload replaces
+    struct Build {
+        VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+        VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    // Reads the shader files again and compiles the default pipeline from them, runs on a worker thread
+    Build rebuild() {
+        Build build;
+        build.vertShaderModule = shaderStore->acquire(getVertexShader().path, true);
+
+        try {
+            build.fragShaderModule = shaderStore->acquire(getFragmentShader().path, true);
+
+            // Descriptor sets were allocated against the old layout, a changed interface needs a restart
+            if (reflectLayout(build.vertShaderModule, build.fragShaderModule).pipelineLayout != pipelineLayout) {
+                throw std::runtime_error("failed to reload shader, its descriptor interface changed!");
+            }
+
+            build.pipeline = createPipeline(defaultKey, build.vertShaderModule, build.fragShaderModule);
+        } catch (...) {
+            if (build.fragShaderModule != VK_NULL_HANDLE)
+                shaderStore->release(build.fragShaderModule);
+            shaderStore->release(build.vertShaderModule);
+            throw;
+        }
+
+        return build;
+    }
+
+    // Installs a rebuild at a frame boundary. The previous objects are returned and
+    // have to outlive the frames still using them before going to destroy().
+    Build swap(const Build &build) {
+        std::lock_guard<std::mutex> lock(moduleMutex);
+
+        Build previous{vertShaderModule, fragShaderModule, graphicsPipeline};
+        vertShaderModule = build.vertShaderModule;
+        fragShaderModule = build.fragShaderModule;
+        graphicsPipeline = build.pipeline;
+        return previous;
+    }
 
-        auto vertShaderCode = readShader(vertexShader.path);
-        auto fragShaderCode = readShader(fragmentShader.path);
+    void destroy(const Build &build) {
+        vkDestroyPipeline(device, build.pipeline, nullptr);
+        shaderStore->release(build.fragShaderModule);
+        shaderStore->release(build.vertShaderModule);
+    }
+
+protected:
+    PipelineLayoutInfo reflectLayout(VkShaderModule vertModule, VkShaderModule fragModule) {
+        ShaderReflection vertexReflection = shaderStore->getReflection(vertModule);
+        ShaderReflection fragmentReflection = shaderStore->getReflection(fragModule);
+
+        // Attributes are generated from the vertex struct, the shader only has to agree on
+        // locations and numeric types. Attributes the shader doesn't read are fine.
+        VertexInputDescription vertexInput = getVertexInput();
+        for (const auto &input : vertexReflection.inputs) {
+            auto attributesEnd = vertexInput.attributes + vertexInput.attributeCount;
+            auto attribute = std::find_if(vertexInput.attributes, attributesEnd, [&](const VkVertexInputAttributeDescription &candidate) {
+                return candidate.location == input.location;
+            });
+
+            if (attribute == attributesEnd || !SpirvReflect::isCompatibleVertexFormat(input.format, attribute->format)) {
+                throw std::runtime_error("failed to create graphics pipeline, vertex input doesn't match the shader!");
+            }
+        }
+
+        return layoutCache->getPipelineLayout({vertexReflection, fragmentReflection});
+    }
 
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    VkPipeline createPipeline(const PipelineStateKey &key, VkShaderModule vertModule, VkShaderModule fragModule) {
+        ShaderInfo vertexShader = getVertexShader();
+        ShaderInfo fragmentShader = getFragmentShader();
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = vertexShader.entryPoint.c_str();
+        vertShaderStageInfo.module = vertModule;
+        vertShaderStageInfo.pName = vertexShader.entryPoint;
 
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = fragmentShader.entryPoint.c_str();
+        fragShaderStageInfo.module = fragModule;
+        fragShaderStageInfo.pName = fragmentShader.entryPoint;
 
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        auto bindingDescription = getBindingDescription();
-        auto attributeDescriptions = getAttributeDescriptions();
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        VertexInputDescription vertexInput = getVertexInput();
+        vertexInputInfo.vertexBindingDescriptionCount = vertexInput.bindingCount;
+        vertexInputInfo.vertexAttributeDescriptionCount = vertexInput.attributeCount;
+        vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings;
+        vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes;
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly = getVertexInputInfo();
+        inputAssembly.topology = static_cast<VkPrimitiveTopology>(key.topology);
+        inputAssembly.primitiveRestartEnable = key.primitiveRestart;
 
         VkViewport viewport = getViewport();
         VkRect2D scissor = getScissor();
@@ -162,10 +398,30 @@ struct GraphicsPipeline {
         viewportState.pScissors = &scissor;
 
         VkPipelineRasterizationStateCreateInfo rasterizer = getPipelineRasterizationInfo();
+        rasterizer.polygonMode = static_cast<VkPolygonMode>(key.polygonMode);
+        rasterizer.cullMode = key.cullMode;
+        rasterizer.frontFace = static_cast<VkFrontFace>(key.frontFace);
+        rasterizer.depthBiasEnable = key.depthBias;
 
         VkPipelineMultisampleStateCreateInfo multisampling = getPipelineMultisampleInfo();
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment = getPipelineColorBlendAttachment()[0];
+        multisampling.rasterizationSamples = static_cast<VkSampleCountFlagBits>(key.rasterizationSamples);
+        multisampling.sampleShadingEnable = key.sampleShading;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment = getPipelineColorBlendAttachment();
+        colorBlendAttachment.blendEnable = key.blendEnable;
+        colorBlendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(key.srcColorBlendFactor);
+        colorBlendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(key.dstColorBlendFactor);
+        colorBlendAttachment.colorBlendOp = static_cast<VkBlendOp>(key.colorBlendOp);
+        colorBlendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(key.srcAlphaBlendFactor);
+        colorBlendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(key.dstAlphaBlendFactor);
+        colorBlendAttachment.alphaBlendOp = static_cast<VkBlendOp>(key.alphaBlendOp);
+        colorBlendAttachment.colorWriteMask = key.colorWriteMask;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil = getDepthStencilInfo();
+        depthStencil.depthTestEnable = key.depthTest;
+        depthStencil.depthWriteEnable = key.depthWrite;
+        depthStencil.depthCompareOp = static_cast<VkCompareOp>(key.depthCompareOp);
+        depthStencil.stencilTestEnable = key.stencilTest;
 
         VkPipelineColorBlendStateCreateInfo colorBlending{};
 
@@ -179,17 +435,7 @@ struct GraphicsPipeline {
         colorBlending.blendConstants[2] = 0.0f;
         colorBlending.blendConstants[3] = 0.0f;
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        auto descriptorSetLayouts = info.descriptorSetLayouts;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
-
-        std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
         VkPipelineDynamicStateCreateInfo dynamicState{};
         dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -206,69 +452,39 @@ struct GraphicsPipeline {
         pipelineInfo.pViewportState = &viewportState;
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = nullptr; // Optional
+        pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
         pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = info.renderPass;
+        pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        VkPipeline pipeline;
+        if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        return pipeline;
     }
 
 
 
-protected: 
-
-    VkShaderModule createShaderModule(const std::vector<char> &code)
-    {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create shader module!");
-        }
-
-        return shaderModule;
-    }
-
-    static std::vector<char> readShader(const std::string &filename)
-    {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open())
-        {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
-    }
-
-
 protected:
     GraphicsPipeline() {}
     virtual ~GraphicsPipeline() {}
     VkDevice device;
     VkExtent2D swapChainExtent;
+    VkRenderPass renderPass;
+    VkPipelineCache pipelineCache;
+    ShaderStore *shaderStore;
+    LayoutCache *layoutCache;
+    PipelineLayoutInfo layoutInfo;
+    std::mutex moduleMutex;
+    VkShaderModule vertShaderModule;
+    VkShaderModule fragShaderModule;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
+    PipelineStateKey defaultKey;
 };
 
 
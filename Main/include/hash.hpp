@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, small and good enough for cache keys
+namespace Hash
+{
+    constexpr uint64_t offsetBasis = 14695981039346656037ull;
+    constexpr uint64_t prime = 1099511628211ull;
+
+    constexpr uint64_t fnv1a(const char *string, uint64_t hash = offsetBasis)
+    {
+        while (*string)
+        {
+            hash ^= static_cast<uint8_t>(*string++);
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    constexpr uint64_t combine(uint64_t hash, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    inline uint64_t fnv1a(const void *data, size_t size, uint64_t hash = offsetBasis)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= prime;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tightly packed RGBA8 texels, mips[0] is the full resolution image
+struct ImageData
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> mips;
+
+    uint32_t getMipCount() const { return static_cast<uint32_t>(mips.size()); }
+    uint32_t getMipWidth(uint32_t mip) const { return width >> mip ? width >> mip : 1; }
+    uint32_t getMipHeight(uint32_t mip) const { return height >> mip ? height >> mip : 1; }
+};
+
+// Decodes with stb_image when Engine/vendor/stb/stb_image.h is present, otherwise only
+// binary PPM (P6) and uncompressed or RLE TGA are understood. Safe to call from jobs.
+namespace ImageLoader
+{
+    ImageData load(const std::string &path);
+
+    // Box filtered chain down to 1x1 from mips[0]
+    void generateMips(ImageData &image);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads pulling from a single FIFO queue.
+// Jobs must not throw, exceptions escaping a job terminate the program.
+struct JobSystem
+{
+    using Job = std::function<void()>;
+
+    // threadCount 0 leaves one hardware thread for the main loop
+    void init(uint32_t threadCount = 0);
+    void cleanup();
+
+    void submit(Job job);
+
+    // Blocks until the queue is empty and no job is running
+    void wait();
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable idle;
+    uint32_t runningJobs = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "spirvReflect.hpp"
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// One template entry per binding, descriptors are laid out in binding order with
+// arrays flattened, so writing a set is filling an array of these
+union DescriptorInfo
+{
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+    VkBufferView texelBuffer;
+};
+
+struct PipelineLayoutInfo
+{
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> setLayouts; // indexed by set number
+    VkShaderStageFlags pushConstantStages = 0;
+    uint32_t pushConstantSize = 0;
+};
+
+// Descriptor set and pipeline layouts built from shader reflection. Identical interfaces
+// map to the same objects, so pipelines sharing one can share bound descriptor sets.
+// The cache owns everything it returns.
+struct LayoutCache
+{
+    void init(VkDevice device);
+    void cleanup();
+
+    // Merges the stages of one pipeline, bindings used by several stages get all their stage flags
+    PipelineLayoutInfo getPipelineLayout(const std::vector<ShaderReflection> &stages);
+
+    VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings,
+                                       std::vector<VkDescriptorBindingFlags> bindingFlags = {},
+                                       VkDescriptorSetLayoutCreateFlags flags = 0);
+    VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout> &layouts, const std::vector<VkPushConstantRange> &pushConstantRanges);
+
+    // Pipelines using this set number get the given layout instead of a reflected one, the
+    // shaders must only use bindings it has. Runtime sized arrays are only allowed in such sets.
+    void setSharedSetLayout(uint32_t set, VkDescriptorSetLayout setLayout);
+
+    // Only for set layouts created by this cache, writes every binding in one call
+    VkDescriptorUpdateTemplate getUpdateTemplate(VkDescriptorSetLayout setLayout);
+    void update(VkDescriptorSet descriptorSet, VkDescriptorSetLayout setLayout, const DescriptorInfo *descriptors);
+
+    void printStatistics() const;
+
+private:
+    bool isShared(uint32_t set) const;
+    VkDescriptorSetLayout getSharedSetLayout(uint32_t set) const;
+    void checkSharedBinding(const ReflectedBinding &reflected) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    mutable std::mutex mutex;
+    std::map<std::vector<uint64_t>, VkDescriptorSetLayout> setLayouts;
+    std::map<std::vector<uint64_t>, VkPipelineLayout> pipelineLayouts;
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> setLayoutBindings;
+    std::unordered_map<VkDescriptorSetLayout, VkDescriptorUpdateTemplate> updateTemplates;
+    std::map<uint32_t, VkDescriptorSetLayout> sharedSetLayouts;
+    uint32_t requests = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "geometryPool.hpp"
+#include "meshOptimizer.hpp"
+#include <vector>
+
+// A mesh in the geometry pool with the levels of detail inside its index range
+struct LodMesh
+{
+    Mesh mesh;
+    std::vector<MeshLod> lods; // finest first, firstIndex relative to mesh.firstIndex
+    float positionScale = 1.0f; // object space size of a vertex position unit, the smallest axis of the dequantization
+    uint32_t currentLod = 0;
+    std::vector<MeshCluster> clusters; // of every level, see MeshLod::firstCluster
+    uint32_t firstCluster = 0;         // of the mesh in the cluster culler
+
+    const MeshLod &getLod() const { return lods[currentLod]; }
+    uint32_t getFirstIndex() const { return mesh.firstIndex + getLod().firstIndex; }
+    uint32_t getIndexCount() const { return getLod().indexCount; }
+};
+
+// Picks the coarsest level whose error projects to at most thresholdPixels. Moving to a
+// coarser level needs the error to drop below threshold * (1 - hysteresis), so a mesh
+// sitting at a switching distance doesn't alternate between two levels every frame.
+struct LodSelector
+{
+    float thresholdPixels = 1.0f;
+    float hysteresis = 0.25f;
+
+    void setProjection(float verticalFov, float viewportHeight);
+
+    // distance from the camera to the mesh bounds, in vertex position units.
+    // Updates mesh.currentLod and returns it.
+    uint32_t select(LodMesh &mesh, float distance);
+
+    float getScreenError(float error, float distance) const;
+
+    void printStatistics() const;
+
+private:
+    float pixelsPerUnit = 1.0f; // at a distance of 1
+
+    uint64_t selections = 0;
+    uint64_t switches = 0;
+};
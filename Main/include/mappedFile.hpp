@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read only memory mapping of a whole file. The view is page aligned, which covers
+// the 4 byte alignment vkCreateShaderModule wants for SPIR-V.
+struct MappedFile
+{
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Returns false when the file can't be opened, an empty file maps to a null view
+    bool open(const std::string &path);
+    void close();
+
+    const void *data() const { return view; }
+    size_t size() const { return viewSize; }
+    bool isOpen() const { return view != nullptr; }
+
+    // Asks the OS to start reading the whole file in, later page faults hit the page cache
+    void prefetch() const;
+
+private:
+    void *view = nullptr;
+    size_t viewSize = 0;
+#ifdef _WIN32
+    void *mapping = nullptr;
+#endif
+};
+
+// Moves from over to, replacing it in one step so readers see the old or the new file,
+// never a partly written one. Files are written to path + ".tmp" and swapped in with this.
+bool replaceFile(const std::string &from, const std::string &to);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <array>
+#include <vector>
+
+// Resources are grouped by lifetime so long lived allocations don't end up
+// interleaved with per-frame ones in the same VkDeviceMemory blocks.
+enum class MemoryClass
+{
+    Transient,      // one-shot staging freed before the next is made, linear algorithm
+    HostVisible,    // host visible buffers kept for the whole run: upload ring, uniforms
+    RenderTarget,   // attachments, dedicated or aliased
+    StaticGeometry, // geometry pool buffers, few large blocks
+    Count
+};
+
+struct MemoryPoolConfig
+{
+    VkDeviceSize blockSize = 0; // 0 lets VMA pick block sizes
+    size_t minBlockCount = 0;
+    size_t maxBlockCount = 0;   // 0 means no limit
+};
+
+struct MemoryPoolsCreateInfo
+{
+    MemoryPoolConfig transient = {16ull * 1024 * 1024, 1, 0};
+    MemoryPoolConfig hostVisible = {64ull * 1024 * 1024, 1, 0};
+    MemoryPoolConfig renderTarget = {0, 0, 0};
+    MemoryPoolConfig staticGeometry = {128ull * 1024 * 1024, 1, 0};
+
+    // Used to pick a memory type compatible with the render targets
+    VkFormat renderTargetFormat = VK_FORMAT_B8G8R8A8_SRGB;
+};
+
+struct MemoryPools
+{
+    void init(VmaAllocator allocator, const MemoryPoolsCreateInfo &createInfo);
+    void cleanup();
+
+    VmaPool get(MemoryClass memoryClass) const
+    {
+        return pools[static_cast<size_t>(memoryClass)];
+    }
+
+    VmaDetailedStatistics getStatistics(MemoryClass memoryClass) const;
+    void printStatistics() const;
+
+    static const char *getName(MemoryClass memoryClass);
+
+private:
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    std::array<VmaPool, static_cast<size_t>(MemoryClass::Count)> pools = {};
+};
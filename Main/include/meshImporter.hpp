@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "geometryPool.hpp"
+#include "jobSystem.hpp"
+#include "lodSelector.hpp"
+#include "meshOptimizer.hpp"
+#include "renderPipeline.hpp"
+#include "uploadManager.hpp"
+#include <string>
+#include <vector>
+
+struct ImportedMesh
+{
+    std::string name;
+    std::vector<RenderPipeline::Vertex> vertices;
+    std::vector<GeometryPool::Index> indices; // every level of detail, one after another
+    std::vector<MeshLod> lods;
+    std::vector<MeshCluster> clusters;
+};
+
+// Every mesh of a model is quantized against the bounds of the whole model, so one
+// dequantization matrix places all of them. Node transforms are already applied.
+struct ImportedModel
+{
+    std::vector<ImportedMesh> meshes;
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    glm::vec3 boundsExtent = glm::vec3(1.0f);
+
+    glm::mat4 getDequantization() const { return VertexFormat::dequantization(boundsCenter, boundsExtent); }
+    uint64_t getVertexCount() const;
+    uint64_t getIndexCount() const;
+};
+
+struct ImportStatistics
+{
+    uint64_t bytesRead = 0;
+    uint64_t vertices = 0;
+    uint64_t triangles = 0;
+    uint64_t lodTriangles = 0; // in the levels below full detail
+    uint64_t uploadBytes = 0;
+    double parseSeconds = 0.0;
+    double optimizeSeconds = 0.0;
+    double uploadSeconds = 0.0;
+
+    void print(const std::string &path) const;
+};
+
+// glTF 2.0 (.gltf with embedded or external buffers, .glb) and OBJ. Attributes are read
+// straight from the mapped file into RenderPipeline::Vertex, one job per glTF primitive
+// or OBJ group after the OBJ text has been split into chunks parsed in parallel.
+// Only triangles are imported, materials and texture coordinates are ignored. Every mesh
+// is then optimized and gets a chain of levels of detail, see MeshOptimizer::buildLods(),
+// each of them cut into clusters for culling.
+namespace MeshImporter
+{
+    // Waits for its jobs on the calling thread
+    ImportedModel load(const std::string &path, JobSystem &jobSystem, ImportStatistics &statistics);
+
+    // Allocates every mesh in the pool and copies it through the staging ring of the
+    // upload manager, returns once all of them are on the GPU
+    std::vector<LodMesh> upload(const ImportedModel &model, GeometryPool &geometryPool, UploadManager &uploadManager, ImportStatistics &statistics);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "geometryPool.hpp"
+#include "renderPipeline.hpp"
+#include <vector>
+
+// One level of detail, a range of the mesh index buffer. Every level indexes the same
+// vertices, coarser levels only reference fewer of them.
+struct MeshLod
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f; // bound on the distance to the full detail surface, in object space units
+    uint32_t firstCluster = 0; // see MeshOptimizer::buildClusters()
+    uint32_t clusterCount = 0;
+};
+
+// A run of consecutive triangles of one level, culled as a whole. Bounds are in vertex
+// position units. The cone holds every triangle normal, the whole cluster faces away
+// from any viewpoint inside the cone behind the bounding sphere.
+struct MeshCluster
+{
+    uint32_t firstIndex = 0; // relative to the mesh, like MeshLod::firstIndex
+    uint32_t indexCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f; // sine of the cone half angle, 1 when the cluster can't be backface culled
+};
+
+struct LodSettings
+{
+    uint32_t maxLevels = 6;     // including the full detail level
+    float reduction = 0.5f;     // triangle count of each level relative to the one before
+    float maxError = 0.02f;     // relative to the largest half extent of the mesh
+    uint32_t minTriangles = 64; // levels this small aren't simplified further
+};
+
+// Index and vertex buffer optimizations for static meshes, all of them only reorder or
+// drop data so they are safe to run on imported meshes in place. Not thread safe on the
+// same buffers, independent meshes can be processed on separate jobs.
+namespace MeshOptimizer
+{
+    using Index = GeometryPool::Index;
+
+    // Changes whenever the output for the same input does, results stored with another
+    // version have to be built again
+    constexpr uint32_t version = 1;
+
+    // Tipsify (Sander et al. 2007) for a post-transform cache of cacheSize entries. Triangles
+    // keep their winding. clusters, when given, receives the first triangle of every run that
+    // starts after a cache flush, those runs can be reordered without hurting the cache.
+    void optimizeVertexCache(std::vector<Index> &indices, size_t vertexCount, std::vector<uint32_t> *clusters = nullptr, uint32_t cacheSize = 16);
+
+    // Moves the clusters facing away from the mesh center first, outer surfaces get drawn
+    // before the ones they hide. Needs the clusters of optimizeVertexCache().
+    void optimizeOverdraw(std::vector<Index> &indices, const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &clusters);
+
+    // Reorders vertices by first use in the index buffer and drops unreferenced ones,
+    // returns the new vertex count
+    size_t optimizeVertexFetch(void *vertices, size_t vertexCount, size_t vertexStride, std::vector<Index> &indices);
+
+    // Quadric error edge collapse onto existing vertices until the index count reaches
+    // targetIndexCount or the next collapse would cost more than maxError. Borders and
+    // attribute seams are kept in place. error receives the largest error introduced.
+    std::vector<Index> simplify(const std::vector<Index> &indices, const std::vector<glm::vec3> &positions, size_t targetIndexCount, float maxError, float &error);
+
+    // Cache and fetch optimization for meshes without levels of detail, vertexCount is updated
+    void optimize(void *vertices, size_t &vertexCount, size_t vertexStride, std::vector<Index> &indices);
+
+    // Replaces indices with every level of the chain one after another, finest first, each
+    // of them optimized, and reorders vertices for the finest level. positionScale is the
+    // extent of the dequantization, errors are measured in object space.
+    std::vector<MeshLod> buildLods(std::vector<RenderPipeline::Vertex> &vertices, std::vector<Index> &indices, glm::vec3 positionScale,
+                                   const LodSettings &settings = {});
+
+    // Cuts every level into clusters of at most maxVertices distinct vertices and maxTriangles
+    // triangles, in index buffer order, and fills the cluster range of each level. Run after
+    // buildLods(), the cache order keeps consecutive triangles close together.
+    std::vector<MeshCluster> buildClusters(const std::vector<RenderPipeline::Vertex> &vertices, const std::vector<Index> &indices,
+                                           std::vector<MeshLod> &lods, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+}
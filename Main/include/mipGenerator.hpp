@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "buffer.hpp"
+#include "computePipeline.hpp"
+#include "descriptorAllocator.hpp"
+#include "deviceProfile.hpp"
+#include "layoutCache.hpp"
+#include "samplerCache.hpp"
+#include "shaderStore.hpp"
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+enum class MipMethod
+{
+    Unsupported,
+    Compute, // shaders/downsample.comp, one dispatch for the whole chain
+    Blit     // vkCmdBlitImage from each level to the next
+};
+
+struct MipGeneratorCreateInfo
+{
+    VkDevice device;
+    const DeviceProfile *deviceProfile;
+    VmaAllocator allocator;
+    LayoutCache *layoutCache;
+    ShaderStore *shaderStore;
+    SamplerCache *samplerCache;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+};
+
+// Level 0 has to be written already, every other level is overwritten
+struct MipTarget
+{
+    VkImage image;
+    VkFormat format;
+    VkExtent2D extent;
+    uint32_t mipLevels;
+};
+
+// Fills mip chains on the GPU. RGBA8 images with storage support go through a single
+// pass compute downsampler, anything else through a chain of blits. Images have to be
+// created with getImageUsage() and getImageFlags() for the method their format gets.
+// Views the compute path needs are cached per image until forget() is called.
+struct MipGenerator
+{
+    static constexpr uint32_t maxComputeMips = 13; // level 0 and the 12 levels the shader writes
+
+    static uint32_t getMipCount(VkExtent2D extent);
+
+    void init(const MipGeneratorCreateInfo &createInfo);
+    void cleanup();
+
+    MipMethod chooseMethod(VkFormat format, uint32_t mipLevels) const;
+    VkImageUsageFlags getImageUsage(VkFormat format, uint32_t mipLevels) const;
+    VkImageCreateFlags getImageFlags(VkFormat format, uint32_t mipLevels) const;
+
+    // Level 0 is in srcLayout, the other levels in any layout. Every level ends up in finalLayout.
+    void generate(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const MipTarget &target,
+                  VkImageLayout srcLayout, VkImageLayout finalLayout);
+
+    // Deferred generate() for images finished outside of frame recording, like uploads
+    // completing on the transfer queue. record() runs them on the next frame's command buffer.
+    void request(const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout);
+    void record(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator);
+
+    // Has to be called before destroying an image generate() was used on
+    void forget(VkImage image);
+
+    void printStatistics() const;
+
+private:
+    struct Views
+    {
+        VkImageView source;
+        std::array<VkImageView, maxComputeMips - 1> mips;
+    };
+
+    struct Request
+    {
+        MipTarget target;
+        VkImageLayout srcLayout;
+        VkImageLayout finalLayout;
+    };
+
+    struct PushConstants
+    {
+        float invSize[2];
+        uint32_t mipCount;
+        uint32_t workGroupCount;
+        uint32_t srgb;
+    };
+
+    static VkFormat getStorageFormat(VkFormat format);
+
+    const Views &getViews(const MipTarget &target);
+    void generateCompute(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const MipTarget &target,
+                         VkImageLayout srcLayout, VkImageLayout finalLayout);
+    void generateBlit(VkCommandBuffer commandBuffer, const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout);
+    void transition(VkCommandBuffer commandBuffer, const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout);
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceProfile *deviceProfile = nullptr;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    LayoutCache *layoutCache = nullptr;
+
+    bool computeSupported = false;
+    ComputePipeline downsamplePipeline;
+    VkSampler sampler = VK_NULL_HANDLE;
+    Buffer counterBuffer = {};
+
+    std::unordered_map<VkImage, Views> views;
+    std::vector<Request> requests;
+
+    uint64_t dispatches = 0;
+    uint64_t blitChains = 0;
+    uint64_t levelsGenerated = 0;
+};
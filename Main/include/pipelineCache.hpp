@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// VkPipelineCache persisted between runs. The blob is only handed back to the driver
+// when it was written by the same vendor, device, driver and cache UUID.
+struct PipelineCache
+{
+    void init(VkDevice device, const VkPhysicalDeviceProperties &properties, const std::string &path);
+    void cleanup();
+
+    // Writes to a temporary file and renames it over the previous blob
+    void save();
+
+    // Called every frame, saves when the interval elapsed and the driver added pipelines
+    void saveIfDue(std::chrono::seconds interval = std::chrono::seconds(300));
+
+    VkPipelineCache get() const { return pipelineCache; }
+
+private:
+    bool isCompatible(const std::vector<char> &data) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties = {};
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    std::string path;
+    size_t savedSize = 0;
+    std::chrono::steady_clock::time_point lastSave;
+};
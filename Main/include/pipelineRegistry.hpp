@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "graphicsPipeline.hpp"
+#include "jobSystem.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Pipeline variants keyed by PipelineStateKey hash. A variant that isn't compiled yet is
+// queued on the job system and the caller gets the default pipeline until it is ready,
+// so a new state combination never stalls the frame on vkCreateGraphicsPipelines.
+// Every variant requested during a run is written to a warm-up list and compiled
+// up front on the next start. Shader hot reload goes through here as well, since
+// the variants of a rebuilt pipeline have to be retired along with it.
+struct PipelineRegistry
+{
+    void init(VkDevice device, JobSystem *jobSystem, const std::string &warmUpPath);
+
+    // Waits for compiles in flight, writes the warm-up list and destroys all variants
+    void cleanup();
+
+    // Pipelines the warm-up keys are matched against, must outlive the registry
+    void add(GraphicsPipeline *pipeline);
+
+    // Queues every key from the warm-up list whose pipeline was added
+    void warmUp();
+
+    // The variant if compiled, otherwise the pipeline's default variant
+    VkPipeline get(GraphicsPipeline &pipeline, const PipelineStateKey &key);
+
+    // VK_NULL_HANDLE while the variant is compiling, for draws that rather skip than fall back
+    VkPipeline tryGet(GraphicsPipeline &pipeline, const PipelineStateKey &key);
+
+    // Rebuilds every added pipeline using the shader on a worker thread, update() swaps them in
+    void reload(const std::string &shaderPath);
+
+    // Frame boundary: installs finished rebuilds and retires what they replace. Retired
+    // objects are destroyed once framesInFlight more frames were submitted.
+    void update(uint64_t frameNumber, uint32_t framesInFlight);
+
+    uint32_t getPendingCount() const { return pendingCount.load(); }
+
+private:
+    enum class VariantState : uint32_t
+    {
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct Variant
+    {
+        GraphicsPipeline *owner;
+        PipelineStateKey key;
+        std::atomic<VariantState> state{VariantState::Compiling};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    struct Rebuild
+    {
+        GraphicsPipeline *pipeline;
+        GraphicsPipeline::Build build;
+        std::atomic<bool> done{false};
+        bool failed = false;
+    };
+
+    struct Retired
+    {
+        uint64_t frameNumber;
+        GraphicsPipeline *pipeline;
+        GraphicsPipeline::Build build;   // previous default pipeline, empty for a retired variant
+        std::unique_ptr<Variant> variant;
+    };
+
+    Variant *request(GraphicsPipeline &pipeline, const PipelineStateKey &key);
+    void compile(Variant *variant);
+
+    void loadWarmUpList(std::vector<PipelineStateKey> &keys) const;
+    void saveWarmUpList() const;
+
+    void retireVariants(GraphicsPipeline *pipeline, uint64_t frameNumber);
+    bool destroyRetired(Retired &entry);
+
+    VkDevice device = VK_NULL_HANDLE;
+    JobSystem *jobSystem = nullptr;
+    std::string warmUpPath;
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::unique_ptr<Variant>> variants;
+    std::vector<GraphicsPipeline *> pipelines;
+    std::atomic<uint32_t> pendingCount{0};
+
+    std::vector<std::unique_ptr<Rebuild>> rebuilds;
+    std::vector<Retired> retired;
+};
@@ -1,5 +1,12 @@
 #pragma once
 #include "graphicsPipeline.hpp"
+#include "vertexFormat.hpp"
+
+enum class PresentFilter
+{
+    Bilinear,    // one texture() read, shaders/present.frag or present_bindless.frag
+    EdgeAdaptive // shaders/present_upscale.frag, edge adaptive upscaling and contrast adaptive sharpening
+};
 
 class PresentPipeline : public GraphicsPipeline
 {
@@ -7,49 +14,48 @@ class PresentPipeline : public GraphicsPipeline
     virtual ShaderInfo getVertexShader() override;
     virtual ShaderInfo getFragmentShader() override;
 
-    virtual std::vector<VkVertexInputBindingDescription> getBindingDescription() override;
-    virtual std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() override; 
+    virtual VertexInputDescription getVertexInput() override;
 
 public:
     PresentPipeline() {}
     virtual ~PresentPipeline() {}
 
+    // Samples the render target from the bindless heap by a push constant index
+    // instead of a per frame descriptor set, has to be chosen before init()
+    void setBindless(bool _bindless) { bindless = _bindless; }
+    bool isBindless() const { return bindless && filter == PresentFilter::Bilinear; }
 
-    struct Vertex
+    // Has to be chosen before init() as well. The edge adaptive filter reads the render
+    // target through a descriptor set, bindless only applies to the bilinear one.
+    void setFilter(PresentFilter _filter) { filter = _filter; }
+    PresentFilter getFilter() const { return filter; }
+
+    // The scene covers only the top left part of the render target when it was drawn at a
+    // lower resolution, reads are clamped to the texel centers inside it
+    struct PushConstants
     {
-        glm::vec2 pos;
-        glm::vec2 texCoord;
+        float uvScale[2];
+        float uvMin[2];
+        float uvMax[2];
+        uint32_t textureIndex;
+        float sharpness; // 0 to 1, edge adaptive filter only
+    };
 
-        static VkVertexInputBindingDescription getBindingDescription()
-        {
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-            return bindingDescription;
-        }
+    struct Vertex
+    {
+        Snorm16x2 pos;
+        Unorm16x2 texCoord;
 
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions()
+        static Vertex make(glm::vec2 pos, glm::vec2 texCoord)
         {
-            std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-
-            attributeDescriptions.resize(2, {});
-
-
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
-
-            return attributeDescriptions;
+            return Vertex{VertexFormat::packSnorm16x2(pos), VertexFormat::packUnorm16x2(texCoord)};
         }
     };
 
+    using VertexDescription = VertexLayout<Vertex, VERTEX_FIELD(Vertex, pos), VERTEX_FIELD(Vertex, texCoord)>;
 
+private:
+    bool bindless = false;
+    PresentFilter filter = PresentFilter::Bilinear;
 };
@@ -1,13 +1,10 @@
 #pragma once
 
 #include <cstdint>
-#include <fstream>
-#include <functional>
 #include <vector>
 #include <optional>
 #include <Engine.hpp>
-
-struct QueueFamilyIndices;
+#include "deviceProfile.hpp"
 
 namespace __QueueFamilies_Impl
 {
@@ -18,69 +15,6 @@ namespace __QueueFamilies_Impl
         uint32_t queueIndex = 0;
     };
 
-    struct QueueFamilyOptions
-    {
-        std::vector<QueueFamilyIndex> onlyMatchRequiredQueues;
-        std::vector<QueueFamilyIndex> matchWithOptionalQueues;
-    };
-
-    struct Indices
-    {
-        uint32_t graphicsFamilyIndex = 0,
-                 computeFamilyIndex = 0,
-                 transferFamilyIndex = 0,
-                 presentFamilyIndex = 0;
-    };
-
-    struct QueueFamilyFindData {
-        std::string name = "";
-        QueueFamilyOptions options = {};
-        std::optional<QueueFamilyIndex>& output;
-        std::vector<QueueFamilyFindData*> incrementIfSame = {};
-        std::vector<QueueFamilyFindData*> noIncrementIfSame = {};
-        uint32_t queueFamilyIndex = 0;
-
-        QueueFamilyIndex& getQueueFamily() {
-            return queueFamilyOptions().at(queueFamilyIndex);
-        }
-
-        std::vector<QueueFamilyIndex> getIncrementIfSame() {
-            std::vector<QueueFamilyIndex> returnVal = {};
-            for (auto data : incrementIfSame)
-            {
-                returnVal.push_back(data->getQueueFamily());
-            }
-            return returnVal;
-        }
-
-        std::vector<QueueFamilyIndex>& queueFamilyOptions() {
-            return options.onlyMatchRequiredQueues.size() ? options.onlyMatchRequiredQueues : options.matchWithOptionalQueues;
-        }
-
-        uint32_t getFamily() {
-            return getQueueFamily().family;
-        }
-
-        bool canIncrement() {
-            return options.matchWithOptionalQueues.size() > queueFamilyIndex + 1;
-        }
-
-    };
-
-    QueueFamilyOptions findQueueFamily(
-        const std::vector<VkQueueFamilyProperties> &queueFamilies,
-        std::function<bool(VkQueueFamilyProperties, uint32_t index)> matchOnlyRequiredFlag,
-        std::function<bool(VkQueueFamilyProperties, uint32_t index)> matchOptionalFlag = [](VkQueueFamilyProperties, uint32_t)
-        { return false; });
-
-    QueueFamilyIndices findQueueFamilies(
-        VkPhysicalDevice device,
-        VkSurfaceKHR surface);
-
-    void tryIncrement(QueueFamilyIndices& indices, std::vector<QueueFamilyFindData*>& findData);
-    void tryIndices(QueueFamilyIndices& indices, std::vector<QueueFamilyFindData*>& findData);
-    uint32_t countEqual(QueueFamilyIndex a, std::vector<QueueFamilyIndex> b);
-
 } // namespace Impl
 
 struct QueueFamilyIndices
@@ -212,6 +146,36 @@ struct QueueFamilyIndices
     }
 };
 
+// One row per queue family of a device, everything the solver looks at
+struct QueueFamilyInfo
+{
+    VkQueueFlags queueFlags = 0;
+    uint32_t queueCount = 0;
+    bool presentSupport = false;
+};
+
+struct QueueFamilySolveStats
+{
+    uint32_t visited = 0;  // partial assignments tried
+    uint32_t memoHits = 0; // subtrees skipped, the same state had already failed
+};
+
+// The profiled families with their surface support, queried once per family
+std::vector<QueueFamilyInfo> queryQueueFamilyTable(
+    const DeviceProfile &profile,
+    VkSurfaceKHR surface);
+
+// Assigns graphics, compute, transfer and present to families of the table. Every role
+// prefers the family that also serves the fewest of the other roles, then the lower family
+// index, present prefers the graphics family. Roles are settled in that order and the
+// result is the first complete assignment in that preference order. Roles in one family
+// get their own queues, except present, which shares the graphics queue. Pure and
+// deterministic, the indices are incomplete when the families don't have enough queues.
+QueueFamilyIndices solveQueueFamilies(
+    const std::vector<QueueFamilyInfo> &table,
+    QueueFamilySolveStats *stats = nullptr);
+
+// Solved once per device and surface, later calls return the cached indices
 QueueFamilyIndices findQueueFamilies(
-    VkPhysicalDevice device,
+    const DeviceProfile &profile,
     VkSurfaceKHR surface);
\ No newline at end of file
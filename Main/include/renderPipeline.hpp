@@ -1,6 +1,15 @@
 #pragma once
 #include "graphicsPipeline.hpp"
 #include "buffer.hpp"
+#include "vertexFormat.hpp"
+
+// Pulling skips the fixed function vertex input and reads the packed vertices
+// from the geometry pool vertex buffer bound as a storage buffer.
+enum class VertexInputMode
+{
+    Attributes,
+    Pulling
+};
 
 struct RenderPipeline : public GraphicsPipeline
 {
@@ -8,11 +17,13 @@ struct RenderPipeline : public GraphicsPipeline
     virtual ShaderInfo getVertexShader() override;
     virtual ShaderInfo getFragmentShader() override;
 
-    virtual std::vector<VkVertexInputBindingDescription> getBindingDescription() override;
-    virtual std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() override;
+    virtual VertexInputDescription getVertexInput() override;
+
+    // Has to be created with a render pass that has a depth attachment
+    virtual VkPipelineDepthStencilStateCreateInfo getDepthStencilInfo() override;
 
 public:
-    RenderPipeline() {}
+    RenderPipeline(VertexInputMode vertexInputMode = VertexInputMode::Attributes) : vertexInputMode(vertexInputMode) {}
     virtual ~RenderPipeline() {}
 
     virtual void onCleanup(VmaAllocator allocator) {
@@ -24,44 +35,32 @@ public:
     }
 
 
+    // 16 bytes: quantized position, octahedral normal and unorm8 color
     struct Vertex
     {
-        glm::vec2 pos;
-        glm::vec3 color;
+        Snorm16x4 pos;
+        Snorm16x2 normal;
+        Unorm8x4 color;
 
-        static VkVertexInputBindingDescription getBindingDescription()
+        static Vertex make(glm::vec3 pos, glm::vec3 normal, glm::vec4 color)
         {
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-            return bindingDescription;
+            return Vertex{
+                VertexFormat::packPosition(pos),
+                VertexFormat::packOctahedral(normal),
+                VertexFormat::packColor(color)};
         }
+    };
 
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions()
-        {
-            std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-
-            attributeDescriptions.resize(2, {});
-
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, color);
+    using VertexDescription = VertexLayout<Vertex, VERTEX_FIELD(Vertex, pos), VERTEX_FIELD(Vertex, normal), VERTEX_FIELD(Vertex, color)>;
 
-            return attributeDescriptions;
-        }
-    };
+    static_assert(sizeof(Vertex) == 16, "simple_pull.vert reads vertices as uvec4");
 
     std::vector<UniformBuffer> uniformBuffers;
 
+    VertexInputMode getVertexInputMode() const { return vertexInputMode; }
+
 protected:
+    VertexInputMode vertexInputMode;
     VkDescriptorSetLayout descriptorSetLayout;
 
     struct UniformBufferObject {
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "mipGenerator.hpp"
+#include <memory>
+#include <vector>
+
+struct RenderTargetDesc
+{
+    VkExtent2D extent = {0, 0};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageUsageFlags usage = 0;
+    VkImageCreateFlags flags = 0;
+    uint32_t mipLevels = 1;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    bool transient = false; // only an attachment, never read after its render pass, may get lazily allocated memory
+
+    bool operator==(const RenderTargetDesc &other) const
+    {
+        return extent.width == other.extent.width && extent.height == other.extent.height && format == other.format &&
+               usage == other.usage && flags == other.flags && mipLevels == other.mipLevels && aspect == other.aspect &&
+               transient == other.transient;
+    }
+};
+
+// Contents are undefined after acquire(), the first pass writing it has to start from UNDEFINED
+struct RenderTarget
+{
+    RenderTargetDesc desc;
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;      // every level, for sampling
+    VkImageView attachmentView = VK_NULL_HANDLE; // level 0 only
+};
+
+struct RenderTargetPoolCreateInfo
+{
+    VkDevice device;
+    VmaAllocator allocator;
+    VmaPool pool = VK_NULL_HANDLE; // tried first for memory that isn't lazily allocated
+    MipGenerator *mipGenerator = nullptr; // told about destroyed images
+};
+
+// Render targets requested by description every frame. A target acquired in an earlier
+// frame with the same description is handed out again, so targets aren't duplicated per
+// frame in flight. Memory is allocated separately from images and aliased: a target
+// released during a frame, and every target of earlier frames, leaves its memory free for
+// targets of another description. acquire() records the barrier ordering the new target
+// after the previous user of its memory, frames in flight serialize on shared targets.
+// Transient targets use lazily allocated memory where the device has it.
+struct RenderTargetPool
+{
+    void init(const RenderTargetPoolCreateInfo &createInfo);
+    void cleanup();
+
+    // Once per frame before any acquire(), releases every target and destroys the ones
+    // no frame in flight has used
+    void update(uint64_t frameNumber, uint32_t framesInFlight);
+
+    const RenderTarget &acquire(VkCommandBuffer commandBuffer, const RenderTargetDesc &desc);
+
+    // The target isn't used for the rest of the frame, later acquires may alias its memory
+    void release(const RenderTarget &target);
+
+    // Cached until one of the targets is destroyed, sized to the first target
+    VkFramebuffer getFramebuffer(VkRenderPass renderPass, const std::vector<const RenderTarget *> &attachments);
+
+    // Destroys every target, only while the device is idle
+    void clear();
+
+    void printStatistics() const;
+
+private:
+    struct Memory
+    {
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize offset = 0;
+        uint32_t memoryType = 0;
+        bool lazy = false;
+        bool held = false; // bound to a target acquired and not released this frame
+        bool used = false; // written by an earlier target, the next one needs a barrier
+        uint32_t targetCount = 0;
+    };
+
+    struct Entry
+    {
+        RenderTarget target;
+        Memory *memory = nullptr;
+        uint64_t lastFrame = 0;
+        bool acquired = false;
+    };
+
+    struct Framebuffer
+    {
+        VkRenderPass renderPass;
+        std::vector<VkImageView> views;
+        VkFramebuffer framebuffer;
+    };
+
+    Entry &createEntry(const RenderTargetDesc &desc);
+    Memory *findMemory(const VkMemoryRequirements &requirements, bool transient) const;
+    Memory *allocateMemory(const VkMemoryRequirements &requirements, bool transient);
+    void destroyEntry(Entry &entry);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    VmaPool pool = VK_NULL_HANDLE;
+    MipGenerator *mipGenerator = nullptr;
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<std::unique_ptr<Memory>> memories;
+    std::vector<Framebuffer> framebuffers;
+    uint64_t frameNumber = 0;
+
+    uint64_t acquires = 0;
+    uint64_t imagesCreated = 0;
+    uint64_t aliasedImages = 0;
+    uint64_t lazyAllocations = 0;
+    VkDeviceSize peakBytes = 0;
+};
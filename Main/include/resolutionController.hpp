@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Engine.hpp"
+
+struct ResolutionControllerCreateInfo
+{
+    double targetMilliseconds = 1000.0 / 60.0; // GPU time a frame has to fit in
+    float minScale = 0.5f;                     // per axis of the output extent
+    float maxScale = 1.0f;
+    uint32_t settleFrames = 8; // frames to wait after a change, earlier timings were rendered at the old scale
+};
+
+// Picks the resolution the scene renders at from the GPU time of finished frames. Frame
+// time is taken as proportional to the pixel count, the scale drops quickly when the frame
+// goes over budget and climbs back slowly. The render target is only reallocated when the
+// render extent outgrows it or falls far below it, in between the scene is drawn into the
+// top left corner of the target and the present pass upscales only that part.
+struct ResolutionController
+{
+    void init(const ResolutionControllerCreateInfo &createInfo);
+
+    // Swapchain extent the scene is upscaled to, reallocates the target at the current scale
+    void setOutputExtent(VkExtent2D extent);
+
+    // With the GPU time of every frame read back
+    void update(double gpuMilliseconds);
+
+    float getScale() const { return scale; }
+    VkExtent2D getRenderExtent() const { return renderExtent; } // drawn area of the target
+    VkExtent2D getTargetExtent() const { return targetExtent; }
+
+    void printStatistics() const;
+
+private:
+    VkExtent2D scaleExtent(float _scale) const;
+    void resize();
+
+    ResolutionControllerCreateInfo info = {};
+    VkExtent2D outputExtent = {0, 0};
+    VkExtent2D renderExtent = {0, 0};
+    VkExtent2D targetExtent = {0, 0};
+    float scale = 1.0f;
+
+    double averageMilliseconds = 0.0;
+    uint32_t framesSinceChange = 0;
+
+    uint64_t frames = 0;
+    uint64_t framesOverBudget = 0;
+    uint64_t scaleChanges = 0;
+    uint64_t targetResizes = 0;
+    float lowestScale = 1.0f;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <mutex>
+#include <unordered_map>
+
+// Samplers are immutable and limited in number (maxSamplerAllocationCount), identical
+// create infos share one. The cache owns the samplers, callers never destroy them.
+struct SamplerCache
+{
+    void init(VkDevice device);
+    void cleanup();
+
+    // pNext chains aren't part of the key and must be null
+    VkSampler get(const VkSamplerCreateInfo &createInfo);
+
+    size_t size() const;
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, std::pair<VkSamplerCreateInfo, VkSampler>> samplers;
+};
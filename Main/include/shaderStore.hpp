@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "assetArchive.hpp"
+#include "spirvReflect.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shader modules shared between pipelines. SPIR-V is read through a file mapping, or
+// taken from the asset archive or the executable when built with --embed-shaders, and
+// modules are deduplicated by content hash. A module lives until the last pipeline releases it.
+// Every module is reflected once when it's created.
+struct ShaderStore
+{
+    // Shaders found in archive are created straight from its mapped pages
+    void init(VkDevice device, const AssetArchive *archive = nullptr);
+
+    // Destroys modules that were never released, those are reported as leaks
+    void cleanup();
+
+    // Safe to call from any thread, every acquire or retain needs a matching release.
+    // reload reads the file even when the path is resident, for shaders changed on disk.
+    VkShaderModule acquire(const std::string &path, bool reload = false);
+    void retain(VkShaderModule module);
+    void release(VkShaderModule module);
+
+    ShaderReflection getReflection(VkShaderModule module) const;
+
+    void printStatistics() const;
+
+private:
+    struct Module
+    {
+        VkShaderModule module;
+        uint32_t references;
+        ShaderReflection reflection;
+        std::vector<uint32_t> code; // compared on a hash hit, collisions throw
+    };
+
+    VkShaderModule acquireCode(const std::string &path, const void *code, size_t size);
+
+    VkDevice device = VK_NULL_HANDLE;
+    const AssetArchive *archive = nullptr;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Module> modules;            // by content hash
+    std::unordered_map<std::string, uint64_t> paths;         // paths of resident modules, skips the file on repeated acquires
+    std::unordered_map<VkShaderModule, uint64_t> moduleHashes;
+
+    uint32_t filesRead = 0;
+    uint32_t modulesCreated = 0;
+    uint32_t acquireCount = 0;
+};
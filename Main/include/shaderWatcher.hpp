@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files in the compiled shader directory that were rewritten, so the premake
+// glslc step (or a manual glslc run) is enough to get new SPIR-V into a running app.
+// Uses inotify on Linux and falls back to polling modification times elsewhere.
+struct ShaderWatcher
+{
+    void init(const std::string &directory);
+    void cleanup();
+
+    // Non blocking, returns "directory/name" for every file changed since the last call
+    std::vector<std::string> poll();
+
+private:
+    std::string directory;
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    int watchDescriptor = -1;
+#else
+    std::unordered_map<std::string, std::chrono::nanoseconds> modificationTimes;
+    std::chrono::steady_clock::time_point lastScan;
+#endif
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ReflectedBinding
+{
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    uint32_t count; // 0 for runtime sized arrays
+};
+
+struct ReflectedInput
+{
+    uint32_t location;
+    VkFormat format; // 32 bit per component, what the shader declares, not what the buffer holds
+};
+
+// The interface of one entry point, as far as layouts and vertex input care
+struct ShaderReflection
+{
+    VkShaderStageFlagBits stage;
+    std::string entryPoint;
+    std::vector<ReflectedBinding> bindings;
+    uint32_t pushConstantSize = 0;
+    std::vector<ReflectedInput> inputs; // vertex stage only
+};
+
+// Just enough of a SPIR-V parser for the reflection above, no external dependency
+namespace SpirvReflect
+{
+    ShaderReflection reflect(const uint32_t *code, size_t wordCount);
+
+    // Whether an attribute format feeds a shader input of the given format: same numeric
+    // class (float, signed, unsigned). Normalized formats count as float.
+    bool isCompatibleVertexFormat(VkFormat shaderFormat, VkFormat attributeFormat);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "bindlessHeap.hpp"
+#include "jobSystem.hpp"
+#include "mipGenerator.hpp"
+#include "samplerCache.hpp"
+#include "textureTranscoder.hpp"
+#include "uploadManager.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using TextureHandle = uint32_t;
+
+struct TextureStreamerCreateInfo
+{
+    VkDevice device;
+    VmaAllocator allocator;
+    JobSystem *jobSystem;
+    UploadManager *uploadManager;
+    SamplerCache *samplerCache;
+    BindlessHeap *bindlessHeap = nullptr; // textures get a heap slot when set
+    MipGenerator *mipGenerator = nullptr; // only level 0 of RGBA8 textures is uploaded when set, the rest is generated on the GPU
+    TextureFormats formats = {};          // what textures are transcoded to, RGBA8 unless filled in
+    std::vector<uint32_t> queueFamilyIndices = {}; // families sampling or uploading textures
+    VkDeviceSize uploadBudget = 8ull * 1024 * 1024; // bytes staged per update
+};
+
+// Textures are decoded on the job system and streamed in one mip level at a time,
+// smallest level first, so they can be drawn as soon as the 1x1 level is resident. Levels
+// larger than a quarter of the staging ring are split into bands of rows over several updates.
+// Which texture gets the next level is decided by how much it is magnified on
+// screen, given by setScreenSize(). Decoding transcodes to the block compressed format
+// the device supports, see TextureTranscoder. With a mip generator uncompressed textures
+// arrive at once instead, one level 0 upload and a generated chain skip the CPU mips.
+struct TextureStreamer
+{
+    // What to sample, views only cover the resident levels and change as more arrive
+    struct View
+    {
+        VkImageView imageView = VK_NULL_HANDLE;
+        VkSampler sampler = VK_NULL_HANDLE;
+        uint32_t bindlessIndex = BindlessHeap::invalidIndex;
+        uint32_t residentMip = 0;
+        bool ready = false;
+    };
+
+    void init(const TextureStreamerCreateInfo &createInfo);
+    void cleanup();
+
+    // Starts decoding right away, the texture stays not ready until its first level arrived
+    TextureHandle load(const std::string &path);
+
+    // Largest on screen dimension in pixels, 0 stops streaming more levels in for it
+    void setScreenSize(TextureHandle handle, float pixels);
+
+    void update(uint64_t frameNumber, uint32_t framesInFlight);
+
+    View get(TextureHandle handle) const;
+
+    void printStatistics() const;
+
+private:
+    enum class State
+    {
+        Decoding,
+        Streaming,
+        Resident,
+        Failed
+    };
+
+    struct Texture
+    {
+        std::string path;
+        State state = State::Decoding;
+        float screenSize = -1.0f; // negative until set, streams everything
+
+        TextureData data;
+        VkImage image = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        uint32_t mipCount = 0; // levels of the image, more than decoded when they are generated
+        bool generateMips = false;
+        uint32_t residentMip = 0; // decoded level count while nothing is resident
+        uint32_t stagedRows = 0;  // rows of the next level staged so far, levels go in bands
+        bool uploading = false;
+
+        View view;
+    };
+
+    struct Retired
+    {
+        VkImageView imageView;
+        uint64_t frameNumber;
+    };
+
+    void createImage(Texture &texture);
+    uint32_t getDesiredMip(const Texture &texture) const;
+    VkDeviceSize streamNextBand(TextureHandle handle);
+    void onMipResident(TextureHandle handle, uint32_t mip);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    JobSystem *jobSystem = nullptr;
+    UploadManager *uploadManager = nullptr;
+    SamplerCache *samplerCache = nullptr;
+    BindlessHeap *bindlessHeap = nullptr;
+    MipGenerator *mipGenerator = nullptr;
+    TextureFormats formats;
+    std::vector<uint32_t> queueFamilyIndices;
+    VkDeviceSize uploadBudget = 0;
+
+    std::vector<std::unique_ptr<Texture>> textures;
+    std::vector<Retired> retired;
+    uint64_t frameNumber = 0;
+
+    // Filled by decode jobs, drained by update()
+    std::mutex decodedMutex;
+    std::vector<std::pair<TextureHandle, TextureData>> decoded;
+    std::vector<TextureHandle> failed;
+
+    uint64_t bytesStreamed = 0;
+    uint64_t bytesUncompressed = 0; // what the streamed levels would have been as RGBA8
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "deviceProfile.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texel data ready to be copied into an image of the given format, mips[0] is the full
+// resolution level. Block compressed levels are stored block row by block row.
+struct TextureData
+{
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> mips;
+
+    uint32_t getMipCount() const { return static_cast<uint32_t>(mips.size()); }
+    uint32_t getMipWidth(uint32_t mip) const { return width >> mip ? width >> mip : 1; }
+    uint32_t getMipHeight(uint32_t mip) const { return height >> mip ? height >> mip : 1; }
+};
+
+// What the device can sample. opaque and alpha are the formats images get transcoded to,
+// R8G8B8A8 when the device has no usable BC formats.
+struct TextureFormats
+{
+    VkFormat opaque = VK_FORMAT_R8G8B8A8_SRGB;
+    VkFormat alpha = VK_FORMAT_R8G8B8A8_SRGB;
+    std::vector<VkFormat> supported; // block compressed formats KTX2 levels can be copied in as they are
+
+    // Compressed formats only count when their feature is in enabledFeatures
+    static TextureFormats query(const DeviceProfile &profile, const VkPhysicalDeviceFeatures &enabledFeatures);
+
+    bool isSupported(VkFormat format) const;
+};
+
+// Loads KTX2 containers and regular images, transcoding RGBA8 texels to the block format
+// picked in TextureFormats on the calling thread. Meant to run on the job system.
+// KTX2 files have to be stored without supercompression, BasisLZ and Zstd aren't decoded.
+namespace TextureTranscoder
+{
+    bool isBlockCompressed(VkFormat format);
+
+    // Without cpuMips, textures that stay RGBA8 only get level 0 so the chain can be
+    // generated on the GPU. Block compressed textures always get the full chain.
+    TextureData load(const std::string &path, const TextureFormats &formats, bool cpuMips);
+}
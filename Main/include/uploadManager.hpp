@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "buffer.hpp"
+#include <deque>
+#include <functional>
+#include <vector>
+
+struct UploadManagerCreateInfo
+{
+    VkDevice device;
+    VmaAllocator allocator;
+    VkQueue transferQueue;
+    uint32_t transferFamily;
+    VkDeviceSize stagingSize = 32ull * 1024 * 1024;
+    VmaPool stagingPool = VK_NULL_HANDLE;
+};
+
+// Batches copies from a persistently mapped staging ring into device local resources
+// on the transfer queue without waiting for them. Copies recorded during a frame go out
+// in one submit, completion is polled with a fence per batch and reported through
+// callbacks on the thread calling update(). Destinations must be shared with the
+// graphics family (VK_SHARING_MODE_CONCURRENT) since no ownership transfer is recorded.
+struct UploadManager
+{
+    using Callback = std::function<void()>;
+
+    void init(const UploadManagerCreateInfo &createInfo);
+    void cleanup();
+
+    // Copies data into the staging ring, returns false when the ring is full until
+    // earlier batches complete. offset receives the ring offset to copy from.
+    bool stage(const void *data, VkDeviceSize size, VkDeviceSize &offset, VkDeviceSize alignment = 16);
+
+    void copyToBuffer(VkDeviceSize stagingOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+    // Leaves the mip level in SHADER_READ_ONLY_OPTIMAL, levels not written keep their layout
+    void copyToImage(VkDeviceSize stagingOffset, VkImage dstImage, uint32_t mipLevel, VkExtent3D extent, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Writes the rows starting at y of a level levelHeight rows high, for levels larger than
+    // the ring. Bands go in top to bottom: the first one discards the level's contents, the
+    // level stays in TRANSFER_DST_OPTIMAL until the last one moves it to SHADER_READ_ONLY_OPTIMAL.
+    void copyToImageRows(VkDeviceSize stagingOffset, VkImage dstImage, uint32_t mipLevel, uint32_t y, VkExtent3D extent, uint32_t levelHeight,
+                         VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Runs once the copies recorded so far have executed
+    void onComplete(Callback callback);
+
+    // Submits what was recorded since the last submit, nothing happens for an empty batch
+    void submit();
+
+    // Retires finished batches, frees their staging space and runs their callbacks
+    void update();
+
+    // Blocks until everything submitted so far finished
+    void flush();
+
+    VkDeviceSize getStagingSize() const { return stagingSize; }
+    void printStatistics() const;
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t ringEnd = 0;
+        std::vector<Callback> callbacks;
+    };
+
+    Batch &getRecordingBatch();
+    void retire(Batch &batch);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    StagingBuffer stagingBuffer = {};
+    uint8_t *stagingData = nullptr;
+    VkDeviceSize stagingSize = 0;
+
+    // Only grow until the ring drains, the ring offset is position % stagingSize
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+    bool recording = false;
+    Batch recordingBatch;
+    std::deque<Batch> pendingBatches;
+    std::vector<Batch> freeBatches;
+
+    uint64_t bytesUploaded = 0;
+    uint64_t batchesSubmitted = 0;
+    uint64_t stagingStalls = 0;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Quantized vertex components, laid out exactly as the matching VkFormat
+struct Snorm16x2
+{
+    int16_t x, y;
+};
+
+struct Snorm16x4
+{
+    int16_t x, y, z, w;
+};
+
+struct Unorm16x2
+{
+    uint16_t x, y;
+};
+
+struct Unorm8x4
+{
+    uint8_t r, g, b, a;
+};
+
+namespace VertexFormat
+{
+    inline int16_t packSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    inline uint16_t packUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    inline uint8_t packUnorm8(float value)
+    {
+        return static_cast<uint8_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    inline float unpackSnorm16(int16_t value)
+    {
+        return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+    }
+
+    // Positions have to be in [-1, 1], see dequantization() for meshes that don't fit
+    inline Snorm16x4 packPosition(glm::vec3 position)
+    {
+        return {packSnorm16(position.x), packSnorm16(position.y), packSnorm16(position.z), 0};
+    }
+
+    inline glm::vec3 unpackPosition(Snorm16x4 packed)
+    {
+        return glm::vec3(unpackSnorm16(packed.x), unpackSnorm16(packed.y), unpackSnorm16(packed.z));
+    }
+
+    inline Snorm16x2 packSnorm16x2(glm::vec2 value)
+    {
+        return {packSnorm16(value.x), packSnorm16(value.y)};
+    }
+
+    inline Unorm16x2 packUnorm16x2(glm::vec2 value)
+    {
+        return {packUnorm16(value.x), packUnorm16(value.y)};
+    }
+
+    inline Unorm8x4 packColor(glm::vec4 color)
+    {
+        return {packUnorm8(color.r), packUnorm8(color.g), packUnorm8(color.b), packUnorm8(color.a)};
+    }
+
+    // Octahedral normal encoding, a unit vector in two snorm16
+    inline Snorm16x2 packOctahedral(glm::vec3 normal)
+    {
+        normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+        glm::vec2 encoded(normal.x, normal.y);
+        if (normal.z < 0.0f)
+        {
+            encoded = glm::vec2(
+                (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f));
+        }
+
+        return packSnorm16x2(encoded);
+    }
+
+    inline glm::vec3 unpackOctahedral(Snorm16x2 packed)
+    {
+        glm::vec2 encoded(unpackSnorm16(packed.x), unpackSnorm16(packed.y));
+        glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+
+        float t = std::max(-normal.z, 0.0f);
+        normal.x += normal.x >= 0.0f ? -t : t;
+        normal.y += normal.y >= 0.0f ? -t : t;
+
+        return glm::normalize(normal);
+    }
+
+    // Meshes are quantized relative to their bounding box, this matrix maps the
+    // snorm16 [-1, 1] cube back to object space and is folded into the model matrix.
+    inline glm::mat4 dequantization(glm::vec3 boundsCenter, glm::vec3 boundsExtent)
+    {
+        return glm::scale(glm::translate(glm::mat4(1.0f), boundsCenter), boundsExtent);
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Engine.hpp"
+#include "hash.hpp"
+#include "vertexFormat.hpp"
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// Maps a vertex member type to the VkFormat the vertex input reads it as
+template <typename T>
+struct VertexFormatOf;
+
+template <>
+struct VertexFormatOf<float>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT;
+};
+
+template <>
+struct VertexFormatOf<glm::vec2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT;
+};
+
+template <>
+struct VertexFormatOf<glm::vec3>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT;
+};
+
+template <>
+struct VertexFormatOf<glm::vec4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT;
+};
+
+template <>
+struct VertexFormatOf<Snorm16x2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16_SNORM;
+};
+
+template <>
+struct VertexFormatOf<Snorm16x4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_SNORM;
+};
+
+template <>
+struct VertexFormatOf<Unorm16x2>
+{
+    static constexpr VkFormat value = VK_FORMAT_R16G16_UNORM;
+};
+
+template <>
+struct VertexFormatOf<Unorm8x4>
+{
+    static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UNORM;
+};
+
+template <typename Field, size_t Offset>
+struct VertexField
+{
+    static constexpr VkFormat format = VertexFormatOf<Field>::value;
+    static constexpr uint32_t offset = static_cast<uint32_t>(Offset);
+};
+
+// Has to be used once Vertex is complete, offsetof doesn't work inside its own definition
+#define VERTEX_FIELD(Vertex, member) VertexField<decltype(Vertex::member), offsetof(Vertex, member)>
+
+// Binding and attribute descriptions generated at compile time from a field list,
+// locations follow the order of the fields.
+template <typename Vertex, typename... Fields>
+struct VertexLayout
+{
+private:
+    // Helpers come first, the constexpr members below are evaluated in declaration order
+    template <size_t... Locations>
+    static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Fields)> makeAttributeDescriptions(std::index_sequence<Locations...>)
+    {
+        return {{VkVertexInputAttributeDescription{static_cast<uint32_t>(Locations), 0, Fields::format, Fields::offset}...}};
+    }
+
+    static constexpr uint64_t makeHash()
+    {
+        uint64_t result = Hash::combine(Hash::offsetBasis, sizeof(Vertex));
+        for (const auto &attribute : makeAttributeDescriptions(std::index_sequence_for<Fields...>{}))
+        {
+            result = Hash::combine(result, attribute.location);
+            result = Hash::combine(result, static_cast<uint64_t>(attribute.format));
+            result = Hash::combine(result, attribute.offset);
+        }
+        return result;
+    }
+
+public:
+    static constexpr uint32_t attributeCount = sizeof...(Fields);
+
+    static constexpr VkVertexInputBindingDescription bindingDescription = {
+        0,
+        static_cast<uint32_t>(sizeof(Vertex)),
+        VK_VERTEX_INPUT_RATE_VERTEX};
+
+    static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Fields)> attributeDescriptions =
+        makeAttributeDescriptions(std::index_sequence_for<Fields...>{});
+
+    static constexpr uint64_t hash = makeHash();
+};
+
+// Non owning view over a VertexLayout, what GraphicsPipeline consumes
+struct VertexInputDescription
+{
+    const VkVertexInputBindingDescription *bindings = nullptr;
+    uint32_t bindingCount = 0;
+    const VkVertexInputAttributeDescription *attributes = nullptr;
+    uint32_t attributeCount = 0;
+    uint64_t hash = 0;
+
+    template <typename Layout>
+    static constexpr VertexInputDescription of()
+    {
+        return VertexInputDescription{
+            &Layout::bindingDescription,
+            1,
+            Layout::attributeDescriptions.data(),
+            Layout::attributeCount,
+            Layout::hash};
+    }
+};
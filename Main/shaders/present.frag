@@ -2,10 +2,20 @@
 
 layout(binding = 0) uniform sampler2D texSampler;
 
+// PresentPipeline::PushConstants
+layout(push_constant) uniform PushConstants {
+    vec2 uvScale;
+    vec2 uvMin;
+    vec2 uvMax;
+    uint textureIndex;
+    float sharpness;
+} pushConstants;
+
 layout(location = 0) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    vec2 uv = clamp(fragTexCoord * pushConstants.uvScale, pushConstants.uvMin, pushConstants.uvMax);
+    outColor = texture(texSampler, uv);
 }
\ No newline at end of file
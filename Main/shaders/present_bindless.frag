@@ -0,0 +1,23 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// BindlessHeap::set, BindlessHeap::textureBinding
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// PresentPipeline::PushConstants
+layout(push_constant) uniform PushConstants {
+    vec2 uvScale;
+    vec2 uvMin;
+    vec2 uvMax;
+    uint textureIndex;
+    float sharpness;
+} pushConstants;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 uv = clamp(fragTexCoord * pushConstants.uvScale, pushConstants.uvMin, pushConstants.uvMax);
+    outColor = texture(textures[pushConstants.textureIndex], uv);
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#version 450
+
+// Edge adaptive upscaling followed by contrast adaptive sharpening, both in the one present
+// pass. The 12 texels around the sample are filtered with a Lanczos-like kernel that is
+// stretched along the local edge and squeezed across it, so edges stay sharp without the
+// staircase of a separable filter. The result is sharpened against its neighbors by an
+// amount that falls off where the local contrast is already high.
+
+layout(binding = 0) uniform sampler2D texSampler;
+
+// PresentPipeline::PushConstants
+layout(push_constant) uniform PushConstants {
+    vec2 uvScale;
+    vec2 uvMin;
+    vec2 uvMax;
+    uint textureIndex;
+    float sharpness;
+} pushConstants;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+ivec2 maxTexel;
+
+vec3 fetch(ivec2 texel) {
+    return texelFetch(texSampler, clamp(texel, ivec2(0), maxTexel), 0).rgb;
+}
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+// Lanczos 2 approximated by polynomials, lobe sets how far the negative lobe reaches
+float kernel(vec2 offset, float lobe) {
+    float d2 = min(dot(offset, offset), 1.0 / lobe);
+    float wB = 0.4 * d2 - 1.0;
+    float wA = lobe * d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0 / 16.0 * wB - (25.0 / 16.0 - 1.0);
+    return wB * wA;
+}
+
+void main() {
+    vec2 textureExtent = vec2(textureSize(texSampler, 0));
+    vec2 uv = clamp(fragTexCoord * pushConstants.uvScale, pushConstants.uvMin, pushConstants.uvMax);
+    maxTexel = ivec2(pushConstants.uvMax * textureExtent);
+
+    vec2 position = uv * textureExtent - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    // 4x4 neighborhood around the sample, the corners are only read for the gradients
+    vec3 colors[16];
+    float lumas[16];
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            colors[y * 4 + x] = fetch(base + ivec2(x - 1, y - 1));
+            lumas[y * 4 + x] = luma(colors[y * 4 + x]);
+        }
+    }
+
+    // Gradients of the 4 texels around the sample, bilinearly weighted. A single straight
+    // edge gives gradients that agree, noise gives short or cancelling ones.
+    vec2 gradient = vec2(0.0);
+    float gradientLength = 0.0;
+    for (int y = 1; y <= 2; y++) {
+        for (int x = 1; x <= 2; x++) {
+            int i = y * 4 + x;
+            vec2 g = vec2(lumas[i + 1] - lumas[i - 1], lumas[i + 4] - lumas[i - 4]);
+            float w = (x == 1 ? 1.0 - f.x : f.x) * (y == 1 ? 1.0 - f.y : f.y);
+            gradient += g * w;
+            gradientLength += length(g) * w;
+        }
+    }
+
+    float edge = gradientLength > 1.0 / 256.0 ? length(gradient) / gradientLength : 0.0;
+    edge *= edge;
+
+    vec2 across = length(gradient) > 1.0 / 1024.0 ? normalize(gradient) : vec2(1.0, 0.0);
+    vec2 along = vec2(-across.y, across.x);
+
+    // Diagonal edges get the most stretch, the kernel footprint stays square-ish
+    float stretch = 1.0 / max(abs(across.x), abs(across.y));
+    vec2 scale = vec2(1.0 + (stretch - 1.0) * edge, 1.0 - 0.5 * edge);
+    float lobe = 0.5 - 0.29 * edge;
+
+    vec3 color = vec3(0.0);
+    float weight = 0.0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            if ((x == 0 || x == 3) && (y == 0 || y == 3))
+                continue;
+
+            vec2 offset = vec2(x - 1, y - 1) - f;
+            float w = kernel(vec2(dot(offset, across), dot(offset, along)) * scale, lobe);
+            color += colors[y * 4 + x] * w;
+            weight += w;
+        }
+    }
+    color /= weight;
+
+    // The negative lobes ring, nothing leaves the range of the 4 nearest texels
+    vec3 nearestMin = min(min(colors[5], colors[6]), min(colors[9], colors[10]));
+    vec3 nearestMax = max(max(colors[5], colors[6]), max(colors[9], colors[10]));
+    color = clamp(color, nearestMin, nearestMax);
+
+    // Contrast adaptive sharpening against the cross around the nearest texel
+    ivec2 nearest = base + ivec2(round(f));
+    vec3 north = fetch(nearest + ivec2(0, -1));
+    vec3 south = fetch(nearest + ivec2(0, 1));
+    vec3 west = fetch(nearest + ivec2(-1, 0));
+    vec3 east = fetch(nearest + ivec2(1, 0));
+
+    vec3 crossMin = min(min(min(north, south), min(west, east)), color);
+    vec3 crossMax = max(max(max(north, south), max(west, east)), color);
+    vec3 amount = sqrt(clamp(min(crossMin, 1.0 - crossMax) / max(crossMax, 1.0 / 256.0), 0.0, 1.0));
+    vec3 w = amount * mix(-0.125, -0.2, pushConstants.sharpness);
+
+    // Clamped to the neighborhood like the upscale, sharpened edges don't get halos
+    color = (color + (north + south + west + east) * w) / (1.0 + 4.0 * w);
+    color = clamp(color, crossMin, crossMax);
+
+    outColor = vec4(color, 1.0);
+}
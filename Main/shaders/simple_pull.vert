@@ -0,0 +1,25 @@
+#version 450
+
+// Same packed layout as RenderPipeline::Vertex:
+// x = pos.xy (snorm16), y = pos.zw (snorm16), z = octahedral normal (snorm16), w = color (unorm8)
+layout(std430, binding = 1) readonly buffer Vertices {
+    uvec4 vertices[];
+};
+
+layout (location = 0) out vec3 fragColor;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+void main() {
+    uvec4 vertex = vertices[gl_VertexIndex];
+
+    vec3 position = vec3(unpackSnorm2x16(vertex.x), unpackSnorm2x16(vertex.y).x);
+    vec4 color = unpackUnorm4x8(vertex.w);
+
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+    fragColor = color.rgb;
+}
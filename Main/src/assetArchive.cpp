@@ -0,0 +1,271 @@
+#include "assetArchive.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct ArchiveHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t namesSize;
+        uint64_t sourceHash;
+    };
+
+    struct ArchiveEntry
+    {
+        uint64_t nameHash;
+        uint32_t nameOffset; // into the names following the index
+        uint32_t nameLength;
+        AssetType type;
+        uint32_t reserved;
+        uint64_t offset; // from the start of the file, a multiple of AssetArchive::blobAlignment
+        uint64_t size;
+    };
+
+    struct MeshHeader
+    {
+        uint32_t vertexCount;
+        uint32_t vertexStride;
+        uint32_t indexCount;
+        uint32_t indexOffset; // from the start of the blob, vertices follow the header
+    };
+
+    constexpr uint32_t archiveMagic = 0x4B504B56; // "VKPK"
+    constexpr uint32_t archiveVersion = 2;
+    constexpr uint64_t meshVertexOffset = 16;
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool AssetArchive::open(const std::string &path)
+{
+    close();
+
+    if (!file.open(path))
+        return false;
+
+    const uint8_t *data = static_cast<const uint8_t *>(file.data());
+    uint64_t fileSize = file.size();
+
+    ArchiveHeader header;
+    if (fileSize < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    uint64_t indexEnd = sizeof(header) + static_cast<uint64_t>(header.entryCount) * sizeof(ArchiveEntry);
+    if (header.magic != archiveMagic || header.version != archiveVersion || header.fileSize != fileSize || indexEnd + header.namesSize > fileSize)
+    {
+        std::cerr << "Discarding invalid asset archive: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // Checked once here so lookups can trust every entry
+    const ArchiveEntry *entries = reinterpret_cast<const ArchiveEntry *>(data + sizeof(header));
+    for (uint32_t i = 0; i < header.entryCount; i++)
+    {
+        const ArchiveEntry &entry = entries[i];
+        if (entry.nameOffset + static_cast<uint64_t>(entry.nameLength) > header.namesSize || entry.offset % blobAlignment != 0 ||
+            entry.offset > fileSize || entry.size > fileSize - entry.offset)
+        {
+            std::cerr << "Discarding invalid asset archive: " << path << std::endl;
+            close();
+            return false;
+        }
+    }
+    index = entries;
+    entryCount = header.entryCount;
+    sourceHash = header.sourceHash;
+
+    // The blobs are read front to back, get the disk going before the first one is touched
+    file.prefetch();
+    return true;
+}
+
+void AssetArchive::close()
+{
+    file.close();
+    index = nullptr;
+    entryCount = 0;
+    sourceHash = 0;
+}
+
+const void *AssetArchive::find(const std::string &name, AssetType type, size_t &size) const
+{
+    size = 0;
+    if (!isOpen())
+        return nullptr;
+
+    const uint8_t *data = static_cast<const uint8_t *>(file.data());
+    const ArchiveEntry *entries = static_cast<const ArchiveEntry *>(index);
+    const char *names = reinterpret_cast<const char *>(entries + entryCount);
+    uint64_t hash = Hash::fnv1a(name.c_str());
+
+    const ArchiveEntry *end = entries + entryCount;
+    const ArchiveEntry *it = std::lower_bound(entries, end, hash, [](const ArchiveEntry &entry, uint64_t value) {
+        return entry.nameHash < value;
+    });
+
+    for (; it != end && it->nameHash == hash; ++it)
+    {
+        if (it->type != type || it->nameLength != name.size() || std::memcmp(names + it->nameOffset, name.data(), name.size()) != 0)
+            continue;
+
+        size = static_cast<size_t>(it->size);
+        return data + it->offset;
+    }
+
+    return nullptr;
+}
+
+bool AssetArchive::findMesh(const std::string &name, MeshAsset &mesh) const
+{
+    size_t size;
+    const uint8_t *data = static_cast<const uint8_t *>(find(name, AssetType::Mesh, size));
+    if (data == nullptr || size < sizeof(MeshHeader))
+        return false;
+
+    MeshHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    uint64_t vertexSize = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+    uint64_t indexSize = static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t);
+    if (meshVertexOffset + vertexSize > header.indexOffset || header.indexOffset % sizeof(uint32_t) != 0 || header.indexOffset + indexSize > size)
+        return false;
+
+    mesh.vertices = data + meshVertexOffset;
+    mesh.vertexCount = header.vertexCount;
+    mesh.vertexStride = header.vertexStride;
+    mesh.indices = reinterpret_cast<const uint32_t *>(data + header.indexOffset);
+    mesh.indexCount = header.indexCount;
+    return true;
+}
+
+void AssetArchiveWriter::add(const std::string &name, AssetType type, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    assets.push_back({name, type, std::vector<uint8_t>(bytes, bytes + size)});
+}
+
+void AssetArchiveWriter::addMesh(const std::string &name, const void *vertices, uint32_t vertexCount, uint32_t vertexStride,
+                                 const uint32_t *indices, uint32_t indexCount)
+{
+    size_t vertexSize = static_cast<size_t>(vertexCount) * vertexStride;
+    size_t indexSize = static_cast<size_t>(indexCount) * sizeof(uint32_t);
+
+    MeshHeader header = {};
+    header.vertexCount = vertexCount;
+    header.vertexStride = vertexStride;
+    header.indexCount = indexCount;
+    header.indexOffset = static_cast<uint32_t>(alignUp(meshVertexOffset + vertexSize, sizeof(uint32_t)));
+
+    std::vector<uint8_t> data(header.indexOffset + indexSize);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + meshVertexOffset, vertices, vertexSize);
+    std::memcpy(data.data() + header.indexOffset, indices, indexSize);
+
+    assets.push_back({name, AssetType::Mesh, std::move(data)});
+}
+
+bool AssetArchiveWriter::addFile(const std::string &name, AssetType type, const std::string &path)
+{
+    MappedFile source;
+    if (!source.open(path))
+        return false;
+
+    add(name, type, source.data(), source.size());
+    return true;
+}
+
+bool AssetArchiveWriter::write(const std::string &path) const
+{
+    std::vector<ArchiveEntry> entries(assets.size());
+    std::string names;
+
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        entries[i].nameHash = Hash::fnv1a(assets[i].name.c_str());
+        entries[i].nameOffset = static_cast<uint32_t>(names.size());
+        entries[i].nameLength = static_cast<uint32_t>(assets[i].name.size());
+        entries[i].type = assets[i].type;
+        entries[i].reserved = 0;
+        entries[i].size = assets[i].data.size();
+        names += assets[i].name;
+    }
+
+    // Blobs in the order they were added, the index sorted for lookups
+    uint64_t offset = alignUp(sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry) + names.size(), AssetArchive::blobAlignment);
+    for (auto &entry : entries)
+    {
+        entry.offset = offset;
+        offset = alignUp(offset + entry.size, AssetArchive::blobAlignment);
+    }
+
+    std::vector<size_t> order(assets.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].nameHash < entries[b].nameHash; });
+
+    ArchiveHeader header = {};
+    header.magic = archiveMagic;
+    header.version = archiveVersion;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.fileSize = offset;
+    header.namesSize = names.size();
+    header.sourceHash = sourceHash;
+
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!output.is_open())
+        {
+            std::cerr << "Failed to write asset archive: " << temporaryPath << std::endl;
+            return false;
+        }
+
+        output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (size_t i : order)
+            output.write(reinterpret_cast<const char *>(&entries[i]), sizeof(entries[i]));
+        output.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+        uint64_t position = sizeof(header) + entries.size() * sizeof(ArchiveEntry) + names.size();
+        static const char padding[AssetArchive::blobAlignment] = {};
+
+        for (size_t i = 0; i < assets.size(); i++)
+        {
+            output.write(padding, static_cast<std::streamsize>(entries[i].offset - position));
+            output.write(reinterpret_cast<const char *>(assets[i].data.data()), static_cast<std::streamsize>(assets[i].data.size()));
+            position = entries[i].offset + entries[i].size;
+        }
+        output.write(padding, static_cast<std::streamsize>(header.fileSize - position));
+        output.flush();
+
+        if (!output)
+        {
+            std::cerr << "Failed to write asset archive: " << temporaryPath << std::endl;
+            return false;
+        }
+    }
+
+    if (!replaceFile(temporaryPath, path))
+    {
+        std::cerr << "Failed to replace asset archive: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "bindlessHeap.hpp"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+bool BindlessHeap::isSupported(const DeviceProfile &profile)
+{
+    if (!profile.hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+        return false;
+
+    const VkPhysicalDeviceDescriptorIndexingFeaturesEXT &indexingFeatures = profile.descriptorIndexingFeatures;
+    return indexingFeatures.runtimeDescriptorArray &&
+           indexingFeatures.descriptorBindingPartiallyBound &&
+           indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+           indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+           indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT BindlessHeap::requiredFeatures()
+{
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    return indexingFeatures;
+}
+
+void BindlessHeap::init(VkDevice _device, const DeviceProfile &profile, LayoutCache *layoutCache, BindlessHeapCreateInfo createInfo)
+{
+    device = _device;
+
+    const VkPhysicalDeviceDescriptorIndexingPropertiesEXT &indexingProperties = profile.descriptorIndexingProperties;
+
+    // A combined image sampler counts as a sampled image and as a sampler
+    textures.capacity = std::min({createInfo.textureCapacity,
+                                  indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                  indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                  indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                                  indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
+    buffers.capacity = std::min({createInfo.bufferCapacity,
+                                 indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                 indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    // Both bindings are visible to every stage and share its resource limit, which also
+    // has to leave room for the other sets of a pipeline layout
+    uint64_t resources = indexingProperties.maxPerStageUpdateAfterBindResources;
+    resources = resources > reservedResources ? resources - reservedResources : 0;
+    if (uint64_t(textures.capacity) + buffers.capacity > resources)
+    {
+        uint32_t textureShare = static_cast<uint32_t>(resources * textures.capacity / (uint64_t(textures.capacity) + buffers.capacity));
+        buffers.capacity = static_cast<uint32_t>(resources) - textureShare;
+        textures.capacity = textureShare;
+    }
+
+    if (textures.capacity == 0 || buffers.capacity == 0)
+    {
+        throw std::runtime_error("failed to create bindless heap, descriptor limits are too low!");
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = textureBinding;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = textures.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[1].binding = bufferBinding;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = buffers.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Slots that were never written or were released stay unbound, and writing a slot
+    // no pending frame reads is allowed while the set is bound
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+    setLayout = layoutCache->getSetLayout({bindings.begin(), bindings.end()}, {bindingFlags, bindingFlags},
+                                          VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT);
+    layoutCache->setSharedSetLayout(set, setLayout);
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures.capacity};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+}
+
+void BindlessHeap::cleanup()
+{
+    // The set layout belongs to the layout cache
+    if (descriptorPool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    descriptorPool = VK_NULL_HANDLE;
+    descriptorSet = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+    uint32_t index = textures.allocate("texture");
+    setTexture(index, imageView, sampler, imageLayout);
+    return index;
+}
+
+uint32_t BindlessHeap::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t index = buffers.allocate("buffer");
+    setBuffer(index, buffer, offset, range);
+    return index;
+}
+
+void BindlessHeap::setTexture(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+    VkDescriptorImageInfo imageInfo{sampler, imageView, imageLayout};
+    write(textureBinding, index, &imageInfo, nullptr);
+}
+
+void BindlessHeap::setBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo bufferInfo{buffer, offset, range};
+    write(bufferBinding, index, nullptr, &bufferInfo);
+}
+
+void BindlessHeap::releaseTexture(uint32_t index, uint64_t frameNumber)
+{
+    textures.retired.emplace_back(index, frameNumber);
+}
+
+void BindlessHeap::releaseBuffer(uint32_t index, uint64_t frameNumber)
+{
+    buffers.retired.emplace_back(index, frameNumber);
+}
+
+void BindlessHeap::update(uint64_t frameNumber, uint32_t framesInFlight)
+{
+    for (Slots *slots : {&textures, &buffers})
+    {
+        auto &retired = slots->retired;
+        auto done = std::stable_partition(retired.begin(), retired.end(), [&](const std::pair<uint32_t, uint64_t> &entry) {
+            return frameNumber < entry.second + framesInFlight;
+        });
+
+        for (auto it = done; it != retired.end(); ++it)
+            slots->free.push_back(it->first);
+        retired.erase(done, retired.end());
+    }
+}
+
+void BindlessHeap::printStatistics() const
+{
+    std::cerr << "Bindless heap: " << textures.used() << "/" << textures.capacity << " textures, "
+              << buffers.used() << "/" << buffers.capacity << " buffers" << std::endl;
+}
+
+uint32_t BindlessHeap::Slots::allocate(const char *kind)
+{
+    if (!free.empty())
+    {
+        uint32_t index = free.back();
+        free.pop_back();
+        return index;
+    }
+
+    if (next >= capacity)
+    {
+        throw std::runtime_error(std::string("failed to allocate bindless ") + kind + " slot, the heap is full!");
+    }
+
+    return next++;
+}
+
+uint32_t BindlessHeap::Slots::used() const
+{
+    return next - static_cast<uint32_t>(free.size() + retired.size());
+}
+
+void BindlessHeap::write(uint32_t binding, uint32_t index, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo)
+{
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType = imageInfo ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.pImageInfo = imageInfo;
+    descriptorWrite.pBufferInfo = bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
@@ -0,0 +1,282 @@
+#include "blockEncoder.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAS_SSE2 1
+#endif
+
+namespace
+{
+    // Moves the endpoints a sixteenth of the range inwards, the extremes are rarely the best fit
+    constexpr int insetShift = 4;
+
+    uint16_t toRgb565(const uint8_t *color)
+    {
+        return static_cast<uint16_t>((color[0] >> 3) << 11 | (color[1] >> 2) << 5 | color[2] >> 3);
+    }
+
+    // Back to 8 bits per channel the way the decoder does it, alpha left at zero
+    uint32_t fromRgb565(uint16_t color)
+    {
+        uint32_t r = (color >> 11) & 0x1F;
+        uint32_t g = (color >> 5) & 0x3F;
+        uint32_t b = color & 0x1F;
+        return (r << 3 | r >> 2) | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2) << 16;
+    }
+
+    uint32_t lerpColor(uint32_t a, uint32_t b)
+    {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+            result |= ((2 * ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF)) / 3) << shift;
+        return result;
+    }
+
+    void getMinMax(const uint8_t *texels, uint8_t *minColor, uint8_t *maxColor)
+    {
+#ifdef HAS_SSE2
+        const __m128i *rows = reinterpret_cast<const __m128i *>(texels);
+        __m128i row0 = _mm_loadu_si128(rows + 0);
+        __m128i row1 = _mm_loadu_si128(rows + 1);
+        __m128i row2 = _mm_loadu_si128(rows + 2);
+        __m128i row3 = _mm_loadu_si128(rows + 3);
+
+        __m128i low = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+        __m128i high = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+        // Four texels per register left, fold them onto the first one
+        low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+        low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+        high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+        high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        uint32_t lowValue = static_cast<uint32_t>(_mm_cvtsi128_si32(low));
+        uint32_t highValue = static_cast<uint32_t>(_mm_cvtsi128_si32(high));
+        std::memcpy(minColor, &lowValue, 4);
+        std::memcpy(maxColor, &highValue, 4);
+#else
+        std::memcpy(minColor, texels, 4);
+        std::memcpy(maxColor, texels, 4);
+        for (int i = 1; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                minColor[c] = std::min(minColor[c], texels[i * 4 + c]);
+                maxColor[c] = std::max(maxColor[c], texels[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    // Two bits per texel, index of the nearest of the four palette colors. Ties go to the
+    // lower index so both paths agree.
+    uint32_t getColorIndices(const uint8_t *texels, const uint32_t *palette)
+    {
+        uint32_t indices = 0;
+
+#ifdef HAS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+        __m128i colors[4];
+        for (int k = 0; k < 4; k++)
+            colors[k] = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(palette[k])), zero);
+
+        for (int row = 0; row < 4; row++)
+        {
+            __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(texels) + row), rgbMask);
+            __m128i low = _mm_unpacklo_epi8(pixels, zero);
+            __m128i high = _mm_unpackhi_epi8(pixels, zero);
+
+            __m128i best = _mm_setzero_si128();
+            __m128i bestIndex = _mm_setzero_si128();
+
+            for (int k = 0; k < 4; k++)
+            {
+                __m128i lowDelta = _mm_sub_epi16(low, colors[k]);
+                __m128i highDelta = _mm_sub_epi16(high, colors[k]);
+                __m128i lowSquares = _mm_madd_epi16(lowDelta, lowDelta);
+                __m128i highSquares = _mm_madd_epi16(highDelta, highDelta);
+
+                // madd leaves r*r + g*g and b*b per texel, add the pairs up
+                __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lowSquares), _mm_castsi128_ps(highSquares), _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lowSquares), _mm_castsi128_ps(highSquares), _MM_SHUFFLE(3, 1, 3, 1));
+                __m128i distance = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+
+                if (k == 0)
+                {
+                    best = distance;
+                    continue;
+                }
+
+                __m128i closer = _mm_cmplt_epi32(distance, best);
+                best = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+            }
+
+            alignas(16) uint32_t rowIndices[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(rowIndices), bestIndex);
+            for (int i = 0; i < 4; i++)
+                indices |= rowIndices[i] << ((row * 4 + i) * 2);
+        }
+#else
+        for (int i = 0; i < 16; i++)
+        {
+            const uint8_t *texel = texels + i * 4;
+            uint32_t best = 0;
+            uint32_t bestIndex = 0;
+
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                uint32_t distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int delta = texel[c] - static_cast<int>((palette[k] >> (c * 8)) & 0xFF);
+                    distance += static_cast<uint32_t>(delta * delta);
+                }
+
+                if (k == 0 || distance < best)
+                {
+                    best = distance;
+                    bestIndex = k;
+                }
+            }
+
+            indices |= bestIndex << (i * 2);
+        }
+#endif
+
+        return indices;
+    }
+
+    void encodeColor(const uint8_t *texels, uint8_t *block)
+    {
+        uint8_t minColor[4], maxColor[4];
+        getMinMax(texels, minColor, maxColor);
+
+        for (int c = 0; c < 3; c++)
+        {
+            int inset = (maxColor[c] - minColor[c]) >> insetShift;
+            minColor[c] = static_cast<uint8_t>(std::min(minColor[c] + inset, 255));
+            maxColor[c] = static_cast<uint8_t>(std::max(maxColor[c] - inset, 0));
+        }
+
+        // Every channel of the maximum is at least the minimum's, so color0 >= color1 and
+        // the block is in four color mode unless the two are equal
+        uint16_t color0 = toRgb565(maxColor);
+        uint16_t color1 = toRgb565(minColor);
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            uint32_t palette[4];
+            palette[0] = fromRgb565(color0);
+            palette[1] = fromRgb565(color1);
+            palette[2] = lerpColor(palette[0], palette[1]);
+            palette[3] = lerpColor(palette[1], palette[0]);
+            indices = getColorIndices(texels, palette);
+        }
+
+        block[0] = static_cast<uint8_t>(color0);
+        block[1] = static_cast<uint8_t>(color0 >> 8);
+        block[2] = static_cast<uint8_t>(color1);
+        block[3] = static_cast<uint8_t>(color1 >> 8);
+        for (int i = 0; i < 4; i++)
+            block[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    void encodeAlpha(const uint8_t *texels, uint8_t *block)
+    {
+        uint8_t minAlpha = texels[3];
+        uint8_t maxAlpha = texels[3];
+        for (int i = 1; i < 16; i++)
+        {
+            minAlpha = std::min(minAlpha, texels[i * 4 + 3]);
+            maxAlpha = std::max(maxAlpha, texels[i * 4 + 3]);
+        }
+
+        block[0] = maxAlpha;
+        block[1] = minAlpha;
+
+        // alpha0 > alpha1 selects the eight value palette, equal ones decode to alpha0 for index 0
+        uint64_t indices = 0;
+        if (maxAlpha != minAlpha)
+        {
+            int palette[8];
+            palette[0] = maxAlpha;
+            palette[1] = minAlpha;
+            for (int k = 1; k < 7; k++)
+                palette[k + 1] = ((7 - k) * maxAlpha + k * minAlpha) / 7;
+
+            for (int i = 0; i < 16; i++)
+            {
+                int alpha = texels[i * 4 + 3];
+                uint64_t bestIndex = 0;
+                int best = 256;
+
+                for (int k = 0; k < 8; k++)
+                {
+                    int distance = std::abs(alpha - palette[k]);
+                    if (distance < best)
+                    {
+                        best = distance;
+                        bestIndex = static_cast<uint64_t>(k);
+                    }
+                }
+
+                indices |= bestIndex << (i * 3);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+            block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void BlockEncoder::encodeBC1(const uint8_t *texels, uint8_t *block)
+{
+    encodeColor(texels, block);
+}
+
+void BlockEncoder::encodeBC3(const uint8_t *texels, uint8_t *block)
+{
+    encodeAlpha(texels, block);
+    encodeColor(texels, block + 8);
+}
+
+std::vector<uint8_t> BlockEncoder::encodeImage(const uint8_t *texels, uint32_t width, uint32_t height, bool alpha)
+{
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    size_t blockSize = alpha ? 16 : 8;
+
+    std::vector<uint8_t> blocks(blocksX * blocksY * blockSize);
+    uint8_t tile[64];
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                uint32_t sourceY = std::min(by * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t sourceX = std::min(bx * 4 + x, width - 1);
+                    std::memcpy(tile + (y * 4 + x) * 4, texels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                }
+            }
+
+            uint8_t *block = blocks.data() + (by * blocksX + bx) * blockSize;
+            if (alpha)
+                encodeBC3(tile, block);
+            else
+                encodeBC1(tile, block);
+        }
+    }
+
+    return blocks;
+}
@@ -24,6 +24,7 @@ void createBuffer(CreateBufferInfo bufferCreateInfo,
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = bufferCreateInfo.memoryUsage;
     allocInfo.flags = bufferCreateInfo.flags;
+    allocInfo.pool = bufferCreateInfo.pool;
 
     if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS)
     {
@@ -0,0 +1,204 @@
+#include "clusterCuller.hpp"
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    glm::vec4 getRow(const glm::mat4 &matrix, int row)
+    {
+        return glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+    }
+
+    VkBufferMemoryBarrier makeBarrier(VkBuffer buffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+    {
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        return barrier;
+    }
+}
+
+void ClusterCuller::init(const ClusterCullerCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    allocator = createInfo.allocator;
+    layoutCache = createInfo.layoutCache;
+    multiDrawIndirect = createInfo.enabledFeatures.multiDrawIndirect == VK_TRUE;
+
+    meshShaderSupported = createInfo.deviceProfile->hasExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+    cullPipeline.init(device, layoutCache, createInfo.shaderStore, createInfo.pipelineCache, "shaders/cull.comp.spv");
+
+    std::cerr << "Cluster culling: compute, " << (multiDrawIndirect ? "multi draw indirect" : "one indirect draw per cluster")
+              << ", mesh shaders " << (meshShaderSupported ? "supported but not used" : "unavailable") << std::endl;
+}
+
+void ClusterCuller::cleanup()
+{
+    if (clusterCount > 0)
+    {
+        vmaDestroyBuffer(allocator, clusterBuffer.buffer, clusterBuffer.allocation);
+        vmaDestroyBuffer(allocator, drawBuffer.buffer, drawBuffer.allocation);
+    }
+
+    cullPipeline.cleanup();
+}
+
+void ClusterCuller::upload(std::vector<LodMesh> &meshes)
+{
+    if (clusterCount > 0)
+        throw std::runtime_error("failed to upload clusters, they are already uploaded!");
+
+    std::vector<GpuCluster> gpuClusters;
+    for (LodMesh &mesh : meshes)
+    {
+        mesh.firstCluster = static_cast<uint32_t>(gpuClusters.size());
+
+        for (const MeshCluster &cluster : mesh.clusters)
+        {
+            GpuCluster gpuCluster = {};
+            gpuCluster.center[0] = cluster.center.x;
+            gpuCluster.center[1] = cluster.center.y;
+            gpuCluster.center[2] = cluster.center.z;
+            gpuCluster.radius = cluster.radius;
+            gpuCluster.coneAxis[0] = cluster.coneAxis.x;
+            gpuCluster.coneAxis[1] = cluster.coneAxis.y;
+            gpuCluster.coneAxis[2] = cluster.coneAxis.z;
+            gpuCluster.coneCutoff = cluster.coneCutoff;
+            gpuCluster.firstIndex = mesh.mesh.firstIndex + cluster.firstIndex;
+            gpuCluster.indexCount = cluster.indexCount;
+            gpuCluster.vertexOffset = mesh.mesh.vertexOffset;
+            gpuClusters.push_back(gpuCluster);
+        }
+    }
+
+    clusterCount = static_cast<uint32_t>(gpuClusters.size());
+    if (clusterCount == 0)
+        return;
+
+    // Written once and read by every dispatch, device local when the device has mappable memory for it
+    CreateBufferInfo bufferCreateInfo = {};
+    bufferCreateInfo.size = sizeof(GpuCluster) * clusterCount;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    createBuffer(bufferCreateInfo, allocator, clusterBuffer.allocation, clusterBuffer.buffer);
+
+    void *data;
+    vmaMapMemory(allocator, clusterBuffer.allocation, &data);
+    memcpy(data, gpuClusters.data(), sizeof(GpuCluster) * clusterCount);
+    vmaUnmapMemory(allocator, clusterBuffer.allocation);
+
+    bufferCreateInfo.size = sizeof(VkDrawIndexedIndirectCommand) * clusterCount;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    bufferCreateInfo.flags = 0;
+
+    createBuffer(bufferCreateInfo, allocator, drawBuffer.allocation, drawBuffer.buffer);
+}
+
+void ClusterCuller::cull(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const std::vector<LodMesh> &meshes,
+                         const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &proj, glm::vec3 cameraPosition)
+{
+    if (clusterCount == 0)
+        return;
+
+    PushConstants pushConstants = {};
+
+    // Planes of the clip volume pulled back to object space, depth is zero to one
+    glm::mat4 objectToClip = proj * view * model;
+    glm::vec4 w = getRow(objectToClip, 3);
+    std::array<glm::vec4, 6> planes = {
+        w + getRow(objectToClip, 0),
+        w - getRow(objectToClip, 0),
+        w + getRow(objectToClip, 1),
+        w - getRow(objectToClip, 1),
+        getRow(objectToClip, 2),
+        w - getRow(objectToClip, 2),
+    };
+
+    for (size_t i = 0; i < planes.size(); i++)
+    {
+        glm::vec4 plane = planes[i] / glm::length(glm::vec3(planes[i]));
+        std::memcpy(pushConstants.planes[i], &plane, sizeof(pushConstants.planes[i]));
+    }
+
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    std::memcpy(pushConstants.cameraPosition, &camera, sizeof(pushConstants.cameraPosition));
+
+    // The previous frame may still be drawing from the slots about to be overwritten, it
+    // was submitted earlier on the same queue so the barrier covers it
+    VkBufferMemoryBarrier barrier = makeBarrier(drawBuffer.buffer, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    VkDescriptorSetLayout setLayout = cullPipeline.getDescriptorSetLayout(0);
+    VkDescriptorSet descriptorSet = descriptorAllocator.allocate(setLayout);
+
+    std::array<DescriptorInfo, 2> descriptors{};
+    descriptors[0].buffer = {clusterBuffer.buffer, 0, VK_WHOLE_SIZE};
+    descriptors[1].buffer = {drawBuffer.buffer, 0, VK_WHOLE_SIZE};
+    layoutCache->update(descriptorSet, setLayout, descriptors.data());
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.getPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+
+    for (const LodMesh &mesh : meshes)
+    {
+        if (mesh.lods.empty() || mesh.getLod().clusterCount == 0)
+            continue;
+
+        pushConstants.firstCluster = mesh.firstCluster + mesh.getLod().firstCluster;
+        pushConstants.clusterCount = mesh.getLod().clusterCount;
+
+        vkCmdPushConstants(commandBuffer, cullPipeline.getPipelineLayout(), cullPipeline.getPushConstantStages(), 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (pushConstants.clusterCount + 63) / 64, 1, 1);
+
+        dispatches++;
+        clustersTested += pushConstants.clusterCount;
+    }
+
+    barrier = makeBarrier(drawBuffer.buffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void ClusterCuller::draw(VkCommandBuffer commandBuffer, const std::vector<LodMesh> &meshes)
+{
+    for (const LodMesh &mesh : meshes)
+        drawMesh(commandBuffer, mesh);
+}
+
+void ClusterCuller::drawMesh(VkCommandBuffer commandBuffer, const LodMesh &mesh)
+{
+    if (clusterCount == 0 || mesh.lods.empty() || mesh.getLod().clusterCount == 0)
+        return;
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    uint32_t firstCluster = mesh.firstCluster + mesh.getLod().firstCluster;
+    uint32_t count = mesh.getLod().clusterCount;
+
+    // Without the feature the draw count has to be one
+    if (multiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.buffer, VkDeviceSize(firstCluster) * stride, count, stride);
+        indirectDraws++;
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer.buffer, VkDeviceSize(firstCluster + i) * stride, 1, stride);
+    indirectDraws += count;
+}
+
+void ClusterCuller::printStatistics() const
+{
+    std::cerr << "Cluster culler: " << clusterCount << " clusters, " << dispatches << " dispatches, "
+              << clustersTested << " clusters tested, " << indirectDraws << " indirect draw calls" << std::endl;
+}
@@ -0,0 +1,39 @@
+#include "computePipeline.hpp"
+#include <stdexcept>
+
+void ComputePipeline::init(VkDevice _device, LayoutCache *layoutCache, ShaderStore *_shaderStore, VkPipelineCache pipelineCache, const std::string &path)
+{
+    device = _device;
+    shaderStore = _shaderStore;
+
+    shaderModule = shaderStore->acquire(path);
+    ShaderReflection reflection = shaderStore->getReflection(shaderModule);
+
+    if (reflection.stage != VK_SHADER_STAGE_COMPUTE_BIT)
+    {
+        shaderStore->release(shaderModule);
+        throw std::runtime_error("failed to create compute pipeline, " + path + " is not a compute shader!");
+    }
+
+    layoutInfo = layoutCache->getPipelineLayout({reflection});
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = reflection.entryPoint.c_str();
+    pipelineInfo.layout = layoutInfo.pipelineLayout;
+
+    if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        shaderStore->release(shaderModule);
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+}
+
+void ComputePipeline::cleanup()
+{
+    vkDestroyPipeline(device, pipeline, nullptr);
+    shaderStore->release(shaderModule);
+}
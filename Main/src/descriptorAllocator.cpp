@@ -0,0 +1,147 @@
+#include "descriptorAllocator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t maxSetsPerPool = 4096;
+}
+
+std::vector<DescriptorPoolSizeRatio> DescriptorAllocator::defaultRatios()
+{
+    return {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f},
+    };
+}
+
+void DescriptorAllocator::init(VkDevice _device, uint32_t initialSetsPerPool, std::vector<DescriptorPoolSizeRatio> _ratios)
+{
+    device = _device;
+    ratios = std::move(_ratios);
+    setsPerPool = initialSetsPerPool;
+}
+
+void DescriptorAllocator::cleanup()
+{
+    if (currentPool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(device, currentPool, nullptr);
+
+    for (auto pool : readyPools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+
+    for (auto pool : fullPools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+
+    currentPool = VK_NULL_HANDLE;
+    readyPools.clear();
+    fullPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    if (currentPool == VK_NULL_HANDLE)
+        currentPool = getPool();
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+
+    // The pool is exhausted, retire it for this interval and retry once with a fresh one
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        fullPools.push_back(currentPool);
+        currentPool = getPool();
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    allocations++;
+    peakAllocations = std::max(peakAllocations, allocations);
+    return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+    if (currentPool != VK_NULL_HANDLE)
+        fullPools.push_back(currentPool);
+    currentPool = VK_NULL_HANDLE;
+
+    for (auto pool : fullPools)
+    {
+        vkResetDescriptorPool(device, pool, 0);
+        readyPools.push_back(pool);
+    }
+    fullPools.clear();
+
+    allocations = 0;
+}
+
+DescriptorAllocator::Statistics DescriptorAllocator::getStatistics() const
+{
+    Statistics statistics{};
+    statistics.allocations = allocations;
+    statistics.peakAllocations = peakAllocations;
+    statistics.poolCount = static_cast<uint32_t>(readyPools.size() + fullPools.size()) + (currentPool != VK_NULL_HANDLE ? 1 : 0);
+    statistics.poolsCreated = poolsCreated;
+    return statistics;
+}
+
+void DescriptorAllocator::printStatistics(const char *name) const
+{
+    Statistics statistics = getStatistics();
+    std::cerr << name << ": " << statistics.allocations << " sets this frame, peak " << statistics.peakAllocations
+              << ", " << statistics.poolCount << " pools (" << statistics.poolsCreated << " created)" << std::endl;
+}
+
+VkDescriptorPool DescriptorAllocator::getPool()
+{
+    if (!readyPools.empty())
+    {
+        VkDescriptorPool pool = readyPools.back();
+        readyPools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = createPool(setsPerPool);
+    setsPerPool = std::min(setsPerPool + setsPerPool / 2, maxSetsPerPool);
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(ratios.size());
+    for (const auto &ratio : ratios)
+        poolSizes.push_back({ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount))});
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    poolsCreated++;
+    return pool;
+}
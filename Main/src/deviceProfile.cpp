@@ -0,0 +1,464 @@
+#include "deviceProfile.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct ProfileFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t profileCount;
+        uint32_t reserved;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    constexpr uint32_t profileFileMagic = 0x50445556; // "VUDP"
+    constexpr uint32_t profileFileVersion = 1;
+
+    constexpr uint32_t resizableBarBit = 1u << 0;
+    constexpr uint32_t timelineSemaphoresBit = 1u << 1;
+    constexpr uint32_t dynamicRenderingBit = 1u << 2;
+
+    // Beyond this a host visible device local heap isn't the fixed BAR window
+    constexpr VkDeviceSize barWindowSize = 256ull * 1024 * 1024;
+
+    // Formats the renderer asks about: color targets, depth and every block compressed
+    // format the texture transcoder considers
+    std::vector<VkFormat> getProfiledFormats()
+    {
+        std::vector<VkFormat> formats = {
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_B8G8R8A8_UNORM,
+            VK_FORMAT_B8G8R8A8_SRGB,
+            VK_FORMAT_R16G16B16A16_SFLOAT,
+            VK_FORMAT_D16_UNORM,
+            VK_FORMAT_X8_D24_UNORM_PACK32,
+            VK_FORMAT_D32_SFLOAT,
+            VK_FORMAT_D24_UNORM_S8_UINT,
+            VK_FORMAT_D32_SFLOAT_S8_UINT,
+        };
+
+        for (int value = VK_FORMAT_BC1_RGB_UNORM_BLOCK; value <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK; value++)
+            formats.push_back(static_cast<VkFormat>(value));
+
+        return formats;
+    }
+
+    // What is read for every device, enough to tell whether a stored profile still applies
+    struct DeviceIdentity
+    {
+        VkPhysicalDeviceProperties properties = {};
+        std::array<uint8_t, VK_UUID_SIZE> deviceUUID = {};
+        std::array<uint8_t, VK_UUID_SIZE> driverUUID = {};
+    };
+
+    DeviceIdentity readIdentity(VkPhysicalDevice physicalDevice)
+    {
+        DeviceIdentity identity;
+        vkGetPhysicalDeviceProperties(physicalDevice, &identity.properties);
+
+        if (identity.properties.apiVersion < VK_API_VERSION_1_1)
+            return identity;
+
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        std::copy(std::begin(idProperties.deviceUUID), std::end(idProperties.deviceUUID), identity.deviceUUID.begin());
+        std::copy(std::begin(idProperties.driverUUID), std::end(idProperties.driverUUID), identity.driverUUID.begin());
+        return identity;
+    }
+
+    bool matches(const DeviceProfile &profile, const DeviceIdentity &identity)
+    {
+        return profile.hasUUID() &&
+               profile.properties.vendorID == identity.properties.vendorID &&
+               profile.properties.deviceID == identity.properties.deviceID &&
+               profile.properties.driverVersion == identity.properties.driverVersion &&
+               profile.properties.apiVersion == identity.properties.apiVersion &&
+               profile.deviceUUID == identity.deviceUUID &&
+               profile.driverUUID == identity.driverUUID;
+    }
+
+    DeviceProfile gather(VkPhysicalDevice physicalDevice, const DeviceIdentity &identity)
+    {
+        DeviceProfile profile;
+        profile.physicalDevice = physicalDevice;
+        profile.properties = identity.properties;
+        profile.deviceUUID = identity.deviceUUID;
+        profile.driverUUID = identity.driverUUID;
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        profile.extensions.resize(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, profile.extensions.data());
+
+        std::sort(profile.extensions.begin(), profile.extensions.end(), [](const VkExtensionProperties &a, const VkExtensionProperties &b) {
+            return std::strcmp(a.extensionName, b.extensionName) < 0;
+        });
+
+        if (profile.properties.apiVersion >= VK_API_VERSION_1_1)
+        {
+            // Extension structures are only chained for extensions the device lists, the
+            // instance is 1.1 and doesn't know the promoted versions
+            VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+            indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+            VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+            timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+            VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+            dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+            VkPhysicalDeviceFeatures2 features{};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+            void **next = &features.pNext;
+            auto chain = [&](auto &structure) {
+                *next = &structure;
+                next = &structure.pNext;
+            };
+
+            bool descriptorIndexing = profile.hasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            if (descriptorIndexing)
+                chain(indexingFeatures);
+            if (profile.hasExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+                chain(timelineFeatures);
+            if (profile.hasExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+                chain(dynamicRenderingFeatures);
+
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+            profile.features = features.features;
+            profile.descriptorIndexingFeatures = indexingFeatures;
+            profile.descriptorIndexingFeatures.pNext = nullptr;
+            profile.timelineSemaphores = timelineFeatures.timelineSemaphore == VK_TRUE;
+            profile.dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+
+            if (descriptorIndexing)
+            {
+                VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+                indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+                VkPhysicalDeviceProperties2 properties{};
+                properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+                properties.pNext = &indexingProperties;
+                vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+                profile.descriptorIndexingProperties = indexingProperties;
+                profile.descriptorIndexingProperties.pNext = nullptr;
+            }
+        }
+        else
+        {
+            vkGetPhysicalDeviceFeatures(physicalDevice, &profile.features);
+        }
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &profile.memory);
+
+        for (uint32_t i = 0; i < profile.memory.memoryTypeCount; i++)
+        {
+            const VkMemoryType &type = profile.memory.memoryTypes[i];
+            const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+            if ((type.propertyFlags & flags) == flags && profile.memory.memoryHeaps[type.heapIndex].size > barWindowSize)
+                profile.resizableBar = true;
+        }
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        profile.queueFamilies.resize(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, profile.queueFamilies.data());
+
+        for (VkFormat format : getProfiledFormats())
+        {
+            ProfiledFormat profiled = {format, {}};
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &profiled.properties);
+            profile.formats.push_back(profiled);
+        }
+
+        std::sort(profile.formats.begin(), profile.formats.end(), [](const ProfiledFormat &a, const ProfiledFormat &b) {
+            return a.format < b.format;
+        });
+
+        return profile;
+    }
+
+    template <typename T>
+    void write(std::vector<char> &data, const T &value)
+    {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void writeArray(std::vector<char> &data, const std::vector<T> &values)
+    {
+        write(data, static_cast<uint32_t>(values.size()));
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    struct Reader
+    {
+        const std::vector<char> &data;
+        size_t offset = 0;
+
+        template <typename T>
+        bool read(T &value)
+        {
+            if (data.size() - offset < sizeof(T))
+                return false;
+
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        template <typename T>
+        bool readArray(std::vector<T> &values)
+        {
+            uint32_t count = 0;
+            if (!read(count) || (data.size() - offset) / sizeof(T) < count)
+                return false;
+
+            values.resize(count);
+            std::memcpy(values.data(), data.data() + offset, count * sizeof(T));
+            offset += count * sizeof(T);
+            return true;
+        }
+    };
+}
+
+bool DeviceProfile::hasExtension(const char *name) const
+{
+    auto found = std::lower_bound(extensions.begin(), extensions.end(), name, [](const VkExtensionProperties &extension, const char *value) {
+        return std::strcmp(extension.extensionName, value) < 0;
+    });
+    return found != extensions.end() && std::strcmp(found->extensionName, name) == 0;
+}
+
+bool DeviceProfile::hasUUID() const
+{
+    return std::any_of(deviceUUID.begin(), deviceUUID.end(), [](uint8_t byte) { return byte != 0; });
+}
+
+VkFormatProperties DeviceProfile::getFormatProperties(VkFormat format) const
+{
+    auto found = std::lower_bound(formats.begin(), formats.end(), format, [](const ProfiledFormat &profiled, VkFormat value) {
+        return profiled.format < value;
+    });
+    if (found != formats.end() && found->format == format)
+        return found->properties;
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return properties;
+}
+
+VkDeviceSize DeviceProfile::getDeviceLocalBytes() const
+{
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++)
+    {
+        if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            bytes += memory.memoryHeaps[i].size;
+    }
+    return bytes;
+}
+
+void DeviceProfile::print() const
+{
+    std::cerr << "Device: " << properties.deviceName << ", Vulkan " << VK_VERSION_MAJOR(properties.apiVersion) << "." << VK_VERSION_MINOR(properties.apiVersion)
+              << ", " << getDeviceLocalBytes() / (1024 * 1024) << " MiB device local, " << queueFamilies.size() << " queue families, "
+              << extensions.size() << " extensions, resizable BAR " << (resizableBar ? "yes" : "no")
+              << ", timeline semaphores " << (timelineSemaphores ? "yes" : "no")
+              << ", dynamic rendering " << (dynamicRendering ? "yes" : "no") << std::endl;
+}
+
+void DeviceProfileCache::init(VkInstance instance, const std::string &_path)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    path = _path;
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    std::vector<DeviceProfile> stored = load();
+
+    for (VkPhysicalDevice physicalDevice : devices)
+    {
+        DeviceIdentity identity = readIdentity(physicalDevice);
+
+        auto found = std::find_if(stored.begin(), stored.end(), [&](const DeviceProfile &profile) {
+            return matches(profile, identity);
+        });
+
+        if (found != stored.end())
+        {
+            profiles.push_back(*found);
+            profiles.back().physicalDevice = physicalDevice;
+            profiles.back().properties = identity.properties;
+            loaded++;
+            continue;
+        }
+
+        profiles.push_back(gather(physicalDevice, identity));
+        gathered++;
+        dirty = dirty || profiles.back().hasUUID();
+    }
+
+    milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void DeviceProfileCache::save()
+{
+    if (path.empty() || !dirty)
+        return;
+
+    std::vector<char> data;
+    uint32_t profileCount = 0;
+
+    for (const DeviceProfile &profile : profiles)
+    {
+        if (!profile.hasUUID())
+            continue;
+
+        uint32_t fastPaths = (profile.resizableBar ? resizableBarBit : 0) |
+                             (profile.timelineSemaphores ? timelineSemaphoresBit : 0) |
+                             (profile.dynamicRendering ? dynamicRenderingBit : 0);
+
+        write(data, profile.properties);
+        write(data, profile.features);
+        write(data, profile.memory);
+        write(data, profile.descriptorIndexingFeatures);
+        write(data, profile.descriptorIndexingProperties);
+        write(data, profile.deviceUUID);
+        write(data, profile.driverUUID);
+        write(data, fastPaths);
+        writeArray(data, profile.queueFamilies);
+        writeArray(data, profile.extensions);
+        writeArray(data, profile.formats);
+        profileCount++;
+    }
+
+    ProfileFileHeader header = {};
+    header.magic = profileFileMagic;
+    header.version = profileFileVersion;
+    header.profileCount = profileCount;
+    header.dataSize = data.size();
+    header.dataHash = Hash::fnv1a(data.data(), data.size());
+
+    // Written next to the old file and swapped in, a failed write leaves the old profiles intact
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        file.flush();
+
+        if (!file)
+        {
+            std::cerr << "Failed to write device profiles: " << temporaryPath << std::endl;
+            return;
+        }
+    }
+
+    if (!replaceFile(temporaryPath, path))
+    {
+        std::cerr << "Failed to replace device profiles: " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    dirty = false;
+}
+
+void DeviceProfileCache::printStatistics() const
+{
+    std::cerr << "Device profiles: " << profiles.size() << " devices, " << loaded << " loaded from " << (path.empty() ? "nowhere" : path)
+              << ", " << gathered << " gathered, " << milliseconds << " ms" << std::endl;
+}
+
+std::vector<DeviceProfile> DeviceProfileCache::load() const
+{
+    std::vector<DeviceProfile> stored;
+    if (path.empty())
+        return stored;
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return stored;
+
+    size_t fileSize = (size_t)file.tellg();
+    ProfileFileHeader header = {};
+    if (fileSize < sizeof(header))
+        return stored;
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    if (header.magic != profileFileMagic || header.version != profileFileVersion || header.dataSize != fileSize - sizeof(header))
+    {
+        std::cerr << "Discarding incompatible device profiles: " << path << std::endl;
+        return stored;
+    }
+
+    std::vector<char> data((size_t)header.dataSize);
+    file.read(data.data(), data.size());
+
+    if (!file || Hash::fnv1a(data.data(), data.size()) != header.dataHash)
+    {
+        std::cerr << "Discarding corrupted device profiles: " << path << std::endl;
+        return stored;
+    }
+
+    Reader reader = {data};
+    for (uint32_t i = 0; i < header.profileCount; i++)
+    {
+        DeviceProfile profile;
+        uint32_t fastPaths = 0;
+
+        bool complete = reader.read(profile.properties) &&
+                        reader.read(profile.features) &&
+                        reader.read(profile.memory) &&
+                        reader.read(profile.descriptorIndexingFeatures) &&
+                        reader.read(profile.descriptorIndexingProperties) &&
+                        reader.read(profile.deviceUUID) &&
+                        reader.read(profile.driverUUID) &&
+                        reader.read(fastPaths) &&
+                        reader.readArray(profile.queueFamilies) &&
+                        reader.readArray(profile.extensions) &&
+                        reader.readArray(profile.formats);
+
+        if (!complete)
+        {
+            std::cerr << "Discarding corrupted device profiles: " << path << std::endl;
+            return {};
+        }
+
+        profile.descriptorIndexingFeatures.pNext = nullptr;
+        profile.descriptorIndexingProperties.pNext = nullptr;
+        profile.resizableBar = fastPaths & resizableBarBit;
+        profile.timelineSemaphores = fastPaths & timelineSemaphoresBit;
+        profile.dynamicRendering = fastPaths & dynamicRenderingBit;
+        stored.push_back(profile);
+    }
+
+    return stored;
+}
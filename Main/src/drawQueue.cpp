@@ -0,0 +1,198 @@
+#include "drawQueue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+    uint32_t countPipelineChanges(const std::vector<Draw> &draws)
+    {
+        uint32_t changes = 0;
+        for (size_t i = 0; i < draws.size(); i++)
+        {
+            if (i == 0 || draws[i].pipeline != draws[i - 1].pipeline)
+                changes++;
+        }
+        return changes;
+    }
+}
+
+void DrawQueue::init(JobSystem *_jobSystem)
+{
+    jobSystem = _jobSystem;
+}
+
+void DrawQueue::begin(float _farDepth)
+{
+    farDepth = _farDepth;
+    draws.clear();
+    sorted.clear();
+    items.clear();
+}
+
+void DrawQueue::add(const Draw &draw)
+{
+    items.push_back({makeKey(draw), static_cast<uint32_t>(draws.size())});
+    draws.push_back(draw);
+}
+
+void DrawQueue::sort()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    const size_t count = items.size();
+    scratch.resize(count);
+
+    size_t chunkCount = 1;
+    if (jobSystem && jobSystem->getThreadCount() > 0 && count >= parallelThreshold)
+        chunkCount = std::min<size_t>(jobSystem->getThreadCount() + 1, count / minChunkSize);
+    const size_t chunkSize = (count + chunkCount - 1) / std::max<size_t>(chunkCount, 1);
+
+    // Digits every key agrees on don't move anything
+    uint64_t keysOr = 0;
+    uint64_t keysAnd = ~uint64_t(0);
+    for (const SortItem &item : items)
+    {
+        keysOr |= item.key;
+        keysAnd &= item.key;
+    }
+
+    for (uint32_t shift = 0; shift < 64 && count > 1; shift += 8)
+    {
+        if ((((keysOr ^ keysAnd) >> shift) & 0xFF) == 0)
+        {
+            skippedPasses++;
+            continue;
+        }
+
+        histograms.assign(chunkCount * 256, 0);
+
+        runChunks(chunkCount, [&](size_t chunk) {
+            size_t *histogram = &histograms[chunk * 256];
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++)
+                histogram[(items[i].key >> shift) & 0xFF]++;
+        });
+
+        // Digit major, chunk minor, so equal digits keep their order and the sort is stable
+        size_t offset = 0;
+        for (size_t digit = 0; digit < 256; digit++)
+        {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++)
+            {
+                size_t digitCount = histograms[chunk * 256 + digit];
+                histograms[chunk * 256 + digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        runChunks(chunkCount, [&](size_t chunk) {
+            size_t *offsets = &histograms[chunk * 256];
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++)
+                scratch[offsets[(items[i].key >> shift) & 0xFF]++] = items[i];
+        });
+
+        items.swap(scratch);
+        radixPasses++;
+    }
+
+    sorted.resize(count);
+    for (size_t i = 0; i < count; i++)
+        sorted[i] = draws[items[i].index];
+
+    sorts++;
+    parallelSorts += chunkCount > 1;
+    drawCount += count;
+    submittedPipelineChanges += countPipelineChanges(draws);
+    sortedPipelineChanges += countPipelineChanges(sorted);
+    sortMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void DrawQueue::printStatistics() const
+{
+    std::cerr << "Draw queue: " << sorts << " sorts (" << parallelSorts << " parallel), " << drawCount << " draws, "
+              << radixPasses << " radix passes, " << skippedPasses << " skipped, pipeline changes " << sortedPipelineChanges
+              << " sorted vs " << submittedPipelineChanges << " in submission order, "
+              << (sorts > 0 ? sortMilliseconds / sorts : 0.0) << " ms per sort" << std::endl;
+}
+
+uint64_t DrawQueue::makeKey(const Draw &draw) const
+{
+    if (draw.pipeline >> pipelineBits || draw.material >> materialBits || draw.mesh >> meshBits)
+        throw std::runtime_error("failed to add draw, an id doesn't fit its sort key bits!");
+
+    const uint64_t depthMax = (uint64_t(1) << depthBits) - 1;
+    uint64_t depth = static_cast<uint64_t>(std::clamp(draw.depth / farDepth, 0.0f, 1.0f) * depthMax);
+
+    uint64_t pipeline = draw.pipeline;
+    uint64_t material = draw.material;
+    uint64_t mesh = draw.mesh;
+    uint64_t key = uint64_t(draw.pass) << 62;
+
+    if (draw.pass == DrawPass::Transparent)
+    {
+        key |= (depthMax - depth) << (pipelineBits + materialBits + meshBits);
+        key |= pipeline << (materialBits + meshBits);
+        key |= material << meshBits;
+        return key | mesh;
+    }
+
+    key |= pipeline << (materialBits + meshBits + depthBits);
+    key |= material << (meshBits + depthBits);
+    key |= mesh << depthBits;
+    return key | depth;
+}
+
+// The calling thread works through chunks as well and only waits for chunks a worker
+// already started, workers busy with something else never hold up the frame
+void DrawQueue::runChunks(size_t chunkCount, const std::function<void(size_t)> &task)
+{
+    if (chunkCount == 1)
+    {
+        task(0);
+        return;
+    }
+
+    // Outlives this call for jobs that only start after every chunk is done
+    struct Shared
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        const std::function<void(size_t)> *task = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto shared = std::make_shared<Shared>();
+    shared->count = chunkCount;
+    shared->task = &task;
+
+    auto work = [shared]() {
+        size_t chunk;
+        while ((chunk = shared->next.fetch_add(1)) < shared->count)
+        {
+            (*shared->task)(chunk);
+
+            if (shared->done.fetch_add(1) + 1 == shared->count)
+            {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->finished.notify_all();
+            }
+        }
+    };
+
+    for (size_t i = 1; i < chunkCount; i++)
+        jobSystem->submit(work);
+
+    work();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->finished.wait(lock, [&] { return shared->done.load() == shared->count; });
+}
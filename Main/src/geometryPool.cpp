@@ -0,0 +1,126 @@
+#include "geometryPool.hpp"
+#include <iostream>
+
+namespace
+{
+    bool isPowerOfTwo(uint32_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+}
+
+void GeometryPool::init(VmaAllocator _allocator, GeometryPoolCreateInfo createInfo)
+{
+    allocator = _allocator;
+
+    CreateBufferInfo bufferCreateInfo = {};
+    bufferCreateInfo.size = createInfo.vertexBufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    bufferCreateInfo.flags = {};
+    bufferCreateInfo.queueFamilyIndices = createInfo.queueFamilyIndices;
+    bufferCreateInfo.pool = createInfo.memoryPool;
+
+    createBuffer(bufferCreateInfo, allocator, vertexBuffer.allocation, vertexBuffer.buffer);
+
+    bufferCreateInfo.size = createInfo.indexBufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+    createBuffer(bufferCreateInfo, allocator, indexBuffer.allocation, indexBuffer.buffer);
+
+    VmaVirtualBlockCreateInfo blockCreateInfo = {};
+    blockCreateInfo.size = createInfo.vertexBufferSize;
+
+    if (vmaCreateVirtualBlock(&blockCreateInfo, &vertexBlock) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create geometry pool vertex block!");
+    }
+
+    blockCreateInfo.size = createInfo.indexBufferSize;
+
+    if (vmaCreateVirtualBlock(&blockCreateInfo, &indexBlock) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create geometry pool index block!");
+    }
+}
+
+void GeometryPool::cleanup()
+{
+    vmaClearVirtualBlock(vertexBlock);
+    vmaClearVirtualBlock(indexBlock);
+    vmaDestroyVirtualBlock(vertexBlock);
+    vmaDestroyVirtualBlock(indexBlock);
+
+    vmaDestroyBuffer(allocator, vertexBuffer.buffer, vertexBuffer.allocation);
+    vmaDestroyBuffer(allocator, indexBuffer.buffer, indexBuffer.allocation);
+}
+
+Mesh GeometryPool::allocate(uint32_t vertexCount, uint32_t vertexStride, uint32_t indexCount)
+{
+    Mesh mesh = {};
+    mesh.vertexStride = vertexStride;
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount = indexCount;
+
+    // vertexOffset is counted in vertices, so the byte offset has to be a multiple of the stride.
+    // Power of two strides are handled by the allocator alignment, other strides get padded.
+    VmaVirtualAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.size = (VkDeviceSize)vertexCount * vertexStride;
+
+    if (isPowerOfTwo(vertexStride))
+        allocCreateInfo.alignment = vertexStride;
+    else
+        allocCreateInfo.size += vertexStride - 1;
+
+    VkDeviceSize offset = 0;
+    if (vmaVirtualAllocate(vertexBlock, &allocCreateInfo, &mesh.vertexAllocation, &offset) != VK_SUCCESS)
+    {
+        throw std::runtime_error("geometry pool is out of vertex memory!");
+    }
+
+    mesh.vertexByteOffset = (offset + vertexStride - 1) / vertexStride * vertexStride;
+    mesh.vertexOffset = static_cast<int32_t>(mesh.vertexByteOffset / vertexStride);
+
+    allocCreateInfo = {};
+    allocCreateInfo.size = (VkDeviceSize)indexCount * sizeof(Index);
+    allocCreateInfo.alignment = sizeof(Index);
+
+    if (vmaVirtualAllocate(indexBlock, &allocCreateInfo, &mesh.indexAllocation, &offset) != VK_SUCCESS)
+    {
+        vmaVirtualFree(vertexBlock, mesh.vertexAllocation);
+        throw std::runtime_error("geometry pool is out of index memory!");
+    }
+
+    mesh.indexByteOffset = offset;
+    mesh.firstIndex = static_cast<uint32_t>(offset / sizeof(Index));
+
+    return mesh;
+}
+
+void GeometryPool::free(Mesh &mesh)
+{
+    if (mesh.vertexAllocation != VK_NULL_HANDLE)
+        vmaVirtualFree(vertexBlock, mesh.vertexAllocation);
+
+    if (mesh.indexAllocation != VK_NULL_HANDLE)
+        vmaVirtualFree(indexBlock, mesh.indexAllocation);
+
+    mesh = {};
+}
+
+void GeometryPool::bind(Engine::CommandEncoder &encoder) const
+{
+    encoder.bindVertexBuffer(0, vertexBuffer.buffer, 0);
+    encoder.bindIndexBuffer(indexBuffer.buffer, 0, indexType);
+}
+
+void GeometryPool::printStatistics() const
+{
+    VmaStatistics vertexStats = {}, indexStats = {};
+    vmaGetVirtualBlockStatistics(vertexBlock, &vertexStats);
+    vmaGetVirtualBlockStatistics(indexBlock, &indexStats);
+
+    std::cerr << "Geometry Pool: "
+              << vertexStats.allocationCount << " vertex ranges (" << vertexStats.allocationBytes << " bytes), "
+              << indexStats.allocationCount << " index ranges (" << indexStats.allocationBytes << " bytes)" << std::endl;
+}
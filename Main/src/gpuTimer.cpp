@@ -0,0 +1,145 @@
+#include "gpuTimer.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+void GpuTimer::init(const GpuTimerCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    maxScopes = createInfo.maxScopes;
+    frames.resize(createInfo.framesInFlight);
+
+    const VkPhysicalDeviceProperties &properties = createInfo.deviceProfile->properties;
+
+    uint32_t validBits = createInfo.deviceProfile->queueFamilies.at(createInfo.queueFamilyIndex).timestampValidBits;
+    supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+
+    if (!supported)
+    {
+        std::cerr << "GPU timer: no timestamp support on the queue, frames aren't timed" << std::endl;
+        return;
+    }
+
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = createInfo.framesInFlight * maxScopes * 2;
+
+    if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    results.resize(maxScopes * 2);
+}
+
+void GpuTimer::cleanup()
+{
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+
+    queryPool = VK_NULL_HANDLE;
+    frames.clear();
+}
+
+bool GpuTimer::collect(uint32_t frame)
+{
+    Frame &timed = frames[frame];
+    if (!supported || timed.scopes.empty())
+        return false;
+
+    uint32_t queryCount = static_cast<uint32_t>(timed.scopes.size()) * 2;
+    VkResult result = vkGetQueryPoolResults(device, queryPool, getFirstQuery(frame), queryCount, queryCount * sizeof(uint64_t), results.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    // The frame was recorded but never submitted
+    if (result != VK_SUCCESS)
+    {
+        timed.scopes.clear();
+        return false;
+    }
+
+    for (size_t i = 0; i < timed.scopes.size(); i++)
+    {
+        uint64_t ticks = (results[i * 2 + 1] - results[i * 2]) & timestampMask;
+        double milliseconds = ticks * timestampPeriod / 1e6;
+
+        Scope &scope = scopes[timed.scopes[i]];
+        scope.milliseconds = milliseconds;
+        scope.totalMilliseconds += milliseconds;
+        scope.maxMilliseconds = std::max(scope.maxMilliseconds, milliseconds);
+        scope.samples++;
+    }
+
+    timed.scopes.clear();
+    return true;
+}
+
+void GpuTimer::begin(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    currentFrame = frame;
+    frames[frame].scopes.clear();
+
+    if (supported)
+        vkCmdResetQueryPool(commandBuffer, queryPool, getFirstQuery(frame), maxScopes * 2);
+}
+
+uint32_t GpuTimer::beginScope(VkCommandBuffer commandBuffer, const char *name)
+{
+    if (!supported)
+        return invalidScope;
+
+    Frame &timed = frames[currentFrame];
+    if (timed.scopes.size() >= maxScopes)
+        throw std::runtime_error("failed to begin GPU timer scope, the frame has too many scopes!");
+
+    uint32_t scope = static_cast<uint32_t>(timed.scopes.size());
+    timed.scopes.push_back(findScope(name));
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, getFirstQuery(currentFrame) + scope * 2);
+    return scope;
+}
+
+void GpuTimer::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    if (scope == invalidScope)
+        return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, getFirstQuery(currentFrame) + scope * 2 + 1);
+}
+
+double GpuTimer::getMilliseconds(const char *name) const
+{
+    for (const Scope &scope : scopes)
+        if (scope.name == name)
+            return scope.milliseconds;
+
+    return 0.0;
+}
+
+void GpuTimer::printStatistics() const
+{
+    if (!supported)
+        return;
+
+    for (const Scope &scope : scopes)
+    {
+        std::cerr << "GPU timer " << scope.name << ": " << scope.samples << " frames, average "
+                  << (scope.samples > 0 ? scope.totalMilliseconds / scope.samples : 0.0) << " ms, max " << scope.maxMilliseconds << " ms" << std::endl;
+    }
+}
+
+uint32_t GpuTimer::findScope(const char *name)
+{
+    for (size_t i = 0; i < scopes.size(); i++)
+        if (scopes[i].name == name)
+            return static_cast<uint32_t>(i);
+
+    Scope scope;
+    scope.name = name;
+    scopes.push_back(scope);
+    return static_cast<uint32_t>(scopes.size() - 1);
+}
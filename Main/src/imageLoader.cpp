@@ -0,0 +1,245 @@
+#include "imageLoader.hpp"
+#include "mappedFile.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#if __has_include(<stb_image.h>)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define HAS_STB_IMAGE 1
+#endif
+
+namespace
+{
+    [[noreturn]] void fail(const std::string &path, const char *reason)
+    {
+        throw std::runtime_error("failed to load image " + path + ", " + reason + "!");
+    }
+
+    bool hasExtension(const std::string &path, const char *extension)
+    {
+        size_t length = std::strlen(extension);
+        if (path.size() < length)
+            return false;
+
+        return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+    }
+
+    // Binary PPM, "P6 <width> <height> <maxval>" followed by RGB triplets
+    ImageData loadPpm(const std::string &path, const uint8_t *data, size_t size)
+    {
+        size_t position = 2;
+        auto readNumber = [&]() {
+            while (position < size && (std::isspace(data[position]) || data[position] == '#'))
+            {
+                if (data[position] == '#')
+                    while (position < size && data[position] != '\n')
+                        position++;
+                else
+                    position++;
+            }
+
+            uint32_t value = 0;
+            if (position >= size || !std::isdigit(data[position]))
+                fail(path, "malformed PPM header");
+            while (position < size && std::isdigit(data[position]))
+                value = value * 10 + (data[position++] - '0');
+            return value;
+        };
+
+        if (size < 2 || data[0] != 'P' || data[1] != '6')
+            fail(path, "not a binary PPM");
+
+        ImageData image;
+        image.width = readNumber();
+        image.height = readNumber();
+        uint32_t maxValue = readNumber();
+        position++; // single whitespace before the texels
+
+        if (maxValue == 0 || maxValue > 255)
+            fail(path, "only 8 bit PPM is supported");
+
+        size_t texelCount = static_cast<size_t>(image.width) * image.height;
+        if (image.width == 0 || image.height == 0 || position + texelCount * 3 > size)
+            fail(path, "truncated PPM");
+
+        std::vector<uint8_t> texels(texelCount * 4);
+        for (size_t i = 0; i < texelCount; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                texels[i * 4 + c] = static_cast<uint8_t>(data[position + i * 3 + c] * 255u / maxValue);
+            texels[i * 4 + 3] = 255;
+        }
+
+        image.mips.push_back(std::move(texels));
+        return image;
+    }
+
+    // True color or grayscale TGA, raw or run length encoded
+    ImageData loadTga(const std::string &path, const uint8_t *data, size_t size)
+    {
+        if (size < 18)
+            fail(path, "truncated TGA header");
+
+        uint8_t idLength = data[0];
+        uint8_t colorMapType = data[1];
+        uint8_t imageType = data[2];
+        uint16_t width = static_cast<uint16_t>(data[12] | data[13] << 8);
+        uint16_t height = static_cast<uint16_t>(data[14] | data[15] << 8);
+        uint8_t bitsPerPixel = data[16];
+        bool topLeft = (data[17] & 0x20) != 0;
+
+        bool rle = imageType == 10 || imageType == 11;
+        bool grayscale = imageType == 3 || imageType == 11;
+        uint32_t bytesPerPixel = bitsPerPixel / 8;
+
+        if (colorMapType != 0 || !(imageType == 2 || imageType == 3 || rle))
+            fail(path, "color mapped TGA is not supported");
+        if (grayscale ? bytesPerPixel != 1 : (bytesPerPixel != 3 && bytesPerPixel != 4))
+            fail(path, "unsupported TGA pixel size");
+
+        ImageData image;
+        image.width = width;
+        image.height = height;
+
+        size_t texelCount = static_cast<size_t>(width) * height;
+        std::vector<uint8_t> texels(texelCount * 4);
+
+        size_t position = 18 + idLength;
+        auto readPixel = [&](uint8_t *texel) {
+            if (position + bytesPerPixel > size)
+                fail(path, "truncated TGA");
+
+            const uint8_t *pixel = data + position;
+            position += bytesPerPixel;
+
+            if (grayscale)
+            {
+                texel[0] = texel[1] = texel[2] = pixel[0];
+                texel[3] = 255;
+                return;
+            }
+
+            texel[0] = pixel[2];
+            texel[1] = pixel[1];
+            texel[2] = pixel[0];
+            texel[3] = bytesPerPixel == 4 ? pixel[3] : 255;
+        };
+
+        for (size_t i = 0; i < texelCount;)
+        {
+            if (!rle)
+            {
+                readPixel(&texels[i++ * 4]);
+                continue;
+            }
+
+            if (position >= size)
+                fail(path, "truncated TGA");
+
+            uint8_t packet = data[position++];
+            size_t count = std::min<size_t>((packet & 0x7F) + 1, texelCount - i);
+
+            if (packet & 0x80)
+            {
+                readPixel(&texels[i * 4]);
+                for (size_t j = 1; j < count; j++)
+                    std::memcpy(&texels[(i + j) * 4], &texels[i * 4], 4);
+            }
+            else
+            {
+                for (size_t j = 0; j < count; j++)
+                    readPixel(&texels[(i + j) * 4]);
+            }
+            i += count;
+        }
+
+        // Bottom up is the TGA default, textures are stored top down
+        if (!topLeft)
+        {
+            size_t rowSize = static_cast<size_t>(width) * 4;
+            for (size_t y = 0; y < height / 2u; y++)
+                std::swap_ranges(texels.begin() + y * rowSize, texels.begin() + (y + 1) * rowSize, texels.begin() + (height - 1 - y) * rowSize);
+        }
+
+        image.mips.push_back(std::move(texels));
+        return image;
+    }
+}
+
+ImageData ImageLoader::load(const std::string &path)
+{
+    MappedFile file;
+    if (!file.open(path) || file.size() == 0)
+    {
+        fail(path, "can't open file");
+    }
+
+    const uint8_t *data = static_cast<const uint8_t *>(file.data());
+
+    if (hasExtension(path, ".ppm"))
+        return loadPpm(path, data, file.size());
+
+    if (hasExtension(path, ".tga"))
+        return loadTga(path, data, file.size());
+
+#ifdef HAS_STB_IMAGE
+    int width, height, channels;
+    stbi_uc *texels = stbi_load_from_memory(data, static_cast<int>(file.size()), &width, &height, &channels, STBI_rgb_alpha);
+    if (!texels)
+    {
+        fail(path, stbi_failure_reason());
+    }
+
+    ImageData image;
+    image.width = static_cast<uint32_t>(width);
+    image.height = static_cast<uint32_t>(height);
+    image.mips.emplace_back(texels, texels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(texels);
+    return image;
+#else
+    fail(path, "unsupported format, stb_image is not available");
+#endif
+}
+
+void ImageLoader::generateMips(ImageData &image)
+{
+    image.mips.resize(1);
+
+    for (uint32_t mip = 1; image.getMipWidth(mip - 1) > 1 || image.getMipHeight(mip - 1) > 1; mip++)
+    {
+        uint32_t srcWidth = image.getMipWidth(mip - 1);
+        uint32_t srcHeight = image.getMipHeight(mip - 1);
+        uint32_t width = image.getMipWidth(mip);
+        uint32_t height = image.getMipHeight(mip);
+
+        const std::vector<uint8_t> &src = image.mips[mip - 1];
+        std::vector<uint8_t> dst(static_cast<size_t>(width) * height * 4);
+
+        // Odd sizes repeat the last row or column instead of reading past it
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint32_t y0 = std::min(y * 2, srcHeight - 1);
+            uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t x0 = std::min(x * 2, srcWidth - 1);
+                uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] +
+                                   src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+                    dst[(y * width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+
+        image.mips.push_back(std::move(dst));
+    }
+}
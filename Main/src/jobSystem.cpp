@@ -0,0 +1,71 @@
+#include "jobSystem.hpp"
+#include <algorithm>
+
+void JobSystem::init(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = std::max(hardwareThreads, 2u) - 1;
+    }
+
+    stopping = false;
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this);
+}
+
+void JobSystem::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+
+    workers.clear();
+    jobs.clear();
+}
+
+void JobSystem::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void JobSystem::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && runningJobs == 0; });
+}
+
+void JobSystem::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+        // Pending jobs are still drained on shutdown
+        if (jobs.empty())
+            return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        runningJobs++;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        runningJobs--;
+        if (jobs.empty() && runningJobs == 0)
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,318 @@
+#include "layoutCache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    // Non dispatchable handles are pointers or uint64_t depending on the platform
+    template <typename Handle>
+    uint64_t handleBits(Handle handle)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &handle, sizeof(handle));
+        return bits;
+    }
+}
+
+void LayoutCache::init(VkDevice _device)
+{
+    device = _device;
+}
+
+void LayoutCache::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &[setLayout, updateTemplate] : updateTemplates)
+        vkDestroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+
+    for (auto &[key, pipelineLayout] : pipelineLayouts)
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+
+    for (auto &[key, setLayout] : setLayouts)
+        vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+
+    updateTemplates.clear();
+    setLayoutBindings.clear();
+    pipelineLayouts.clear();
+    setLayouts.clear();
+}
+
+PipelineLayoutInfo LayoutCache::getPipelineLayout(const std::vector<ShaderReflection> &stages)
+{
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+    PipelineLayoutInfo info;
+
+    for (const auto &stage : stages)
+    {
+        for (const auto &reflected : stage.bindings)
+        {
+            if (reflected.set >= sets.size())
+                sets.resize(reflected.set + 1);
+
+            if (isShared(reflected.set))
+            {
+                checkSharedBinding(reflected);
+                continue;
+            }
+
+            if (reflected.count == 0)
+            {
+                throw std::runtime_error("failed to create descriptor set layout, runtime sized arrays need a shared set layout!");
+            }
+
+            auto &bindings = sets[reflected.set];
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&](const VkDescriptorSetLayoutBinding &binding) {
+                return binding.binding == reflected.binding;
+            });
+
+            if (it == bindings.end())
+            {
+                VkDescriptorSetLayoutBinding binding{};
+                binding.binding = reflected.binding;
+                binding.descriptorType = reflected.type;
+                binding.descriptorCount = reflected.count;
+                binding.stageFlags = stage.stage;
+                bindings.push_back(binding);
+            }
+            else if (it->descriptorType != reflected.type)
+            {
+                throw std::runtime_error("failed to create descriptor set layout, stages disagree on a binding type!");
+            }
+            else
+            {
+                it->descriptorCount = std::max(it->descriptorCount, reflected.count);
+                it->stageFlags |= stage.stage;
+            }
+        }
+
+        if (stage.pushConstantSize > 0)
+        {
+            info.pushConstantStages |= stage.stage;
+            info.pushConstantSize = std::max(info.pushConstantSize, stage.pushConstantSize);
+        }
+    }
+
+    // Sets below the highest one in use still need a layout, an empty one does
+    for (uint32_t set = 0; set < sets.size(); set++)
+        info.setLayouts.push_back(isShared(set) ? getSharedSetLayout(set) : getSetLayout(sets[set]));
+
+    // One range visible to every stage that declares the block, stages share the same struct
+    std::vector<VkPushConstantRange> pushConstantRanges;
+    if (info.pushConstantSize > 0)
+        pushConstantRanges.push_back({info.pushConstantStages, 0, info.pushConstantSize});
+
+    info.pipelineLayout = getPipelineLayout(info.setLayouts, pushConstantRanges);
+    return info;
+}
+
+VkDescriptorSetLayout LayoutCache::getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings, std::vector<VkDescriptorBindingFlags> bindingFlags, VkDescriptorSetLayoutCreateFlags flags)
+{
+    if (!bindingFlags.empty() && bindingFlags.size() != bindings.size())
+    {
+        throw std::runtime_error("failed to create descriptor set layout, binding flags don't match the bindings!");
+    }
+
+    // Sort both by binding number, the flags follow their binding
+    std::vector<size_t> order(bindings.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return bindings[a].binding < bindings[b].binding;
+    });
+
+    std::vector<VkDescriptorSetLayoutBinding> sortedBindings;
+    std::vector<VkDescriptorBindingFlags> sortedFlags;
+    for (size_t i : order)
+    {
+        sortedBindings.push_back(bindings[i]);
+        if (!bindingFlags.empty())
+            sortedFlags.push_back(bindingFlags[i]);
+    }
+    bindings = std::move(sortedBindings);
+    bindingFlags = std::move(sortedFlags);
+
+    std::vector<uint64_t> key;
+    key.reserve(bindings.size() * 5 + 1);
+    key.push_back(flags);
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        key.push_back(bindings[i].binding);
+        key.push_back(bindings[i].descriptorType);
+        key.push_back(bindings[i].descriptorCount);
+        key.push_back(bindings[i].stageFlags);
+        key.push_back(bindingFlags.empty() ? 0 : bindingFlags[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    requests++;
+
+    auto it = setLayouts.find(key);
+    if (it != setLayouts.end())
+        return it->second;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+    layoutInfo.flags = flags;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    setLayouts.emplace(std::move(key), setLayout);
+    setLayoutBindings.emplace(setLayout, std::move(bindings));
+    return setLayout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout> &layouts, const std::vector<VkPushConstantRange> &pushConstantRanges)
+{
+    std::vector<uint64_t> key;
+    key.push_back(layouts.size());
+    for (auto layout : layouts)
+        key.push_back(handleBits(layout));
+    for (const auto &range : pushConstantRanges)
+    {
+        key.push_back(range.stageFlags);
+        key.push_back(range.offset);
+        key.push_back(range.size);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    requests++;
+
+    auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end())
+        return it->second;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+    pipelineLayoutInfo.pSetLayouts = layouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    pipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+void LayoutCache::setSharedSetLayout(uint32_t set, VkDescriptorSetLayout setLayout)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (setLayoutBindings.find(setLayout) == setLayoutBindings.end())
+    {
+        throw std::runtime_error("failed to share descriptor set layout, it wasn't created by the layout cache!");
+    }
+
+    sharedSetLayouts[set] = setLayout;
+}
+
+bool LayoutCache::isShared(uint32_t set) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sharedSetLayouts.find(set) != sharedSetLayouts.end();
+}
+
+VkDescriptorSetLayout LayoutCache::getSharedSetLayout(uint32_t set) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sharedSetLayouts.at(set);
+}
+
+void LayoutCache::checkSharedBinding(const ReflectedBinding &reflected) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto &bindings = setLayoutBindings.at(sharedSetLayouts.at(reflected.set));
+    auto it = std::find_if(bindings.begin(), bindings.end(), [&](const VkDescriptorSetLayoutBinding &binding) {
+        return binding.binding == reflected.binding;
+    });
+
+    if (it == bindings.end() || it->descriptorType != reflected.type || it->descriptorCount < reflected.count)
+    {
+        throw std::runtime_error("failed to create pipeline layout, a shader doesn't match a shared descriptor set layout!");
+    }
+}
+
+VkDescriptorUpdateTemplate LayoutCache::getUpdateTemplate(VkDescriptorSetLayout setLayout)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = updateTemplates.find(setLayout);
+    if (it != updateTemplates.end())
+        return it->second;
+
+    auto bindings = setLayoutBindings.find(setLayout);
+    if (bindings == setLayoutBindings.end())
+    {
+        throw std::runtime_error("failed to create descriptor update template, unknown set layout!");
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindings->second.size());
+
+    size_t offset = 0;
+    for (const auto &binding : bindings->second)
+    {
+        if (binding.descriptorCount == 0)
+            continue;
+
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = offset;
+        entry.stride = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+
+        offset += binding.descriptorCount * sizeof(DescriptorInfo);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = setLayout;
+
+    VkDescriptorUpdateTemplate updateTemplate;
+    if (vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+
+    updateTemplates.emplace(setLayout, updateTemplate);
+    return updateTemplate;
+}
+
+void LayoutCache::update(VkDescriptorSet descriptorSet, VkDescriptorSetLayout setLayout, const DescriptorInfo *descriptors)
+{
+    vkUpdateDescriptorSetWithTemplate(device, descriptorSet, getUpdateTemplate(setLayout), descriptors);
+}
+
+void LayoutCache::printStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::cerr << "Layout cache: " << requests << " requests, " << setLayouts.size() << " set layouts, "
+              << pipelineLayouts.size() << " pipeline layouts, " << updateTemplates.size() << " update templates" << std::endl;
+}
@@ -0,0 +1,45 @@
+#include "lodSelector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void LodSelector::setProjection(float verticalFov, float viewportHeight)
+{
+    pixelsPerUnit = viewportHeight / (2.0f * std::tan(verticalFov * 0.5f));
+}
+
+float LodSelector::getScreenError(float error, float distance) const
+{
+    // Inside the bounds the mesh covers the screen, only the finest level will do
+    if (distance <= 0.0f)
+        return error > 0.0f ? HUGE_VALF : 0.0f;
+
+    return error * pixelsPerUnit / distance;
+}
+
+uint32_t LodSelector::select(LodMesh &mesh, float distance)
+{
+    if (mesh.lods.empty())
+        return 0;
+
+    uint32_t lod = std::min(mesh.currentLod, static_cast<uint32_t>(mesh.lods.size() - 1));
+    float objectDistance = distance * mesh.positionScale;
+
+    // Finer right away when the current level shows, coarser only with some margin
+    while (lod > 0 && getScreenError(mesh.lods[lod].error, objectDistance) > thresholdPixels)
+        lod--;
+    while (lod + 1 < mesh.lods.size() && getScreenError(mesh.lods[lod + 1].error, objectDistance) <= thresholdPixels * (1.0f - hysteresis))
+        lod++;
+
+    selections++;
+    if (lod != mesh.currentLod)
+        switches++;
+
+    mesh.currentLod = lod;
+    return lod;
+}
+
+void LodSelector::printStatistics() const
+{
+    std::cerr << "LOD selector: " << selections << " selections, " << switches << " switches" << std::endl;
+}
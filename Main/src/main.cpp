@@ -1,10 +1,12 @@
 #include <Engine.hpp>
+#include <CommandEncoder.hpp>
 
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib>
 #include <vector>
 #include <cstring>
+#include <cctype>
 #include <map>
 #include <optional>
 #include <set>
@@ -16,11 +18,35 @@
 #include <functional>
 #include <sstream>
 #include <chrono>
+#include <filesystem>
 // Region Vulkan
 
+#include "deviceProfile.hpp"
 #include "queue_families.hpp"
 #include "renderPipeline.hpp"
 #include "presentPipeline.hpp"
+#include "geometryPool.hpp"
+#include "hash.hpp"
+#include "memoryPools.hpp"
+#include "pipelineCache.hpp"
+#include "pipelineRegistry.hpp"
+#include "jobSystem.hpp"
+#include "shaderStore.hpp"
+#include "layoutCache.hpp"
+#include "shaderWatcher.hpp"
+#include "descriptorAllocator.hpp"
+#include "samplerCache.hpp"
+#include "bindlessHeap.hpp"
+#include "uploadManager.hpp"
+#include "textureStreamer.hpp"
+#include "mipGenerator.hpp"
+#include "assetArchive.hpp"
+#include "meshImporter.hpp"
+#include "clusterCuller.hpp"
+#include "renderTargetPool.hpp"
+#include "gpuTimer.hpp"
+#include "resolutionController.hpp"
+#include "drawQueue.hpp"
 
 const int WIDTH = 800;
 const int HEIGHT = 800;
@@ -37,74 +63,47 @@ constexpr bool enableValidationLayers = false;
 constexpr bool enableValidationLayers = true;
 #endif
 
-struct SwapChainSupportDetails
-{
-    VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
-};
+constexpr VertexInputMode vertexInputMode = VertexInputMode::Attributes;
 
-struct Vertex
-{
-    glm::vec2 pos;
-    glm::vec3 color;
-
-    static VkVertexInputBindingDescription getBindingDescription()
-    {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+// Uses the bindless heap when the device supports descriptor indexing
+constexpr bool preferBindless = true;
 
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions()
-    {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+// Meshes and shaders are read from here, rebuilt from the built in meshes and
+// shaders/*.spv when missing or older than a shader
+const char *const assetArchivePath = "assets.vkpk";
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+// Fixed camera, also used to pick the level of detail of imported models
+const glm::vec3 cameraPosition = glm::vec3(2.0f, 2.0f, 2.0f);
+const float cameraFov = glm::radians(45.0f);
+const float cameraNear = 0.1f;
+const float cameraFar = 10.0f;
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        return attributeDescriptions;
-    }
+// Pipeline ids of the scene's draws in the draw queue, index the frame's scene states
+enum ScenePipeline : uint32_t
+{
+    DepthOnlyPipeline,
+    OpaquePipeline,
+    TransparentPipeline
 };
 
-struct PresentVertex {
-    glm::vec2 pos;
-    glm::vec2 texCoord;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(PresentVertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
+// Payload of the quad's draw, model draws carry their index in modelMeshes
+const uint32_t quadPayload = UINT32_MAX;
 
-    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(PresentVertex, pos);
+// Command line paths with these extensions are streamed in as textures, the rest are models
+bool isTexturePath(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(PresentVertex, texCoord);
+    return extension == ".ktx2" || extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+           extension == ".tga" || extension == ".ppm" || extension == ".bmp";
+}
 
-        return attributeDescriptions;
-    }
+struct SwapChainSupportDetails
+{
+    VkSurfaceCapabilitiesKHR capabilities;
+    std::vector<VkSurfaceFormatKHR> formats;
+    std::vector<VkPresentModeKHR> presentModes;
 };
 
 struct UniformBufferObject {
@@ -122,36 +121,45 @@ struct Image {
     VkExtent2D extent;
 };
 
-struct RenderTarget : public Image {
-    VkFramebuffer framebuffer;
+struct RenderTargetSlot {
+    uint32_t textureIndex = BindlessHeap::invalidIndex;
+    VkImageView imageView = VK_NULL_HANDLE;
 };
 
 
 const std::vector<RenderPipeline::Vertex> renderTargetVertices = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-    {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}};
+    RenderPipeline::Vertex::make({-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f, 1.0f}),
+    RenderPipeline::Vertex::make({0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f, 1.0f}),
+    RenderPipeline::Vertex::make({0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 1.0f}),
+    RenderPipeline::Vertex::make({-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f})};
 
-const std::vector<uint16_t> renderTargetIndices = {
+const std::vector<GeometryPool::Index> renderTargetIndices = {
     0, 1, 2, 2, 3, 0};
 
 const std::vector<PresentPipeline::Vertex> presentVertices = {
-    {{-1.0f, -1.0f}, {0.0f, 0.0f}},
-    {{1.0f, -1.0f}, {1.0f, 0.0f}},
-    {{1.0f, 1.0f}, {1.0f, 1.0f}},
-    {{-1.0f, 1.0f}, {0.0f, 1.0f}}
+    PresentPipeline::Vertex::make({-1.0f, -1.0f}, {0.0f, 0.0f}),
+    PresentPipeline::Vertex::make({1.0f, -1.0f}, {1.0f, 0.0f}),
+    PresentPipeline::Vertex::make({1.0f, 1.0f}, {1.0f, 1.0f}),
+    PresentPipeline::Vertex::make({-1.0f, 1.0f}, {0.0f, 1.0f})
 };
 
-const std::vector<uint16_t> presentIndices = {
+const std::vector<GeometryPool::Index> presentIndices = {
     0, 1, 2, 2, 3, 0
 };
 
 class HelloTriangleApplication
 {
 public:
-    void run()
+    void run(const std::vector<std::string> &paths)
     {
+        for (const auto &path : paths)
+        {
+            if (isTexturePath(path))
+                texturePaths.push_back(path);
+            else
+                modelPaths.push_back(path);
+        }
+
         initWindow();
         initVulkan();
         mainLoop();
@@ -161,6 +169,9 @@ public:
 private:
     void initVulkan()
     {
+        jobSystem.init();
+        drawQueue.init(&jobSystem);
+
         createInstance();
 
         setupDebugMessenger();
@@ -177,28 +188,49 @@ private:
         std::cerr << "Created Image Views" << std::endl;
         createRenderPass();
         std::cerr << "Created Render Pass" << std::endl;
-        createDescriptorSetLayout(); 
-        std::cerr << "Created Descriptor Set Layout" << std::endl;
+        createSceneRenderPass();
+        std::cerr << "Created Scene Render Pass" << std::endl;
+        openAssetArchive();
+        std::cerr << "Opened Asset Archive" << std::endl;
+        shaderStore.init(device, assetArchive.isOpen() ? &assetArchive : nullptr);
+        layoutCache.init(device);
+        samplerCache.init(device);
+        if (bindlessEnabled)
+            bindlessHeap.init(device, deviceProfile, &layoutCache);
+        pipelineCache.init(device, deviceProfile.properties, "pipeline_cache.bin");
+        std::cerr << "Created Pipeline Cache" << std::endl;
         createRenderPipeline();
         std::cerr << "Created Graphics Pipeline" << std::endl;
+        createPipelineRegistry();
+        std::cerr << "Created Pipeline Registry" << std::endl;
         createFramebuffers();
         std::cerr << "Created Framebuffers" << std::endl;
         createCommandPool();
         std::cerr << "Created Command Pool" << std::endl;
         createVMAAllocator();
         std::cerr << "Created VMA Allocator" << std::endl;
-        createVertexBuffer();
-        std::cerr << "Created Vertex Buffer" << std::endl;
-        createIndexBuffer();
-        std::cerr << "Created Index Buffer" << std::endl;
+        importModels();
+        std::cerr << "Imported Models" << std::endl;
+        createGeometryPool();
+        std::cerr << "Created Geometry Pool" << std::endl;
+        createMipGenerator();
+        std::cerr << "Created Mip Generator" << std::endl;
+        createClusterCuller();
+        std::cerr << "Created Cluster Culler" << std::endl;
+        createTextureStreamer();
+        std::cerr << "Created Texture Streamer" << std::endl;
+        uploadModels();
+        std::cerr << "Uploaded Models" << std::endl;
         createUniformBuffers();
         std::cerr << "Created Uniform Buffers" << std::endl;
+        createGpuTimer();
+        std::cerr << "Created GPU Timer" << std::endl;
+        createResolutionController();
+        std::cerr << "Created Resolution Controller" << std::endl;
         createRenderTargets();
         std::cerr << "Created Render Targets" << std::endl;
-        createDescriptorPool();
-        std::cerr << "Created Descriptor Pool" << std::endl;
-        createDescriptorSets();
-        std::cerr << "Created Descriptor Sets" << std::endl;
+        createDescriptorAllocators();
+        std::cerr << "Created Descriptor Allocators" << std::endl;
         createCommandBuffer();
         std::cerr << "Created Command Buffer" << std::endl;
         createSyncObjects();
@@ -233,7 +265,24 @@ private:
                 frameTime -= 1.0;
             }
 
+            for (const auto &path : shaderWatcher.poll())
+                pipelineRegistry.reload(path);
+            pipelineRegistry.update(frameNumber, framesInFlight);
+            bindlessHeap.update(frameNumber, framesInFlight);
+            renderTargetPool.update(frameNumber, framesInFlight);
+
+            // Levels are streamed in up to the size the previews are drawn at
+            float previewSize = static_cast<float>(getTexturePreviewSize());
+            for (TextureHandle handle : textureHandles)
+                textureStreamer.setScreenSize(handle, previewSize);
+
+            // Completion callbacks retire texture views with the frame number the streamer was updated with
+            textureStreamer.update(frameNumber, framesInFlight);
+            uploadManager.submit();
+            uploadManager.update();
+
             drawFrame();
+            pipelineCache.saveIfDue();
 
             ++frameCount;
             previousTime = currentTime;
@@ -247,12 +296,12 @@ private:
     {
 
         cleanupSwapChain();
-        
-        vkDestroyDescriptorPool(device, renderDescriptorPool, nullptr);
-        vkDestroyDescriptorPool(device, presentDescriptorPool, nullptr);
 
-        vkDestroyDescriptorSetLayout(device, renderDescriptorSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(device, presentDescriptorSetLayout, nullptr);
+        for (size_t i = 0; i < descriptorAllocators.size(); i++) {
+            descriptorAllocators[i].printStatistics(("Descriptor allocator " + std::to_string(i)).c_str());
+            descriptorAllocators[i].cleanup();
+        }
+
 
 
         for(auto& uniformBuffer : uniformBuffers) {
@@ -260,19 +309,37 @@ private:
             vmaDestroyBuffer(allocator, uniformBuffer.buffer, uniformBuffer.allocation);
         }
 
-        for(auto& renderTarget : renderTargets) {
-            vkDestroyFramebuffer(device, renderTarget.framebuffer, nullptr);
-            vkDestroyImageView(device, renderTarget.imageView, nullptr);
-            vkDestroySampler(device, renderTarget.sampler, nullptr);
-            vmaDestroyImage(allocator, renderTarget.image, renderTarget.allocation);
-        }
-
-        vmaDestroyBuffer(allocator, renderVertexBuffer.buffer, renderVertexBuffer.allocation);
-        vmaDestroyBuffer(allocator, renderIndexBuffer.buffer, renderIndexBuffer.allocation);
+        renderTargetPool.printStatistics();
+        cleanupRenderTargets();
+        resolutionController.printStatistics();
+        gpuTimer.printStatistics();
+        gpuTimer.cleanup();
+
+        // Callbacks of uploads still in flight reach into the streamer's textures
+        uploadManager.flush();
+        textureStreamer.printStatistics();
+        textureStreamer.cleanup();
+        uploadManager.printStatistics();
+        uploadManager.cleanup();
+        mipGenerator.printStatistics();
+        mipGenerator.cleanup();
+
+        if (!modelMeshes.empty())
+            lodSelector.printStatistics();
+        clusterCuller.printStatistics();
+        clusterCuller.cleanup();
+        drawQueue.printStatistics();
+        commandEncoder.printStatistics();
+
+        geometryPool.free(renderTargetMesh);
+        geometryPool.free(presentMesh);
+        for (auto &model : modelMeshes)
+            geometryPool.free(model.mesh);
+        geometryPool.cleanup();
+
+        memoryPools.printStatistics();
+        memoryPools.cleanup();
 
-        vmaDestroyBuffer(allocator, presentVertexBuffer.buffer, presentVertexBuffer.allocation);
-        vmaDestroyBuffer(allocator, presentIndexBuffer.buffer, presentIndexBuffer.allocation);
-        
         vmaDestroyAllocator(allocator);
 
         for (size_t i = 0; i < framesInFlight; i++)
@@ -286,10 +353,26 @@ private:
         vkDestroyCommandPool(device, transferCommandPool, nullptr);
         
 
+        shaderWatcher.cleanup();
+        pipelineRegistry.cleanup();
         renderPipeline.cleanup();
         presentPipeline.cleanup();
+        upscalePipeline.cleanup();
+        shaderStore.printStatistics();
+        shaderStore.cleanup();
+        if (bindlessEnabled) {
+            bindlessHeap.printStatistics();
+            bindlessHeap.cleanup();
+        }
+        layoutCache.printStatistics();
+        layoutCache.cleanup();
+        samplerCache.cleanup();
+        pipelineCache.cleanup();
+        jobSystem.cleanup();
+        assetArchive.close();
 
         vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroyRenderPass(device, sceneRenderPass, nullptr);
 
         vkDestroyDevice(device, nullptr);
 
@@ -308,11 +391,7 @@ private:
     }
 
     void cleanupRenderTargets() {
-        for(auto& renderTarget : renderTargets) {
-            vkDestroyFramebuffer(device, renderTarget.framebuffer, nullptr);
-            vkDestroyImageView(device, renderTarget.imageView, nullptr);
-            vmaDestroyImage(allocator, renderTarget.image, renderTarget.allocation);
-        }
+        renderTargetPool.cleanup();
     }
 
     void cleanupSwapChain()
@@ -367,6 +446,7 @@ private:
 
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetKeyCallback(window, keyCallback);
 
         previousTime = std::chrono::steady_clock::now();
     }
@@ -379,6 +459,26 @@ private:
         app->framebufferResized = true;
     }
 
+    static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+    {
+        (void)scancode;
+        (void)mods;
+        auto app = reinterpret_cast<HelloTriangleApplication *>(glfwGetWindowUserPointer(window));
+
+        // B toggles blending on the quad, drawn with the transparent draws after the opaque models
+        if (key == GLFW_KEY_B && action == GLFW_PRESS)
+            app->renderBlending = !app->renderBlending;
+
+        // U switches between the edge adaptive upscaler and plain bilinear upscaling, the GPU
+        // timer reports both passes separately
+        if (key == GLFW_KEY_U && action == GLFW_PRESS)
+            app->presentUpscaling = !app->presentUpscaling;
+
+        // P draws the opaque scene into the depth buffer first, shading then only runs for visible surfaces
+        if (key == GLFW_KEY_P && action == GLFW_PRESS)
+            app->depthPrepass = !app->depthPrepass;
+    }
+
 private:
     static void glfwError(int id, const char *description)
     {
@@ -403,7 +503,7 @@ private: // Vulkan Initialiazation
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_1;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -481,50 +581,44 @@ private: // Vulkan Initialiazation
         }
     }
 
-    // Queue Families
-
     // Physical Device
 
-    bool isDeviceSuitable(VkPhysicalDevice _physicalDevice)
+    bool isDeviceSuitable(const DeviceProfile &profile)
     {
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
-
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(_physicalDevice, &deviceFeatures);
-
-        auto queueIndices = findQueueFamilies(_physicalDevice, surface);
+        // Descriptor update templates are core since 1.1
+        if (profile.properties.apiVersion < VK_API_VERSION_1_1)
+        {
+            return false;
+        }
 
-        (void)deviceProperties;
-        (void)deviceFeatures;
+        auto queueIndices = findQueueFamilies(profile, surface);
 
         bool swapChainAdequate = false;
-        if (checkDeviceExtensions(_physicalDevice))
+        if (checkDeviceExtensions(profile))
         {
-            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice);
+            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(profile.physicalDevice);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
         return queueIndices.isComplete() && swapChainAdequate;
     }
 
-    int rateDeviceSuitability(VkPhysicalDevice _physicalDevice)
+    int rateDeviceSuitability(const DeviceProfile &profile)
     {
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
-
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(_physicalDevice, &deviceFeatures);
-
         int score = 0;
 
-        // Discrete GPUs have a significant performance advantage
-        if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        // Discrete GPUs have a significant performance advantage, integrated ones still beat
+        // virtual and software devices
+        if (profile.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        {
+            score += 10000;
+        }
+        else if (profile.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
         {
             score += 1000;
         }
 
-        auto indices = findQueueFamilies(_physicalDevice, surface);
+        auto indices = findQueueFamilies(profile, surface);
 
         // Always better to have a separate compute queue
         if (indices.computeFamily.value().family != indices.graphicsFamily.value().family)
@@ -538,57 +632,69 @@ private: // Vulkan Initialiazation
             score += 100;
         }
 
-        // Maximum possible size of textures affects graphics quality
-        score += deviceProperties.limits.maxImageDimension2D;
+        // Per frame uniforms are written straight into device local memory
+        if (profile.resizableBar)
+        {
+            score += 100;
+        }
+
+        // Not used yet, but a sign of a current driver
+        if (profile.timelineSemaphores)
+        {
+            score += 50;
+        }
+
+        if (profile.dynamicRendering)
+        {
+            score += 50;
+        }
+
+        // Device local memory decides how much of the scene stays resident, the maximum
+        // texture size only breaks ties
+        score += static_cast<int>(std::min<VkDeviceSize>(profile.getDeviceLocalBytes() / (64ull << 20), 1024));
+        score += static_cast<int>(profile.properties.limits.maxImageDimension2D / 1024);
 
         return score;
     }
 
     void pickPhysicalDevice()
     {
-        uint32_t deviceCount = 0;
-        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+        deviceProfiles.init(instance, "device_profiles.bin");
 
-        if (deviceCount == 0)
+        if (deviceProfiles.getProfiles().empty())
         {
             throw std::runtime_error("failed to find GPUs with Vulkan support!");
         }
 
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+        std::multimap<int, const DeviceProfile *> candidates;
 
-        std::vector<VkPhysicalDevice> suitableDevices;
-
-        for (const auto &_physicalDevice : devices)
+        for (const auto &profile : deviceProfiles.getProfiles())
         {
-            if (isDeviceSuitable(_physicalDevice))
+            if (isDeviceSuitable(profile))
             {
-                suitableDevices.push_back(_physicalDevice);
+                candidates.insert(std::make_pair(rateDeviceSuitability(profile), &profile));
             }
         }
 
-        if (devices.empty())
+        if (candidates.empty())
         {
             throw std::runtime_error("failed to find a suitable GPU!");
         }
 
-        std::multimap<int, VkPhysicalDevice> candidates;
-
-        for (const auto &suitableDevice : suitableDevices)
-        {
-            int score = rateDeviceSuitability(suitableDevice);
-            candidates.insert(std::make_pair(score, suitableDevice));
-        }
-
         // The candidates were all suitable, so just pick the best one
-        physicalDevice = candidates.rbegin()->second;
+        deviceProfile = *candidates.rbegin()->second;
+        physicalDevice = deviceProfile.physicalDevice;
+
+        deviceProfiles.save();
+        deviceProfiles.printStatistics();
+        deviceProfile.print();
     }
 
     // Logical Device
 
     void createLogicalDevice()
     {
-        auto indices = findQueueFamilies(physicalDevice, surface);
+        auto indices = findQueueFamilies(deviceProfile, surface);
         queueFamilyIndices = indices;
 
         std::cerr << "Graphics Family: " << indices.graphicsFamily.value().family << " (index: " << indices.graphicsFamily.value().queueIndex << ")\n"
@@ -609,18 +715,38 @@ private: // Vulkan Initialiazation
             queueCreateInfos[i].pQueuePriorities = queuePriorities[i].data();
         }
 
+        const VkPhysicalDeviceFeatures &supportedFeatures = deviceProfile.features;
+
+        // Whichever compressed formats the device samples, textures are transcoded to them
         VkPhysicalDeviceFeatures deviceFeatures{};
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+        // Culled clusters of a level are drawn in one call when available
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        enabledFeatures = deviceFeatures;
+
+        std::vector<const char *> enabledExtensions = deviceExtensions;
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = BindlessHeap::requiredFeatures();
+
+        bindlessEnabled = preferBindless && BindlessHeap::isSupported(deviceProfile);
+        std::cerr << "Bindless descriptors: " << (bindlessEnabled ? "enabled" : "unavailable") << std::endl;
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
+        if (bindlessEnabled)
+        {
+            enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            createInfo.pNext = &indexingFeatures;
+        }
+
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         if (enableValidationLayers)
         {
@@ -851,38 +977,82 @@ private: // Vulkan Initialiazation
         }
     }
 
-    // Descriptor Set Layout
+    // The offscreen scene, same color attachment as renderPass plus a depth buffer that is
+    // cleared on load and never stored, it can live in lazily allocated memory
+    void createSceneRenderPass()
+    {
+        depthFormat = findDepthFormat();
 
-    void createDescriptorSetLayout() {
-        VkDescriptorSetLayoutBinding uboLayoutBinding{};
-        uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = swapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &uboLayoutBinding;
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = depthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &renderDescriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout!");
-        }
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depthAttachmentRef{};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-        samplerLayoutBinding.binding = 0;
-        samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
-        samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = 0;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &samplerLayoutBinding;
+        std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &sceneRenderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create scene render pass!");
+        }
+    }
+
+    VkFormat findDepthFormat()
+    {
+        for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM})
+        {
+            VkFormatProperties properties = deviceProfile.getFormatProperties(format);
 
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &presentDescriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout!");
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                return format;
         }
 
+        throw std::runtime_error("failed to find a depth format!");
     }
 
     // Graphics Pipeline
@@ -893,19 +1063,45 @@ private: // Vulkan Initialiazation
     {
         renderPipeline.init({
             device,
-            renderPass,
+            sceneRenderPass,
             swapChainExtent,
-            {renderDescriptorSetLayout},
+            &layoutCache,
+            pipelineCache.get(),
+            &shaderStore,
         });
 
+        presentPipeline.setBindless(bindlessEnabled);
         presentPipeline.init({
             device,
             renderPass,
             swapChainExtent,
-            {presentDescriptorSetLayout},
+            &layoutCache,
+            pipelineCache.get(),
+            &shaderStore,
+        });
+
+        upscalePipeline.setFilter(PresentFilter::EdgeAdaptive);
+        upscalePipeline.init({
+            device,
+            renderPass,
+            swapChainExtent,
+            &layoutCache,
+            pipelineCache.get(),
+            &shaderStore,
         });
     }
 
+    void createPipelineRegistry()
+    {
+        pipelineRegistry.init(device, &jobSystem, "pipeline_warmup.bin");
+        pipelineRegistry.add(&renderPipeline);
+        pipelineRegistry.add(&presentPipeline);
+        pipelineRegistry.add(&upscalePipeline);
+        pipelineRegistry.warmUp();
+
+        shaderWatcher.init("shaders");
+    }
+
     // Framebuffers
     void createFramebuffers()
     {
@@ -964,126 +1160,330 @@ private: // Vulkan Initialiazation
         allocatorInfo.physicalDevice = physicalDevice;
         allocatorInfo.device = device;
         allocatorInfo.instance = instance;
+        allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
 
         vmaCreateAllocator(&allocatorInfo, &allocator);
+
+        MemoryPoolsCreateInfo poolsCreateInfo = {};
+        poolsCreateInfo.renderTargetFormat = swapChainImageFormat;
+
+        memoryPools.init(allocator, poolsCreateInfo);
     }
 
-    // Vertex Buffer
+    // Asset Archive
 
-    void createVertexBuffer()
+    void openAssetArchive()
     {
-        VkDeviceSize bufferSize = sizeof(renderTargetVertices[0]) * renderTargetVertices.size();
-        CreateBufferInfo bufferCreateInfo = {};
-        bufferCreateInfo.size = bufferSize;
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-        bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-        bufferCreateInfo.queueFamilyIndices = {
-            queueFamilyIndices.graphicsFamily.value().family,
-            queueFamilyIndices.transferFamily.value().family};
+        std::error_code error;
+        auto archiveTime = std::filesystem::last_write_time(assetArchivePath, error);
+        bool stale = error.value() != 0;
 
-        StagingBuffer stagingBuffer = {};
+        std::vector<std::filesystem::path> shaderFiles;
+        for (const auto &entry : std::filesystem::directory_iterator("shaders", error))
+        {
+            if (entry.path().extension() != ".spv")
+                continue;
 
-        createBuffer(bufferCreateInfo, stagingBuffer.allocation, stagingBuffer.buffer);
+            shaderFiles.push_back(entry.path());
+            if (entry.last_write_time(error) > archiveTime)
+                stale = true;
+        }
+        std::sort(shaderFiles.begin(), shaderFiles.end());
 
-        void *data;
-        vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-        memcpy(data, renderTargetVertices.data(), (size_t)bufferSize);
-        vmaUnmapMemory(allocator, stagingBuffer.allocation);
+        // The built in meshes come with the executable and shaders can be added or deleted
+        // without touching the archive, neither shows in modification times
+        uint64_t sourceHash = hashAssetSources(shaderFiles);
 
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-        bufferCreateInfo.flags = {};
+        if (!stale && assetArchive.open(assetArchivePath))
+        {
+            if (assetArchive.getSourceHash() == sourceHash)
+            {
+                std::cerr << "Loaded asset archive: " << assetArchive.getEntryCount() << " assets, " << assetArchive.getSize() / 1024 << " KB" << std::endl;
+                return;
+            }
 
-        createBuffer(bufferCreateInfo, renderVertexBuffer.allocation, renderVertexBuffer.buffer);
+            assetArchive.close();
+        }
 
-        copyBuffer(stagingBuffer, renderVertexBuffer, bufferSize);
-        
-        vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+        AssetArchiveWriter writer;
+        writer.setSourceHash(sourceHash);
+        addOptimizedMesh(writer, "meshes/render_target", renderTargetVertices, renderTargetIndices);
+        addOptimizedMesh(writer, "meshes/present", presentVertices, presentIndices);
 
-        bufferSize = sizeof(presentVertices[0]) * presentVertices.size();
-        bufferCreateInfo.size = bufferSize;
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-        bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-        bufferCreateInfo.queueFamilyIndices = {
+        for (const auto &shaderFile : shaderFiles)
+            writer.addFile("shaders/" + shaderFile.filename().string(), AssetType::Shader, shaderFile.string());
+
+        // Without an archive everything still loads, from the built in meshes and the shader files
+        if (!writer.write(assetArchivePath) || !assetArchive.open(assetArchivePath))
+        {
+            std::cerr << "Running without an asset archive" << std::endl;
+            return;
+        }
+
+        std::cerr << "Built asset archive: " << assetArchive.getEntryCount() << " assets, " << assetArchive.getSize() / 1024 << " KB" << std::endl;
+    }
+
+    uint64_t hashAssetSources(const std::vector<std::filesystem::path> &shaderFiles)
+    {
+        uint64_t hash = Hash::fnv1a(&MeshOptimizer::version, sizeof(MeshOptimizer::version));
+        hash = hashMeshSource(renderTargetVertices, renderTargetIndices, hash);
+        hash = hashMeshSource(presentVertices, presentIndices, hash);
+
+        for (const auto &shaderFile : shaderFiles)
+        {
+            std::string name = shaderFile.filename().string();
+            hash = Hash::fnv1a(name.c_str(), name.size() + 1, hash);
+        }
+
+        return hash;
+    }
+
+    template <typename Vertex>
+    uint64_t hashMeshSource(const std::vector<Vertex> &vertices, const std::vector<GeometryPool::Index> &indices, uint64_t hash)
+    {
+        uint64_t counts[3] = {sizeof(Vertex), vertices.size(), indices.size()};
+        hash = Hash::fnv1a(counts, sizeof(counts), hash);
+        hash = Hash::fnv1a(vertices.data(), vertices.size() * sizeof(Vertex), hash);
+        return Hash::fnv1a(indices.data(), indices.size() * sizeof(GeometryPool::Index), hash);
+    }
+
+    // Built in meshes are archived with their triangles in vertex cache order and vertices in fetch order
+    template <typename Vertex>
+    void addOptimizedMesh(AssetArchiveWriter &writer, const std::string &name, std::vector<Vertex> vertices, std::vector<GeometryPool::Index> indices)
+    {
+        size_t vertexCount = vertices.size();
+        MeshOptimizer::optimize(vertices.data(), vertexCount, sizeof(Vertex), indices);
+
+        writer.addMesh(name, vertices.data(), static_cast<uint32_t>(vertexCount), sizeof(Vertex), indices.data(), static_cast<uint32_t>(indices.size()));
+    }
+
+    // The archived copy unless it is missing or was written with another vertex layout
+    template <typename Vertex>
+    MeshAsset getMeshAsset(const std::string &name, const std::vector<Vertex> &vertices, const std::vector<GeometryPool::Index> &indices)
+    {
+        MeshAsset mesh;
+        if (assetArchive.findMesh(name, mesh) && mesh.vertexStride == sizeof(Vertex))
+            return mesh;
+
+        mesh.vertices = vertices.data();
+        mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+        mesh.vertexStride = sizeof(Vertex);
+        mesh.indices = indices.data();
+        mesh.indexCount = static_cast<uint32_t>(indices.size());
+        return mesh;
+    }
+
+    // Geometry Pool
+
+    void createGeometryPool()
+    {
+        GeometryPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.queueFamilyIndices = {
             queueFamilyIndices.graphicsFamily.value().family,
             queueFamilyIndices.transferFamily.value().family};
+        poolCreateInfo.memoryPool = memoryPools.get(MemoryClass::StaticGeometry);
 
-        createBuffer(bufferCreateInfo, stagingBuffer.allocation, stagingBuffer.buffer);
-
-        vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-        memcpy(data, presentVertices.data(), (size_t)bufferSize);
-        vmaUnmapMemory(allocator, stagingBuffer.allocation);
+        // Imported models come on top of the built-in meshes
+        for (const auto &model : importedModels)
+        {
+            poolCreateInfo.vertexBufferSize += model.getVertexCount() * sizeof(RenderPipeline::Vertex);
+            poolCreateInfo.indexBufferSize += model.getIndexCount() * sizeof(GeometryPool::Index);
+        }
 
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-        bufferCreateInfo.flags = {};
+        geometryPool.init(allocator, poolCreateInfo);
 
-        createBuffer(bufferCreateInfo, presentVertexBuffer.allocation, presentVertexBuffer.buffer);
+        renderTargetMesh = uploadMesh(getMeshAsset("meshes/render_target", renderTargetVertices, renderTargetIndices));
+        presentMesh = uploadMesh(getMeshAsset("meshes/present", presentVertices, presentIndices));
 
-        copyBuffer(stagingBuffer, presentVertexBuffer, bufferSize);
+        geometryPool.printStatistics();
+    }
 
-        vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+    void createMipGenerator()
+    {
+        MipGeneratorCreateInfo mipCreateInfo = {};
+        mipCreateInfo.device = device;
+        mipCreateInfo.deviceProfile = &deviceProfile;
+        mipCreateInfo.allocator = allocator;
+        mipCreateInfo.layoutCache = &layoutCache;
+        mipCreateInfo.shaderStore = &shaderStore;
+        mipCreateInfo.samplerCache = &samplerCache;
+        mipCreateInfo.pipelineCache = pipelineCache.get();
+
+        mipGenerator.init(mipCreateInfo);
     }
 
-    // Index Buffer
+    void createClusterCuller()
+    {
+        ClusterCullerCreateInfo cullerCreateInfo = {};
+        cullerCreateInfo.device = device;
+        cullerCreateInfo.deviceProfile = &deviceProfile;
+        cullerCreateInfo.allocator = allocator;
+        cullerCreateInfo.layoutCache = &layoutCache;
+        cullerCreateInfo.shaderStore = &shaderStore;
+        cullerCreateInfo.pipelineCache = pipelineCache.get();
+        cullerCreateInfo.enabledFeatures = enabledFeatures;
+
+        clusterCuller.init(cullerCreateInfo);
+    }
 
-    void createIndexBuffer()
+    void createTextureStreamer()
     {
-        VkDeviceSize bufferSize = sizeof(renderTargetIndices[0]) * renderTargetIndices.size();
-        CreateBufferInfo bufferCreateInfo = {};
-        bufferCreateInfo.size = bufferSize;
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-        bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-        bufferCreateInfo.queueFamilyIndices = {
+        UploadManagerCreateInfo uploadCreateInfo = {};
+        uploadCreateInfo.device = device;
+        uploadCreateInfo.allocator = allocator;
+        uploadCreateInfo.transferQueue = transferQueue;
+        uploadCreateInfo.transferFamily = queueFamilyIndices.transferFamily.value().family;
+        uploadCreateInfo.stagingPool = memoryPools.get(MemoryClass::HostVisible);
+
+        uploadManager.init(uploadCreateInfo);
+
+        TextureStreamerCreateInfo streamerCreateInfo = {};
+        streamerCreateInfo.device = device;
+        streamerCreateInfo.allocator = allocator;
+        streamerCreateInfo.jobSystem = &jobSystem;
+        streamerCreateInfo.uploadManager = &uploadManager;
+        streamerCreateInfo.samplerCache = &samplerCache;
+        streamerCreateInfo.bindlessHeap = bindlessEnabled ? &bindlessHeap : nullptr;
+        streamerCreateInfo.mipGenerator = &mipGenerator;
+        streamerCreateInfo.formats = TextureFormats::query(deviceProfile, enabledFeatures);
+        streamerCreateInfo.queueFamilyIndices = {
             queueFamilyIndices.graphicsFamily.value().family,
             queueFamilyIndices.transferFamily.value().family};
 
-        StagingBuffer stagingBuffer = {};
+        textureStreamer.init(streamerCreateInfo);
 
-        createBuffer(bufferCreateInfo, stagingBuffer.allocation, stagingBuffer.buffer);
+        // Textures given on the command line, drawn as previews along the bottom of the window
+        for (const auto &path : texturePaths)
+            textureHandles.push_back(textureStreamer.load(path));
+    }
 
-        void *data;
-        vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-        memcpy(data, renderTargetIndices.data(), (size_t)bufferSize);
-        vmaUnmapMemory(allocator, stagingBuffer.allocation);
+    // Previews are squares in a row, a quarter of the window height at most
+    uint32_t getTexturePreviewSize() const
+    {
+        if (textureHandles.empty())
+            return 0;
 
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-        bufferCreateInfo.flags = {};
+        return std::min(swapChainExtent.height / 4, swapChainExtent.width / static_cast<uint32_t>(textureHandles.size()));
+    }
 
-        createBuffer(bufferCreateInfo, renderIndexBuffer.allocation, renderIndexBuffer.buffer);
+    // Streamed textures through the bilinear present pipeline, sampled from the bindless heap
+    // when it's enabled. The views only cover the levels resident so far.
+    void drawTexturePreviews(VkCommandBuffer _commandBuffer, DescriptorAllocator &descriptorAllocator)
+    {
+        uint32_t previewSize = getTexturePreviewSize();
+        if (previewSize == 0)
+            return;
 
-        copyBuffer(stagingBuffer, renderIndexBuffer, bufferSize);
+        commandEncoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.getPipeline());
+        if (presentPipeline.isBindless())
+            commandEncoder.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.getPipelineLayout(), BindlessHeap::set, bindlessHeap.getSet());
+
+        PresentPipeline::PushConstants pushConstants{};
+        pushConstants.uvScale[0] = 1.0f;
+        pushConstants.uvScale[1] = 1.0f;
+        pushConstants.uvMax[0] = 1.0f;
+        pushConstants.uvMax[1] = 1.0f;
+
+        for (uint32_t i = 0; i < textureHandles.size(); i++)
+        {
+            TextureStreamer::View view = textureStreamer.get(textureHandles[i]);
+            if (!view.ready)
+                continue;
+
+            VkViewport viewport{};
+            viewport.x = static_cast<float>(i * previewSize);
+            viewport.y = static_cast<float>(swapChainExtent.height - previewSize);
+            viewport.width = static_cast<float>(previewSize);
+            viewport.height = static_cast<float>(previewSize);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            commandEncoder.setViewport(viewport);
+
+            VkRect2D scissor{};
+            scissor.offset = {static_cast<int32_t>(i * previewSize), static_cast<int32_t>(swapChainExtent.height - previewSize)};
+            scissor.extent = {previewSize, previewSize};
+            commandEncoder.setScissor(scissor);
+
+            if (presentPipeline.isBindless()) {
+                pushConstants.textureIndex = view.bindlessIndex;
+            } else {
+                VkDescriptorSetLayout previewSetLayout = presentPipeline.getDescriptorSetLayout(0);
+                VkDescriptorSet previewDescriptorSet = descriptorAllocator.allocate(previewSetLayout);
+
+                DescriptorInfo previewDescriptor{};
+                previewDescriptor.image = {view.sampler, view.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                layoutCache.update(previewDescriptorSet, previewSetLayout, &previewDescriptor);
+
+                commandEncoder.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.getPipelineLayout(), 0, previewDescriptorSet);
+            }
 
-        vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+            vkCmdPushConstants(_commandBuffer, presentPipeline.getPipelineLayout(), presentPipeline.getPushConstantStages(), 0, sizeof(pushConstants), &pushConstants);
 
-        bufferSize = sizeof(presentIndices[0]) * presentIndices.size();
-        bufferCreateInfo.size = bufferSize;
+            vkCmdDrawIndexed(_commandBuffer, presentMesh.indexCount, 1, presentMesh.firstIndex, presentMesh.vertexOffset, 0);
+        }
+    }
+
+    // Models given on the command line, parsed before the geometry pool is sized for them
+    void importModels()
+    {
+        for (size_t i = 0; i < modelPaths.size(); i++)
+        {
+            importStatistics.emplace_back();
+            importedModels.push_back(MeshImporter::load(modelPaths[i], jobSystem, importStatistics[i]));
+        }
+    }
+
+    // Models are quantized to their own bounds and drawn as they are, filling the unit cube
+    void uploadModels()
+    {
+        for (size_t i = 0; i < importedModels.size(); i++)
+        {
+            std::vector<LodMesh> meshes = MeshImporter::upload(importedModels[i], geometryPool, uploadManager, importStatistics[i]);
+            modelMeshes.insert(modelMeshes.end(), meshes.begin(), meshes.end());
+            importStatistics[i].print(modelPaths[i]);
+        }
+
+        clusterCuller.upload(modelMeshes);
+
+        // Everything is on the GPU, the CPU copies aren't needed anymore
+        importedModels.clear();
+        importStatistics.clear();
+    }
+
+    // Archived meshes are copied from the mapped file straight into staging memory
+    Mesh uploadMesh(const MeshAsset &asset)
+    {
+        Mesh mesh = geometryPool.allocate(asset.vertexCount, asset.vertexStride, asset.indexCount);
+
+        VkDeviceSize vertexSize = (VkDeviceSize)asset.vertexCount * asset.vertexStride;
+        VkDeviceSize indexSize = sizeof(GeometryPool::Index) * asset.indexCount;
+
+        CreateBufferInfo bufferCreateInfo = {};
+        bufferCreateInfo.size = vertexSize + indexSize;
         bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
         bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
         bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
         bufferCreateInfo.queueFamilyIndices = {
             queueFamilyIndices.graphicsFamily.value().family,
             queueFamilyIndices.transferFamily.value().family};
+        bufferCreateInfo.pool = memoryPools.get(MemoryClass::Transient);
+
+        StagingBuffer stagingBuffer = {};
 
         createBuffer(bufferCreateInfo, stagingBuffer.allocation, stagingBuffer.buffer);
 
+        void *data;
         vmaMapMemory(allocator, stagingBuffer.allocation, &data);
-        memcpy(data, presentIndices.data(), (size_t)bufferSize);
+        memcpy(data, asset.vertices, (size_t)vertexSize);
+        memcpy(static_cast<char *>(data) + vertexSize, asset.indices, (size_t)indexSize);
         vmaUnmapMemory(allocator, stagingBuffer.allocation);
 
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-        bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-        bufferCreateInfo.flags = {};
-
-        createBuffer(bufferCreateInfo, presentIndexBuffer.allocation, presentIndexBuffer.buffer);
-
-        copyBuffer(stagingBuffer, presentIndexBuffer, bufferSize);
+        copyBuffer(stagingBuffer, geometryPool.vertexBuffer, vertexSize, 0, mesh.vertexByteOffset);
+        copyBuffer(stagingBuffer, geometryPool.indexBuffer, indexSize, vertexSize, mesh.indexByteOffset);
 
         vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+
+        return mesh;
     }
 
     // Uniform Buffer 
@@ -1097,9 +1497,18 @@ private: // Vulkan Initialiazation
             CreateBufferInfo bufferCreateInfo = {};
             bufferCreateInfo.size = bufferSize;
             bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-            bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-            bufferCreateInfo.flags = {};
+            bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+            bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
             bufferCreateInfo.queueFamilyIndices = {};
+            bufferCreateInfo.pool = memoryPools.get(MemoryClass::HostVisible);
+
+            // With the whole of device local memory mappable the shaders read uniforms from
+            // video memory and the host writes them there directly
+            if (deviceProfile.resizableBar)
+            {
+                bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+                bufferCreateInfo.pool = VK_NULL_HANDLE;
+            }
 
 
             createBuffer(bufferCreateInfo, uniformBuffers[i].allocation, uniformBuffers[i].buffer);
@@ -1108,190 +1517,102 @@ private: // Vulkan Initialiazation
         }
     }
 
-    // Descriptor Pool
-
-    void createDescriptorPool() {
-        std::array<VkDescriptorPoolSize, 1> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-
-        VkDescriptorPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
-
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &renderDescriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
-        }
-
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
-
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &presentDescriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
-        }
+    // Descriptor Allocators
 
+    // One allocator per frame in flight, sets are allocated and written while recording
+    // and the whole allocator is reset once the frame's fence has signaled
+    void createDescriptorAllocators() {
+        descriptorAllocators.resize(framesInFlight);
+        for (auto &descriptorAllocator : descriptorAllocators)
+            descriptorAllocator.init(device);
     }
 
-    // Descriptor Sets
-
-    void createDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), renderDescriptorSetLayout);
-
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = renderDescriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-        allocInfo.pSetLayouts = layouts.data();
-
-        renderDescriptorSets.resize(swapChainImages.size());
-        if (vkAllocateDescriptorSets(device, &allocInfo, renderDescriptorSets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-
-        for (size_t i = 0; i < swapChainImages.size(); i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i].buffer;
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-
-            VkWriteDescriptorSet descriptorWrite{};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = renderDescriptorSets[i];
-            descriptorWrite.dstBinding = 0;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.pBufferInfo = &bufferInfo;
-
-            vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
-        }
-
-        createPresentDescriptorSets();
-    }
-
-    void createPresentDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), presentDescriptorSetLayout);
-
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-
-        allocInfo.descriptorPool = presentDescriptorPool;
-        allocInfo.pSetLayouts = layouts.data();
-
-        presentDescriptorSets.resize(swapChainImages.size());
-        if (vkAllocateDescriptorSets(device, &allocInfo, presentDescriptorSets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
+    void createGpuTimer()
+    {
+        GpuTimerCreateInfo timerCreateInfo = {};
+        timerCreateInfo.device = device;
+        timerCreateInfo.deviceProfile = &deviceProfile;
+        timerCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value().family;
+        timerCreateInfo.framesInFlight = framesInFlight;
 
-        updatePresentDescriptorSets();
+        gpuTimer.init(timerCreateInfo);
     }
 
-    void updatePresentDescriptorSets() {
-        for (size_t i = 0; i < swapChainImages.size(); i++) {
-            // Image 
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = renderTargets[i].imageView;
-            imageInfo.sampler = renderTargets[i].sampler;
-
-            VkWriteDescriptorSet descriptorWrite{};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = presentDescriptorSets[i];
-            descriptorWrite.dstBinding = 0;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.pImageInfo = &imageInfo;
+    // Without timestamps the controller gets no timings and the scene stays at full resolution
+    void createResolutionController()
+    {
+        ResolutionControllerCreateInfo controllerCreateInfo = {};
+        controllerCreateInfo.targetMilliseconds = 1000.0 / 60.0;
+        controllerCreateInfo.minScale = 0.5f;
+        controllerCreateInfo.maxScale = 1.0f;
 
-            vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
-        }
+        resolutionController.init(controllerCreateInfo);
     }
 
     // Create render targets 
+    // The offscreen target comes from the pool every frame, only its description and the
+    // sampler reading it are fixed here
     void createRenderTargets() {
-        const VkExtent2D extent = swapChainExtent;
-
-        renderTargets.resize(framesInFlight);
-
-        VkImageCreateInfo imageInfo = {};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent.width = extent.width;
-        imageInfo.extent.height = extent.height;
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
-        imageInfo.format = swapChainImageFormat;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.flags = 0;
-
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        for (size_t i = 0; i < framesInFlight; i++) {
-            if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &renderTargets[i].image, &renderTargets[i].allocation, nullptr) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create render target image!");
-            }
-
-            renderTargets[i].extent = extent;
-
-            VkImageViewCreateInfo viewInfo = {};
-            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            viewInfo.image = renderTargets[i].image;
-            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            viewInfo.format = swapChainImageFormat;
-            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            viewInfo.subresourceRange.baseMipLevel = 0;
-            viewInfo.subresourceRange.levelCount = 1;
-            viewInfo.subresourceRange.baseArrayLayer = 0;
-            viewInfo.subresourceRange.layerCount = 1;
-
-
-            if (vkCreateImageView(device, &viewInfo, nullptr, &renderTargets[i].imageView) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create render target image view!");
-            }
-
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = renderPass;
-            framebufferInfo.attachmentCount = 1;
-            framebufferInfo.pAttachments = &renderTargets[i].imageView;
-            framebufferInfo.width = extent.width;
-            framebufferInfo.height = extent.height;
-            framebufferInfo.layers = 1;
-
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &renderTargets[i].framebuffer) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
-
-            VkSamplerCreateInfo samplerInfo = {};
-            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-            samplerInfo.magFilter = VK_FILTER_LINEAR;
-            samplerInfo.minFilter = VK_FILTER_LINEAR;
-            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
-            samplerInfo.anisotropyEnable = VK_FALSE;
-
-            if (vkCreateSampler(device, &samplerInfo, nullptr, &renderTargets[i].sampler) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create texture sampler!");
-            }
+        resolutionController.setOutputExtent(swapChainExtent);
+        setRenderTargetExtent(resolutionController.getTargetExtent());
+
+        RenderTargetPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.device = device;
+        poolCreateInfo.allocator = allocator;
+        poolCreateInfo.pool = memoryPools.get(MemoryClass::RenderTarget);
+        poolCreateInfo.mipGenerator = &mipGenerator;
+
+        renderTargetPool.init(poolCreateInfo);
+
+        VkSamplerCreateInfo samplerInfo = {};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        renderTargetSampler = samplerCache.get(samplerInfo);
+
+        // Slots keep their index across resizes, the views they hold are gone
+        renderTargetSlots.resize(framesInFlight);
+        for (auto &slot : renderTargetSlots)
+            slot.imageView = VK_NULL_HANDLE;
+    }
 
+    void setRenderTargetExtent(VkExtent2D extent) {
+        const uint32_t mipLevels = MipGenerator::getMipCount(extent);
+
+        // Full chain, so minified reads of the target don't go through level 0
+        renderTargetDesc = {};
+        renderTargetDesc.extent = extent;
+        renderTargetDesc.format = swapChainImageFormat;
+        renderTargetDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | mipGenerator.getImageUsage(swapChainImageFormat, mipLevels);
+        renderTargetDesc.flags = mipGenerator.getImageFlags(swapChainImageFormat, mipLevels);
+        renderTargetDesc.mipLevels = mipLevels;
+
+        depthTargetDesc = {};
+        depthTargetDesc.extent = extent;
+        depthTargetDesc.format = depthFormat;
+        depthTargetDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        depthTargetDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        depthTargetDesc.transient = true;
+    }
 
-        }
+    // Bindless slot of the frame, rewritten when the pool hands out another image. The
+    // frame's fence has signaled, nothing submitted reads the slot anymore.
+    uint32_t getRenderTargetTextureIndex(const RenderTarget &renderTarget) {
+        RenderTargetSlot &slot = renderTargetSlots[currentFrame];
+        if (slot.textureIndex == BindlessHeap::invalidIndex)
+            slot.textureIndex = bindlessHeap.addTexture(renderTarget.imageView, renderTargetSampler);
+        else if (slot.imageView != renderTarget.imageView)
+            bindlessHeap.setTexture(slot.textureIndex, renderTarget.imageView, renderTargetSampler);
+
+        slot.imageView = renderTarget.imageView;
+        return slot.textureIndex;
     }
 
     // Resize render targets
@@ -1299,12 +1620,10 @@ private: // Vulkan Initialiazation
     void resizeRenderTargets() {
         cleanupRenderTargets();
         createRenderTargets();
-
-        updatePresentDescriptorSets();
     }
 
 
-    void copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer, VkDeviceSize size)
+    void copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0)
     {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1322,6 +1641,8 @@ private: // Vulkan Initialiazation
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
         VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
 
         vkCmdCopyBuffer(commandBuffer, srcBuffer.buffer, dstBuffer.buffer, 1, &copyRegion);
@@ -1343,30 +1664,7 @@ private: // Vulkan Initialiazation
                       VmaAllocation &allocation,
                       VkBuffer &buffer)
     {
-        VkBufferCreateInfo bufferInfo = {};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = bufferCreateInfo.size;
-        bufferInfo.usage = bufferCreateInfo.usage;
-
-        std::set<uint32_t> uniqueQueueFamilyIndices(bufferCreateInfo.queueFamilyIndices.begin(), bufferCreateInfo.queueFamilyIndices.end());
-
-        if (uniqueQueueFamilyIndices.size() > 1)
-        {
-            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(uniqueQueueFamilyIndices.size());
-            bufferInfo.pQueueFamilyIndices = bufferCreateInfo.queueFamilyIndices.data();
-        }
-        else
-            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = bufferCreateInfo.memoryUsage;
-        allocInfo.flags = bufferCreateInfo.flags;
-
-        if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create buffer!");
-        }
+        ::createBuffer(bufferCreateInfo, allocator, allocation, buffer);
     }
 
     // Command Buffers
@@ -1398,63 +1696,104 @@ private: // Vulkan Initialiazation
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        // Graphics binds and dynamic state go through the encoder, compute passes below only
+        // bind compute state and don't disturb its shadow
+        commandEncoder.begin(_commandBuffer);
+
+        gpuTimer.begin(_commandBuffer, currentFrame);
+        uint32_t frameScope = gpuTimer.beginScope(_commandBuffer, "frame");
+
+        DescriptorAllocator &descriptorAllocator = descriptorAllocators[currentFrame];
+
+        // Textures that finished uploading since the last frame
+        mipGenerator.record(_commandBuffer, descriptorAllocator);
+
+        // The scene is drawn into the top left corner of the target, the pool hands out
+        // another target only when the controller resized it
+        VkExtent2D renderExtent = resolutionController.getRenderExtent();
+        VkExtent2D targetExtent = resolutionController.getTargetExtent();
+        if (renderTargetDesc.extent.width != targetExtent.width || renderTargetDesc.extent.height != targetExtent.height)
+            setRenderTargetExtent(targetExtent);
+
+        const RenderTarget &renderTarget = renderTargetPool.acquire(_commandBuffer, renderTargetDesc);
+        const RenderTarget &depthTarget = renderTargetPool.acquire(_commandBuffer, depthTargetDesc);
+        uint32_t sceneScope = gpuTimer.beginScope(_commandBuffer, "scene");
+
+        // Levels are picked before culling, only the clusters of the drawn level are tested
+        selectModelLods(renderExtent);
+        clusterCuller.cull(_commandBuffer, descriptorAllocator, modelMeshes, frameUniforms.model, frameUniforms.view, frameUniforms.proj, cameraPosition);
+
+        queueSceneDraws();
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = renderTargets[imageIndex].framebuffer;
+        renderPassInfo.renderPass = sceneRenderPass;
+        renderPassInfo.framebuffer = renderTargetPool.getFramebuffer(sceneRenderPass, {&renderTarget, &depthTarget});
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = renderTargets[imageIndex].extent;
+        renderPassInfo.renderArea.extent = renderExtent;
 
-        VkClearValue renderClearValue = {{{(float)(0x4A) / 255.f, (float)(0x41) / 255.f, (float)(0x2A) / 255.f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &renderClearValue;
+        std::array<VkClearValue, 2> renderClearValues{};
+        renderClearValues[0].color = {{(float)(0x4A) / 255.f, (float)(0x41) / 255.f, (float)(0x2A) / 255.f, 1.0f}};
+        renderClearValues[1].depthStencil = {1.0f, 0};
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(renderClearValues.size());
+        renderPassInfo.pClearValues = renderClearValues.data();
 
         vkCmdBeginRenderPass(_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderPipeline.getPipeline());
-
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(renderTargets[imageIndex].extent.width);
-        viewport.height = static_cast<float>(renderTargets[imageIndex].extent.height);
+        viewport.width = static_cast<float>(renderExtent.width);
+        viewport.height = static_cast<float>(renderExtent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+        commandEncoder.setViewport(viewport);
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
-        scissor.extent = renderTargets[imageIndex].extent;
-        vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+        scissor.extent = renderExtent;
+        commandEncoder.setScissor(scissor);
+
+        geometryPool.bind(commandEncoder);
 
-        VkBuffer renderVertexBuffers[] = {renderVertexBuffer.buffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(_commandBuffer, 0, 1, renderVertexBuffers, offsets);
+        VkDescriptorSetLayout renderSetLayout = renderPipeline.getDescriptorSetLayout(0);
+        VkDescriptorSet renderDescriptorSet = descriptorAllocator.allocate(renderSetLayout);
 
-        vkCmdBindIndexBuffer(_commandBuffer, renderIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+        // Binding order, the template skips the vertex buffer when the layout doesn't pull vertices
+        std::array<DescriptorInfo, 2> renderDescriptors{};
+        renderDescriptors[0].buffer = {uniformBuffers[currentFrame].buffer, 0, sizeof(UniformBufferObject)};
+        renderDescriptors[1].buffer = {geometryPool.vertexBuffer.buffer, 0, VK_WHOLE_SIZE};
+        layoutCache.update(renderDescriptorSet, renderSetLayout, renderDescriptors.data());
 
-        vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderPipeline.getPipelineLayout(), 0, 1, &renderDescriptorSets[currentFrame], 0, nullptr);
+        commandEncoder.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, renderPipeline.getPipelineLayout(), 0, renderDescriptorSet);
 
-        vkCmdDrawIndexed(_commandBuffer, static_cast<uint32_t>(renderTargetIndices.size()), 1, 0, 0, 0);
+        // Every scene state shares the pipeline layout, the encoder binds a pipeline only when
+        // the sorted draws move on to another state
+        for (const Draw &draw : drawQueue.getDraws())
+        {
+            commandEncoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineRegistry.get(renderPipeline, sceneStates[draw.pipeline]));
+
+            if (draw.payload == quadPayload)
+                vkCmdDrawIndexed(_commandBuffer, renderTargetMesh.indexCount, 1, renderTargetMesh.firstIndex, renderTargetMesh.vertexOffset, 0);
+            else
+                clusterCuller.drawMesh(_commandBuffer, modelMeshes[draw.payload]);
+        }
 
         vkCmdEndRenderPass(_commandBuffer);
 
-        VkImageMemoryBarrier barrier = {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = renderTargets[imageIndex].image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        // Depth isn't read after the scene, later targets of the frame may take its memory
+        renderTargetPool.release(depthTarget);
+
+        // The render pass leaves level 0 in PRESENT_SRC_KHR, the chain ends up ready for sampling
+        MipTarget renderTargetMips = {renderTarget.image, renderTarget.desc.format, renderTarget.desc.extent, renderTarget.desc.mipLevels};
+        mipGenerator.generate(_commandBuffer, descriptorAllocator, renderTargetMips, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        gpuTimer.endScope(_commandBuffer, sceneScope);
+
+        // Scenes drawn below the swapchain resolution go through the edge adaptive upscaler unless
+        // U switched it off, a full resolution scene is only copied
+        bool upscaled = renderExtent.width != swapChainExtent.width || renderExtent.height != swapChainExtent.height;
+        PresentPipeline &present = upscaled && presentUpscaling ? upscalePipeline : presentPipeline;
+        uint32_t presentScope = gpuTimer.beginScope(_commandBuffer, present.getFilter() == PresentFilter::EdgeAdaptive ? "present upscale" : "present bilinear");
 
         VkRenderPassBeginInfo presentRenderPassInfo{};
         presentRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -1469,8 +1808,7 @@ private: // Vulkan Initialiazation
 
         vkCmdBeginRenderPass(_commandBuffer, &presentRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.getPipeline());
-
+        commandEncoder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, present.getPipeline());
 
         VkViewport presentViewport{};
         presentViewport.x = 0.0f;
@@ -1479,26 +1817,53 @@ private: // Vulkan Initialiazation
         presentViewport.height = static_cast<float>(swapChainExtent.height);
         presentViewport.minDepth = 0.0f;
         presentViewport.maxDepth = 1.0f;
-        vkCmdSetViewport(_commandBuffer, 0, 1, &presentViewport);
+        commandEncoder.setViewport(presentViewport);
 
+        // At full resolution both are what the scene already set
         VkRect2D presentScissor{};
-
         presentScissor.offset = {0, 0};
         presentScissor.extent = swapChainExtent;
-        vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+        commandEncoder.setScissor(presentScissor);
+
+        // Still bound from the scene, the encoder skips both binds
+        geometryPool.bind(commandEncoder);
+
+        // Half a texel in from the edges of the drawn corner, filtering doesn't reach the rest of the target
+        PresentPipeline::PushConstants pushConstants{};
+        pushConstants.uvScale[0] = renderExtent.width / static_cast<float>(targetExtent.width);
+        pushConstants.uvScale[1] = renderExtent.height / static_cast<float>(targetExtent.height);
+        pushConstants.uvMin[0] = 0.5f / targetExtent.width;
+        pushConstants.uvMin[1] = 0.5f / targetExtent.height;
+        pushConstants.uvMax[0] = (renderExtent.width - 0.5f) / targetExtent.width;
+        pushConstants.uvMax[1] = (renderExtent.height - 0.5f) / targetExtent.height;
+        pushConstants.sharpness = presentSharpness;
 
-        VkBuffer presentVertexBuffers[] = {presentVertexBuffer.buffer};
+        if (present.isBindless()) {
+            commandEncoder.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, present.getPipelineLayout(), BindlessHeap::set, bindlessHeap.getSet());
 
-        vkCmdBindVertexBuffers(_commandBuffer, 0, 1, presentVertexBuffers, offsets);
+            pushConstants.textureIndex = getRenderTargetTextureIndex(renderTarget);
+        } else {
+            VkDescriptorSetLayout presentSetLayout = present.getDescriptorSetLayout(0);
+            VkDescriptorSet presentDescriptorSet = descriptorAllocator.allocate(presentSetLayout);
+
+            DescriptorInfo presentDescriptor{};
+            presentDescriptor.image = {renderTargetSampler, renderTarget.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            layoutCache.update(presentDescriptorSet, presentSetLayout, &presentDescriptor);
+
+            commandEncoder.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, present.getPipelineLayout(), 0, presentDescriptorSet);
+        }
 
-        vkCmdBindIndexBuffer(_commandBuffer, presentIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+        vkCmdPushConstants(_commandBuffer, present.getPipelineLayout(), present.getPushConstantStages(), 0, sizeof(pushConstants), &pushConstants);
 
-        vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.getPipelineLayout(), 0, 1, &presentDescriptorSets[currentFrame], 0, nullptr);
+        vkCmdDrawIndexed(_commandBuffer, presentMesh.indexCount, 1, presentMesh.firstIndex, presentMesh.vertexOffset, 0);
 
-        vkCmdDrawIndexed(_commandBuffer, static_cast<uint32_t>(presentIndices.size()), 1, 0, 0, 0);
+        drawTexturePreviews(_commandBuffer, descriptorAllocator);
 
         vkCmdEndRenderPass(_commandBuffer);
 
+        gpuTimer.endScope(_commandBuffer, presentScope);
+        gpuTimer.endScope(_commandBuffer, frameScope);
+
         if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to record command buffer!");
@@ -1542,6 +1907,12 @@ private: // Drawing logic (actions ran every frame)
 
         vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
 
+        // Timings of the last frame that used this slot, the scale applies from this frame on
+        if (gpuTimer.collect(currentFrame))
+            resolutionController.update(gpuTimer.getMilliseconds("frame"));
+
+        descriptorAllocators[currentFrame].reset();
+
         uint32_t imageIndex;
         VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 
@@ -1559,10 +1930,11 @@ private: // Drawing logic (actions ran every frame)
 
         vkResetCommandBuffer(commandBuffer, 0);
 
-        recordCommandBuffer(commandBuffer, imageIndex);
-
+        // Culling reads the frame's matrices while recording
         updateUniformBuffer(currentFrame);
 
+        recordCommandBuffer(commandBuffer, imageIndex);
+
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -1608,6 +1980,73 @@ private: // Drawing logic (actions ran every frame)
         }
 
         currentFrame = (currentFrame + 1) % framesInFlight;
+        frameNumber++;
+    }
+
+    // Fills the draw queue for the scene pass. Models are opaque, the quad blends while B
+    // has blending on. Everything is centered at the origin, depth is taken from there.
+    void queueSceneDraws()
+    {
+        PipelineStateKey opaqueKey = renderPipeline.getDefaultKey();
+        opaqueKey.blendEnable = VK_FALSE;
+
+        PipelineStateKey depthOnlyKey = opaqueKey;
+        depthOnlyKey.colorWriteMask = 0;
+
+        // Until the depth only variant is compiled the default pipeline would stand in and
+        // draw color, the prepass waits for it
+        bool prepass = depthPrepass && pipelineRegistry.tryGet(renderPipeline, depthOnlyKey) != VK_NULL_HANDLE;
+
+        // After a prepass only the nearest surface passes and depth is already written
+        if (prepass)
+        {
+            opaqueKey.depthWrite = VK_FALSE;
+            opaqueKey.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        }
+
+        PipelineStateKey transparentKey = renderPipeline.getDefaultKey();
+        transparentKey.blendEnable = VK_TRUE;
+        transparentKey.depthWrite = VK_FALSE;
+        transparentKey.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+        sceneStates = {depthOnlyKey, opaqueKey, transparentKey};
+
+        glm::mat4 modelView = frameUniforms.view * frameUniforms.model;
+        float depth = -(modelView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z;
+
+        drawQueue.begin(cameraFar);
+
+        for (uint32_t i = 0; i < modelMeshes.size(); i++)
+        {
+            drawQueue.add({DrawPass::Opaque, OpaquePipeline, 0, i, depth, i});
+            if (prepass)
+                drawQueue.add({DrawPass::DepthPrepass, DepthOnlyPipeline, 0, i, depth, i});
+        }
+
+        uint32_t quadMesh = static_cast<uint32_t>(modelMeshes.size());
+        if (renderBlending)
+        {
+            drawQueue.add({DrawPass::Transparent, TransparentPipeline, 0, quadMesh, depth, quadPayload});
+        }
+        else
+        {
+            drawQueue.add({DrawPass::Opaque, OpaquePipeline, 0, quadMesh, depth, quadPayload});
+            if (prepass)
+                drawQueue.add({DrawPass::DepthPrepass, DepthOnlyPipeline, 0, quadMesh, depth, quadPayload});
+        }
+
+        drawQueue.sort();
+    }
+
+    // Models are drawn in their [-1, 1] quantized cube around the origin, the distance is
+    // taken to its bounding sphere
+    void selectModelLods(VkExtent2D extent)
+    {
+        lodSelector.setProjection(cameraFov, static_cast<float>(extent.height));
+
+        float distance = glm::length(cameraPosition) - std::sqrt(3.0f);
+        for (auto &model : modelMeshes)
+            lodSelector.select(model, distance);
     }
 
     void updateUniformBuffer(uint32_t currentImage) {
@@ -1619,11 +2058,12 @@ private: // Drawing logic (actions ran every frame)
 
         UniformBufferObject ubo{};
         ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));        
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
+        ubo.view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.proj = glm::perspective(cameraFov, swapChainExtent.width / (float)swapChainExtent.height, cameraNear, cameraFar);
         ubo.proj[1][1] *= -1;
 
         memcpy(uniformBuffers[currentImage].mapped, &ubo, sizeof(ubo));
+        frameUniforms = ubo;
 
         
     }
@@ -1759,26 +2199,6 @@ private: // Vulkan Utils
         return details;
     }
 
-    static std::vector<char> readShader(const std::string &filename)
-    {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open())
-        {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
-    }
-
 private: // Vulkan checks
     void checkRequiredInstanceExtensions(const std::vector<const char *> &requiredExtensions)
     {
@@ -1842,22 +2262,10 @@ private: // Vulkan checks
         return true;
     }
 
-    bool checkDeviceExtensions(VkPhysicalDevice _physicalDevice)
+    bool checkDeviceExtensions(const DeviceProfile &profile)
     {
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
-
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
-
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-        for (const auto &extension : availableExtensions)
-        {
-            requiredExtensions.erase(extension.extensionName);
-        }
-
-        return requiredExtensions.empty();
+        return std::all_of(deviceExtensions.begin(), deviceExtensions.end(), [&](const char *extension)
+                           { return profile.hasExtension(extension); });
     }
 
 private:
@@ -1866,6 +2274,8 @@ private:
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    DeviceProfileCache deviceProfiles;
+    DeviceProfile deviceProfile;
     QueueFamilyIndices queueFamilyIndices;
     VkDevice device;
     VkQueue graphicsQueue;
@@ -1880,26 +2290,56 @@ private:
     std::vector<VkImageView> swapChainImageViews;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
-    VkDescriptorSetLayout renderDescriptorSetLayout, presentDescriptorSetLayout;
+    VkRenderPass sceneRenderPass;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
     PresentPipeline presentPipeline;
-    RenderPipeline renderPipeline; 
-    VkDescriptorPool renderDescriptorPool;
-    VkDescriptorPool presentDescriptorPool;
-
-    std::vector<VkDescriptorSet> 
-        renderDescriptorSets = {},
-        presentDescriptorSets = {}
-    ;
+    PresentPipeline upscalePipeline;
+    bool presentUpscaling = true;
+    float presentSharpness = 0.5f;
+    RenderPipeline renderPipeline{vertexInputMode};
+    ShaderStore shaderStore;
+    LayoutCache layoutCache;
+    PipelineCache pipelineCache;
+    PipelineRegistry pipelineRegistry;
+    ShaderWatcher shaderWatcher;
+    bool renderBlending = true;
+    SamplerCache samplerCache;
+    UploadManager uploadManager;
+    TextureStreamer textureStreamer;
+    MipGenerator mipGenerator;
+    BindlessHeap bindlessHeap;
+    bool bindlessEnabled = false;
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    AssetArchive assetArchive;
+    std::vector<DescriptorAllocator> descriptorAllocators;
     VkCommandPool graphicsCommandPool, transferCommandPool;
     VmaAllocator allocator;
-    VertexBuffer renderVertexBuffer;
-    IndexBuffer renderIndexBuffer;
-
-    VertexBuffer presentVertexBuffer;
-    IndexBuffer presentIndexBuffer;
+    MemoryPools memoryPools;
+    GeometryPool geometryPool;
+    Mesh renderTargetMesh;
+    Mesh presentMesh;
+    std::vector<std::string> modelPaths;
+    std::vector<std::string> texturePaths;
+    std::vector<TextureHandle> textureHandles;
+    std::vector<ImportedModel> importedModels;
+    std::vector<ImportStatistics> importStatistics;
+    std::vector<LodMesh> modelMeshes;
+    LodSelector lodSelector;
+    ClusterCuller clusterCuller;
+    DrawQueue drawQueue;
+    Engine::CommandEncoder commandEncoder;
+    std::array<PipelineStateKey, 3> sceneStates{};
+    bool depthPrepass = false;
+    UniformBufferObject frameUniforms{};
 
     std::vector<UniformBuffer> uniformBuffers;
-    std::vector<RenderTarget> renderTargets;
+    RenderTargetPool renderTargetPool;
+    RenderTargetDesc renderTargetDesc;
+    RenderTargetDesc depthTargetDesc;
+    VkSampler renderTargetSampler = VK_NULL_HANDLE;
+    std::vector<RenderTargetSlot> renderTargetSlots;
+    GpuTimer gpuTimer;
+    ResolutionController resolutionController;
 
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -1908,9 +2348,11 @@ private:
 
     uint32_t framesInFlight = 0;
     uint32_t currentFrame = 0;
+    uint64_t frameNumber = 0;
     bool framebufferResized = false;
 
 private: // Application
+    JobSystem jobSystem;
     std::chrono::steady_clock::time_point previousTime;
     typedef std::chrono::duration<float> duration;
     uint64_t frameCount = 0;
@@ -1919,13 +2361,13 @@ private: // Application
 
 // EndRegion Vulkan
 
-int main()
+int main(int argc, char **argv)
 {
     HelloTriangleApplication app;
 
     try
     {
-        app.run();
+        app.run(std::vector<std::string>(argv + 1, argv + argc));
     }
     catch (const std::exception &e)
     {
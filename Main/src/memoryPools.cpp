@@ -0,0 +1,147 @@
+#include "memoryPools.hpp"
+#include <stdexcept>
+#include <iostream>
+
+namespace
+{
+    VmaPool createPool(VmaAllocator allocator, uint32_t memoryTypeIndex, VmaPoolCreateFlags flags, const MemoryPoolConfig &config, const char *name)
+    {
+        VmaPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.memoryTypeIndex = memoryTypeIndex;
+        poolCreateInfo.flags = flags;
+        poolCreateInfo.blockSize = config.blockSize;
+        poolCreateInfo.minBlockCount = config.minBlockCount;
+        poolCreateInfo.maxBlockCount = config.maxBlockCount;
+
+        VmaPool pool;
+        if (vmaCreatePool(allocator, &poolCreateInfo, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create memory pool!");
+        }
+
+        vmaSetPoolName(allocator, pool, name);
+
+        return pool;
+    }
+}
+
+void MemoryPools::init(VmaAllocator _allocator, const MemoryPoolsCreateInfo &createInfo)
+{
+    allocator = _allocator;
+
+    // Sample create infos, only used to find a memory type index for each pool
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = 0x10000;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    uint32_t memoryTypeIndex = 0;
+
+    // Transient
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    if (vmaFindMemoryTypeIndexForBufferInfo(allocator, &bufferInfo, &allocInfo, &memoryTypeIndex) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to find memory type for transient pool!");
+    }
+
+    pools[static_cast<size_t>(MemoryClass::Transient)] = createPool(
+        allocator, memoryTypeIndex,
+        VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT | VMA_POOL_CREATE_IGNORE_BUFFER_IMAGE_GRANULARITY_BIT,
+        createInfo.transient, getName(MemoryClass::Transient));
+
+    // Host visible, same memory type but freed out of order, so not linear
+    pools[static_cast<size_t>(MemoryClass::HostVisible)] = createPool(
+        allocator, memoryTypeIndex,
+        VMA_POOL_CREATE_IGNORE_BUFFER_IMAGE_GRANULARITY_BIT,
+        createInfo.hostVisible, getName(MemoryClass::HostVisible));
+
+    // Static geometry
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    allocInfo.flags = {};
+
+    if (vmaFindMemoryTypeIndexForBufferInfo(allocator, &bufferInfo, &allocInfo, &memoryTypeIndex) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to find memory type for static geometry pool!");
+    }
+
+    pools[static_cast<size_t>(MemoryClass::StaticGeometry)] = createPool(
+        allocator, memoryTypeIndex,
+        VMA_POOL_CREATE_IGNORE_BUFFER_IMAGE_GRANULARITY_BIT,
+        createInfo.staticGeometry, getName(MemoryClass::StaticGeometry));
+
+    // Render targets
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {1, 1, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = createInfo.renderTargetFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Transfer usage for mip chains generated with blits
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (vmaFindMemoryTypeIndexForImageInfo(allocator, &imageInfo, &allocInfo, &memoryTypeIndex) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to find memory type for render target pool!");
+    }
+
+    pools[static_cast<size_t>(MemoryClass::RenderTarget)] = createPool(
+        allocator, memoryTypeIndex, 0,
+        createInfo.renderTarget, getName(MemoryClass::RenderTarget));
+}
+
+void MemoryPools::cleanup()
+{
+    for (auto &pool : pools)
+    {
+        vmaDestroyPool(allocator, pool);
+        pool = VK_NULL_HANDLE;
+    }
+}
+
+VmaDetailedStatistics MemoryPools::getStatistics(MemoryClass memoryClass) const
+{
+    VmaDetailedStatistics stats = {};
+    vmaCalculatePoolStatistics(allocator, get(memoryClass), &stats);
+    return stats;
+}
+
+void MemoryPools::printStatistics() const
+{
+    for (size_t i = 0; i < pools.size(); i++)
+    {
+        MemoryClass memoryClass = static_cast<MemoryClass>(i);
+        VmaDetailedStatistics stats = getStatistics(memoryClass);
+
+        std::cerr << "Memory Pool " << getName(memoryClass) << ": "
+                  << stats.statistics.blockCount << " blocks (" << stats.statistics.blockBytes << " bytes), "
+                  << stats.statistics.allocationCount << " allocations (" << stats.statistics.allocationBytes << " bytes), "
+                  << stats.unusedRangeCount << " free ranges" << std::endl;
+    }
+}
+
+const char *MemoryPools::getName(MemoryClass memoryClass)
+{
+    switch (memoryClass)
+    {
+    case MemoryClass::Transient:
+        return "Transient";
+    case MemoryClass::HostVisible:
+        return "HostVisible";
+    case MemoryClass::RenderTarget:
+        return "RenderTarget";
+    case MemoryClass::StaticGeometry:
+        return "StaticGeometry";
+    default:
+        return "Unknown";
+    }
+}
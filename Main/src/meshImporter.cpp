@@ -0,0 +1,1512 @@
+#include "meshImporter.hpp"
+#include "mappedFile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    using Vertex = RenderPipeline::Vertex;
+
+    [[noreturn]] void fail(const std::string &path, const std::string &reason)
+    {
+        throw std::runtime_error("failed to import " + path + ", " + reason + "!");
+    }
+
+    bool hasExtension(const std::string &path, const char *extension)
+    {
+        size_t length = std::strlen(extension);
+        if (path.size() < length)
+            return false;
+
+        return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+    }
+
+    uint32_t readU32(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 |
+               static_cast<uint32_t>(data[3]) << 24;
+    }
+
+    struct Bounds
+    {
+        glm::vec3 min = glm::vec3(HUGE_VALF);
+        glm::vec3 max = glm::vec3(-HUGE_VALF);
+
+        void add(glm::vec3 point)
+        {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void add(const Bounds &other)
+        {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        bool isEmpty() const { return min.x > max.x; }
+    };
+
+    void setBounds(ImportedModel &model, const Bounds &bounds)
+    {
+        if (bounds.isEmpty())
+            return;
+
+        // Flat models would divide by zero, their flat axis quantizes to 0 instead
+        model.boundsCenter = (bounds.min + bounds.max) * 0.5f;
+        model.boundsExtent = glm::max((bounds.max - bounds.min) * 0.5f, glm::vec3(1e-6f));
+    }
+
+    Vertex makeVertex(const ImportedModel &model, glm::vec3 position, glm::vec3 normal, glm::vec4 color)
+    {
+        float length = glm::length(normal);
+        normal = length > 1e-12f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        return Vertex::make((position - model.boundsCenter) / model.boundsExtent, normal, color);
+    }
+
+    // Area weighted face normals summed per vertex, for meshes that come without any
+    void addFaceNormals(const std::vector<glm::vec3> &positions, const std::vector<GeometryPool::Index> &indices, std::vector<glm::vec3> &normals)
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            glm::vec3 a = positions[indices[i]];
+            glm::vec3 b = positions[indices[i + 1]];
+            glm::vec3 c = positions[indices[i + 2]];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+
+            normals[indices[i]] += normal;
+            normals[indices[i + 1]] += normal;
+            normals[indices[i + 2]] += normal;
+        }
+    }
+
+    // Runs every task on the job system and waits, the first exception is rethrown here
+    // since jobs themselves must not throw
+    void runParallel(JobSystem &jobSystem, size_t count, const std::function<void(size_t)> &task)
+    {
+        std::mutex errorMutex;
+        std::string error;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            jobSystem.submit([&, i]() {
+                try
+                {
+                    task(i);
+                }
+                catch (const std::exception &e)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (error.empty())
+                        error = e.what();
+                }
+            });
+        }
+
+        jobSystem.wait();
+
+        if (!error.empty())
+            throw std::runtime_error(error);
+    }
+
+    // Just enough JSON for glTF, the whole document is held in memory
+    struct JsonValue
+    {
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+        Type type = Type::Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> array;
+        std::vector<std::pair<std::string, JsonValue>> object;
+
+        const JsonValue *find(const char *key) const
+        {
+            for (const auto &[name, value] : object)
+                if (name == key)
+                    return &value;
+            return nullptr;
+        }
+
+        // Missing keys and indices read as null
+        const JsonValue &operator[](const char *key) const
+        {
+            const JsonValue *value = find(key);
+            return value ? *value : getNull();
+        }
+
+        const JsonValue &operator[](size_t index) const { return index < array.size() ? array[index] : getNull(); }
+
+        size_t size() const { return array.size(); }
+
+        // Up to the first four numbers of an array, the rest left at zero
+        glm::vec4 getVector() const
+        {
+            glm::vec4 vector(0.0f);
+            for (size_t i = 0; i < std::min<size_t>(array.size(), 4); i++)
+                vector[static_cast<glm::length_t>(i)] = static_cast<float>(array[i].number);
+            return vector;
+        }
+
+        double getNumber(const char *key, double fallback) const
+        {
+            const JsonValue *value = find(key);
+            return value && value->type == Type::Number ? value->number : fallback;
+        }
+
+        static const JsonValue &getNull()
+        {
+            static const JsonValue null;
+            return null;
+        }
+    };
+
+    struct JsonParser
+    {
+        const std::string &path;
+        const char *position;
+        const char *end;
+
+        static constexpr int maxDepth = 256;
+
+        JsonValue parse()
+        {
+            JsonValue value = parseValue(0);
+            skipSpaces();
+            if (position != end)
+                fail(path, "trailing characters after the JSON document");
+            return value;
+        }
+
+        void skipSpaces()
+        {
+            while (position < end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+                position++;
+        }
+
+        bool consume(char c)
+        {
+            skipSpaces();
+            if (position < end && *position == c)
+            {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            if (!consume(c))
+                fail(path, std::string("malformed JSON, expected '") + c + "'");
+        }
+
+        bool consumeWord(const char *word)
+        {
+            size_t length = std::strlen(word);
+            if (static_cast<size_t>(end - position) < length || std::memcmp(position, word, length) != 0)
+                return false;
+            position += length;
+            return true;
+        }
+
+        JsonValue parseValue(int depth)
+        {
+            if (depth > maxDepth)
+                fail(path, "JSON nested too deeply");
+
+            skipSpaces();
+            if (position >= end)
+                fail(path, "truncated JSON");
+
+            JsonValue value;
+            char c = *position;
+
+            if (c == '{')
+            {
+                position++;
+                value.type = JsonValue::Type::Object;
+                if (consume('}'))
+                    return value;
+
+                do
+                {
+                    skipSpaces();
+                    std::string key = parseString();
+                    expect(':');
+                    value.object.emplace_back(std::move(key), parseValue(depth + 1));
+                } while (consume(','));
+
+                expect('}');
+            }
+            else if (c == '[')
+            {
+                position++;
+                value.type = JsonValue::Type::Array;
+                if (consume(']'))
+                    return value;
+
+                do
+                    value.array.push_back(parseValue(depth + 1));
+                while (consume(','));
+
+                expect(']');
+            }
+            else if (c == '"')
+            {
+                value.type = JsonValue::Type::String;
+                value.string = parseString();
+            }
+            else if (consumeWord("true") || consumeWord("false"))
+            {
+                value.type = JsonValue::Type::Bool;
+                value.boolean = position[-1] == 'e' && position[-2] == 'u';
+            }
+            else if (consumeWord("null"))
+            {
+                value.type = JsonValue::Type::Null;
+            }
+            else
+            {
+                // strtod wants a terminated string, JSON numbers are short
+                char buffer[64];
+                size_t length = 0;
+                while (position < end && length < sizeof(buffer) - 1 && std::strchr("+-0123456789.eE", *position))
+                    buffer[length++] = *position++;
+                buffer[length] = '\0';
+
+                char *parsedEnd;
+                value.type = JsonValue::Type::Number;
+                value.number = std::strtod(buffer, &parsedEnd);
+                if (length == 0 || parsedEnd != buffer + length)
+                    fail(path, "malformed JSON number");
+            }
+
+            return value;
+        }
+
+        void appendUtf8(std::string &string, uint32_t codePoint)
+        {
+            if (codePoint < 0x80)
+                string += static_cast<char>(codePoint);
+            else if (codePoint < 0x800)
+            {
+                string += static_cast<char>(0xC0 | codePoint >> 6);
+                string += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                string += static_cast<char>(0xE0 | codePoint >> 12);
+                string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+                string += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                string += static_cast<char>(0xF0 | codePoint >> 18);
+                string += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+                string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+                string += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        uint32_t parseHex4()
+        {
+            if (end - position < 4)
+                fail(path, "truncated JSON escape");
+
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = *position++;
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                    value |= static_cast<uint32_t>(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    value |= static_cast<uint32_t>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F')
+                    value |= static_cast<uint32_t>(c - 'A' + 10);
+                else
+                    fail(path, "malformed JSON escape");
+            }
+            return value;
+        }
+
+        std::string parseString()
+        {
+            if (position >= end || *position != '"')
+                fail(path, "malformed JSON, expected a string");
+            position++;
+
+            std::string string;
+            while (position < end && *position != '"')
+            {
+                char c = *position++;
+                if (c != '\\')
+                {
+                    string += c;
+                    continue;
+                }
+
+                if (position >= end)
+                    break;
+
+                switch (char escape = *position++)
+                {
+                case 'b': string += '\b'; break;
+                case 'f': string += '\f'; break;
+                case 'n': string += '\n'; break;
+                case 'r': string += '\r'; break;
+                case 't': string += '\t'; break;
+                case 'u':
+                {
+                    uint32_t codePoint = parseHex4();
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && consumeWord("\\u"))
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (parseHex4() - 0xDC00);
+                    appendUtf8(string, codePoint);
+                    break;
+                }
+                default: string += escape; break;
+                }
+            }
+
+            if (position >= end)
+                fail(path, "unterminated JSON string");
+            position++;
+            return string;
+        }
+    };
+
+    // glTF
+
+    constexpr uint32_t glbMagic = 0x46546C67;     // "glTF"
+    constexpr uint32_t glbChunkJson = 0x4E4F534A; // "JSON"
+    constexpr uint32_t glbChunkBin = 0x004E4942;  // "BIN\0"
+
+    struct GltfBuffer
+    {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    struct GltfFile
+    {
+        JsonValue json;
+        std::vector<MappedFile> files;               // the file itself and external buffers, mapped while jobs read them
+        std::vector<std::vector<uint8_t>> decoded;   // buffers embedded as base64 data URIs
+        std::vector<GltfBuffer> buffers;
+    };
+
+    struct Accessor
+    {
+        const uint8_t *data = nullptr; // null for accessors without a buffer view, they read as zeros
+        size_t count = 0;
+        size_t stride = 0;
+        uint32_t componentType = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+    };
+
+    std::vector<uint8_t> decodeBase64(const std::string &path, const char *begin, const char *end)
+    {
+        auto decodeDigit = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z')
+                return c - 'A';
+            if (c >= 'a' && c <= 'z')
+                return c - 'a' + 26;
+            if (c >= '0' && c <= '9')
+                return c - '0' + 52;
+            if (c == '+')
+                return 62;
+            if (c == '/')
+                return 63;
+            return -1;
+        };
+
+        std::vector<uint8_t> bytes;
+        bytes.reserve(static_cast<size_t>(end - begin) / 4 * 3);
+
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (const char *c = begin; c < end && *c != '='; c++)
+        {
+            int digit = decodeDigit(*c);
+            if (digit < 0)
+                fail(path, "malformed base64 buffer");
+
+            bits = bits << 6 | static_cast<uint32_t>(digit);
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+            }
+        }
+
+        return bytes;
+    }
+
+    std::string decodeUri(const std::string &uri)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < uri.size(); i++)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+            {
+                decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else
+                decoded += uri[i];
+        }
+        return decoded;
+    }
+
+    GltfFile openGltf(const std::string &path, ImportStatistics &statistics)
+    {
+        GltfFile gltf;
+
+        MappedFile file;
+        if (!file.open(path))
+            fail(path, "can't open file");
+        statistics.bytesRead += file.size();
+
+        const uint8_t *data = static_cast<const uint8_t *>(file.data());
+        size_t size = file.size();
+
+        const char *json = reinterpret_cast<const char *>(data);
+        size_t jsonSize = size;
+        GltfBuffer binary;
+
+        // Binary glTF, a 12 byte header followed by a JSON chunk and an optional binary chunk
+        if (size >= 12 && readU32(data) == glbMagic)
+        {
+            if (readU32(data + 4) != 2)
+                fail(path, "only glTF 2.0 is supported");
+
+            size_t length = std::min<size_t>(readU32(data + 8), size);
+            json = nullptr;
+
+            for (size_t offset = 12; offset + 8 <= length;)
+            {
+                size_t chunkLength = readU32(data + offset);
+                uint32_t chunkType = readU32(data + offset + 4);
+                if (chunkLength > length - offset - 8)
+                    fail(path, "truncated GLB chunk");
+
+                if (chunkType == glbChunkJson && json == nullptr)
+                {
+                    json = reinterpret_cast<const char *>(data + offset + 8);
+                    jsonSize = chunkLength;
+                }
+                else if (chunkType == glbChunkBin && binary.data == nullptr)
+                    binary = {data + offset + 8, chunkLength};
+
+                offset += 8 + (chunkLength + 3) / 4 * 4;
+            }
+
+            if (json == nullptr)
+                fail(path, "GLB without a JSON chunk");
+        }
+
+        JsonParser parser = {path, json, json + jsonSize};
+        gltf.json = parser.parse();
+        gltf.files.push_back(std::move(file));
+
+        const JsonValue &asset = gltf.json["asset"];
+        if (asset["version"].string.compare(0, 2, "2.") != 0)
+            fail(path, "only glTF 2.0 is supported");
+
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        const JsonValue &buffers = gltf.json["buffers"];
+
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            const JsonValue *uri = buffers[i].find("uri");
+            size_t byteLength = static_cast<size_t>(buffers[i].getNumber("byteLength", 0.0));
+            GltfBuffer buffer;
+
+            if (uri == nullptr)
+            {
+                if (i != 0 || binary.data == nullptr)
+                    fail(path, "buffer without data");
+                buffer = binary;
+            }
+            else if (uri->string.compare(0, 5, "data:") == 0)
+            {
+                size_t base64 = uri->string.find(";base64,");
+                if (base64 == std::string::npos)
+                    fail(path, "only base64 data URIs are supported");
+
+                const char *begin = uri->string.c_str() + base64 + 8;
+                gltf.decoded.push_back(decodeBase64(path, begin, uri->string.c_str() + uri->string.size()));
+                buffer = {gltf.decoded.back().data(), gltf.decoded.back().size()};
+            }
+            else
+            {
+                MappedFile external;
+                if (!external.open(directory + decodeUri(uri->string)))
+                    fail(path, "can't open buffer " + uri->string);
+
+                statistics.bytesRead += external.size();
+                buffer = {static_cast<const uint8_t *>(external.data()), external.size()};
+                gltf.files.push_back(std::move(external));
+            }
+
+            if (byteLength > buffer.size)
+                fail(path, "buffer is shorter than its byteLength");
+
+            gltf.buffers.push_back(buffer);
+        }
+
+        return gltf;
+    }
+
+    uint32_t getComponentSize(uint32_t componentType)
+    {
+        switch (componentType)
+        {
+        case 5120: // BYTE
+        case 5121: // UNSIGNED_BYTE
+            return 1;
+        case 5122: // SHORT
+        case 5123: // UNSIGNED_SHORT
+            return 2;
+        case 5125: // UNSIGNED_INT
+        case 5126: // FLOAT
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t getComponentCount(const std::string &type)
+    {
+        if (type == "SCALAR")
+            return 1;
+        if (type == "VEC2")
+            return 2;
+        if (type == "VEC3")
+            return 3;
+        if (type == "VEC4")
+            return 4;
+        return 0;
+    }
+
+    Accessor getAccessor(const std::string &path, const GltfFile &gltf, size_t index)
+    {
+        const JsonValue &accessor = gltf.json["accessors"][index];
+        if (accessor.type != JsonValue::Type::Object)
+            fail(path, "missing accessor");
+        if (accessor.find("sparse"))
+            fail(path, "sparse accessors are not supported");
+
+        Accessor result;
+        result.count = static_cast<size_t>(accessor.getNumber("count", 0.0));
+        result.componentType = static_cast<uint32_t>(accessor.getNumber("componentType", 0.0));
+        result.components = getComponentCount(accessor["type"].string);
+        result.normalized = accessor["normalized"].boolean;
+
+        uint32_t componentSize = getComponentSize(result.componentType);
+        if (componentSize == 0 || result.components == 0)
+            fail(path, "unsupported accessor type");
+
+        size_t elementSize = static_cast<size_t>(componentSize) * result.components;
+        result.stride = elementSize;
+
+        const JsonValue *viewIndex = accessor.find("bufferView");
+        if (viewIndex == nullptr || result.count == 0)
+            return result;
+
+        const JsonValue &view = gltf.json["bufferViews"][static_cast<size_t>(viewIndex->number)];
+        size_t bufferIndex = static_cast<size_t>(view.getNumber("buffer", -1.0));
+        if (view.type != JsonValue::Type::Object || bufferIndex >= gltf.buffers.size())
+            fail(path, "missing buffer view");
+
+        const GltfBuffer &buffer = gltf.buffers[bufferIndex];
+        size_t viewOffset = static_cast<size_t>(view.getNumber("byteOffset", 0.0));
+        size_t viewLength = static_cast<size_t>(view.getNumber("byteLength", 0.0));
+        size_t accessorOffset = static_cast<size_t>(accessor.getNumber("byteOffset", 0.0));
+        result.stride = static_cast<size_t>(view.getNumber("byteStride", static_cast<double>(elementSize)));
+
+        if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset || result.stride < elementSize ||
+            accessorOffset > viewLength || (result.count - 1) * result.stride + elementSize > viewLength - accessorOffset)
+            fail(path, "accessor reaches past its buffer view");
+
+        result.data = buffer.data + viewOffset + accessorOffset;
+        return result;
+    }
+
+    float readComponent(const uint8_t *data, uint32_t componentType, bool normalized)
+    {
+        switch (componentType)
+        {
+        case 5120:
+        {
+            int8_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return normalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+        }
+        case 5121:
+            return normalized ? data[0] / 255.0f : static_cast<float>(data[0]);
+        case 5122:
+        {
+            int16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+        }
+        case 5123:
+        {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return normalized ? value / 65535.0f : static_cast<float>(value);
+        }
+        case 5125:
+            return static_cast<float>(readU32(data));
+        default:
+        {
+            float value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        }
+    }
+
+    glm::vec4 readElement(const Accessor &accessor, size_t index, glm::vec4 value)
+    {
+        if (accessor.data == nullptr)
+            return glm::vec4(0.0f);
+
+        const uint8_t *element = accessor.data + index * accessor.stride;
+        uint32_t components = std::min(accessor.components, 4u);
+
+        if (accessor.componentType == 5126)
+        {
+            std::memcpy(&value[0], element, components * sizeof(float));
+            return value;
+        }
+
+        uint32_t componentSize = getComponentSize(accessor.componentType);
+        for (uint32_t c = 0; c < components; c++)
+            value[c] = readComponent(element + c * componentSize, accessor.componentType, accessor.normalized);
+        return value;
+    }
+
+    uint32_t readIndex(const Accessor &accessor, size_t index)
+    {
+        const uint8_t *element = accessor.data + index * accessor.stride;
+        switch (accessor.componentType)
+        {
+        case 5121:
+            return element[0];
+        case 5123:
+            return static_cast<uint32_t>(element[0] | element[1] << 8);
+        default: // 5125, the only other type the primitive accepts
+            return readU32(element);
+        }
+    }
+
+    glm::mat4 getNodeTransform(const JsonValue &node)
+    {
+        const JsonValue &matrix = node["matrix"];
+        if (matrix.size() == 16)
+        {
+            glm::mat4 result;
+            for (int i = 0; i < 16; i++)
+                result[i / 4][i % 4] = static_cast<float>(matrix[static_cast<size_t>(i)].number);
+            return result;
+        }
+
+        const JsonValue &t = node["translation"];
+        const JsonValue &r = node["rotation"];
+        const JsonValue &s = node["scale"];
+
+        glm::vec3 translation = t.size() == 3 ? glm::vec3(t.getVector()) : glm::vec3(0.0f);
+        glm::vec3 scale = s.size() == 3 ? glm::vec3(s.getVector()) : glm::vec3(1.0f);
+        glm::vec4 q = r.size() == 4 ? r.getVector() : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        float x = q.x, y = q.y, z = q.z, w = q.w;
+
+        glm::mat4 rotation(1.0f);
+        rotation[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f);
+        rotation[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f);
+        rotation[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+
+        return glm::scale(glm::translate(glm::mat4(1.0f), translation) * rotation, scale);
+    }
+
+    struct GltfInstance
+    {
+        size_t mesh;
+        glm::mat4 transform;
+    };
+
+    void collectInstances(const std::string &path, const JsonValue &nodes, size_t nodeIndex, const glm::mat4 &parent,
+                          std::vector<GltfInstance> &instances, int depth)
+    {
+        if (depth > 64)
+            fail(path, "node hierarchy is too deep or cyclic");
+
+        const JsonValue &node = nodes[nodeIndex];
+        glm::mat4 transform = parent * getNodeTransform(node);
+
+        if (const JsonValue *mesh = node.find("mesh"))
+            instances.push_back({static_cast<size_t>(mesh->number), transform});
+
+        const JsonValue &children = node["children"];
+        for (size_t i = 0; i < children.size(); i++)
+            collectInstances(path, nodes, static_cast<size_t>(children[i].number), transform, instances, depth + 1);
+    }
+
+    // Meshes as the default scene places them, every mesh once untransformed for files without nodes
+    std::vector<GltfInstance> getInstances(const std::string &path, const JsonValue &json)
+    {
+        std::vector<GltfInstance> instances;
+        const JsonValue &nodes = json["nodes"];
+
+        if (nodes.size() == 0)
+        {
+            for (size_t i = 0; i < json["meshes"].size(); i++)
+                instances.push_back({i, glm::mat4(1.0f)});
+            return instances;
+        }
+
+        std::vector<size_t> roots;
+        const JsonValue &scene = json["scenes"][static_cast<size_t>(json.getNumber("scene", 0.0))];
+        if (scene.type == JsonValue::Type::Object)
+        {
+            const JsonValue &sceneNodes = scene["nodes"];
+            for (size_t i = 0; i < sceneNodes.size(); i++)
+                roots.push_back(static_cast<size_t>(sceneNodes[i].number));
+        }
+        else
+        {
+            std::vector<bool> isChild(nodes.size(), false);
+            for (size_t i = 0; i < nodes.size(); i++)
+            {
+                const JsonValue &children = nodes[i]["children"];
+                for (size_t j = 0; j < children.size(); j++)
+                    if (static_cast<size_t>(children[j].number) < isChild.size())
+                        isChild[static_cast<size_t>(children[j].number)] = true;
+            }
+
+            for (size_t i = 0; i < nodes.size(); i++)
+                if (!isChild[i])
+                    roots.push_back(i);
+        }
+
+        for (size_t root : roots)
+            collectInstances(path, nodes, root, glm::mat4(1.0f), instances, 0);
+        return instances;
+    }
+
+    Bounds getPositionBounds(const std::string &path, const GltfFile &gltf, size_t accessorIndex, const glm::mat4 &transform)
+    {
+        const JsonValue &json = gltf.json["accessors"][accessorIndex];
+        const JsonValue &min = json["min"];
+        const JsonValue &max = json["max"];
+
+        // min and max are required for positions, but only float ones can be used as they are
+        Bounds local;
+        if (min.size() == 3 && max.size() == 3 && json.getNumber("componentType", 0.0) == 5126)
+        {
+            local.add(glm::vec3(min.getVector()));
+            local.add(glm::vec3(max.getVector()));
+        }
+        else
+        {
+            Accessor accessor = getAccessor(path, gltf, accessorIndex);
+            for (size_t i = 0; i < accessor.count; i++)
+                local.add(glm::vec3(readElement(accessor, i, glm::vec4(0.0f))));
+        }
+
+        Bounds bounds;
+        if (local.isEmpty())
+            return bounds;
+
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 point(corner & 1 ? local.max.x : local.min.x, corner & 2 ? local.max.y : local.min.y, corner & 4 ? local.max.z : local.min.z);
+            bounds.add(glm::vec3(transform * glm::vec4(point, 1.0f)));
+        }
+        return bounds;
+    }
+
+    void convertPrimitive(const std::string &path, const GltfFile &gltf, const JsonValue &primitive, const glm::mat4 &transform,
+                          const ImportedModel &model, ImportedMesh &mesh)
+    {
+        const JsonValue &attributes = primitive["attributes"];
+        const JsonValue *position = attributes.find("POSITION");
+        if (position == nullptr)
+            fail(path, "primitive without positions");
+
+        Accessor positions = getAccessor(path, gltf, static_cast<size_t>(position->number));
+        Accessor normals, colors;
+        if (const JsonValue *normal = attributes.find("NORMAL"))
+            normals = getAccessor(path, gltf, static_cast<size_t>(normal->number));
+        if (const JsonValue *color = attributes.find("COLOR_0"))
+            colors = getAccessor(path, gltf, static_cast<size_t>(color->number));
+
+        size_t vertexCount = positions.count;
+        if ((normals.data && normals.count < vertexCount) || (colors.data && colors.count < vertexCount))
+            fail(path, "attributes with fewer elements than positions");
+
+        std::vector<GeometryPool::Index> &indices = mesh.indices;
+        if (const JsonValue *index = primitive.find("indices"))
+        {
+            Accessor accessor = getAccessor(path, gltf, static_cast<size_t>(index->number));
+            // UNSIGNED_BYTE, UNSIGNED_SHORT and UNSIGNED_INT are the only index types glTF allows
+            bool unsignedIndices = accessor.componentType == 5121 || accessor.componentType == 5123 || accessor.componentType == 5125;
+            if (accessor.data == nullptr || accessor.components != 1 || !unsignedIndices)
+                fail(path, "unsupported index accessor");
+
+            indices.resize(accessor.count / 3 * 3);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                indices[i] = readIndex(accessor, i);
+                if (indices[i] >= vertexCount)
+                    fail(path, "index out of range");
+            }
+        }
+        else
+        {
+            indices.resize(vertexCount / 3 * 3);
+            for (size_t i = 0; i < indices.size(); i++)
+                indices[i] = static_cast<GeometryPool::Index>(i);
+        }
+
+        // Mirroring transforms turn the triangles inside out
+        if (glm::determinant(glm::mat3(transform)) < 0.0f)
+        {
+            for (size_t i = 0; i < indices.size(); i += 3)
+                std::swap(indices[i + 1], indices[i + 2]);
+        }
+
+        std::vector<glm::vec3> worldPositions(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            worldPositions[i] = glm::vec3(transform * glm::vec4(glm::vec3(readElement(positions, i, glm::vec4(0.0f))), 1.0f));
+
+        std::vector<glm::vec3> generatedNormals;
+        if (normals.data == nullptr)
+        {
+            generatedNormals.assign(vertexCount, glm::vec3(0.0f));
+            addFaceNormals(worldPositions, indices, generatedNormals);
+        }
+
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+
+        mesh.vertices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            glm::vec3 normal = normals.data ? normalMatrix * glm::vec3(readElement(normals, i, glm::vec4(0.0f))) : generatedNormals[i];
+            glm::vec4 color = colors.data ? readElement(colors, i, glm::vec4(1.0f)) : glm::vec4(1.0f);
+            mesh.vertices[i] = makeVertex(model, worldPositions[i], normal, color);
+        }
+    }
+
+    ImportedModel loadGltf(const std::string &path, JobSystem &jobSystem, ImportStatistics &statistics)
+    {
+        GltfFile gltf = openGltf(path, statistics);
+        const JsonValue &meshes = gltf.json["meshes"];
+
+        struct PrimitiveJob
+        {
+            const JsonValue *primitive;
+            glm::mat4 transform;
+            std::string name;
+        };
+
+        // The bounds of the whole model are needed before any vertex can be quantized,
+        // they come from the accessor min and max without touching the vertices
+        std::vector<PrimitiveJob> jobs;
+        Bounds bounds;
+        uint32_t skipped = 0;
+
+        for (const GltfInstance &instance : getInstances(path, gltf.json))
+        {
+            const JsonValue &mesh = meshes[instance.mesh];
+            const JsonValue &primitives = mesh["primitives"];
+            std::string name = mesh.find("name") ? mesh["name"].string : "mesh" + std::to_string(instance.mesh);
+
+            for (size_t i = 0; i < primitives.size(); i++)
+            {
+                if (primitives[i].getNumber("mode", 4.0) != 4.0)
+                {
+                    skipped++;
+                    continue;
+                }
+
+                if (const JsonValue *position = primitives[i]["attributes"].find("POSITION"))
+                    bounds.add(getPositionBounds(path, gltf, static_cast<size_t>(position->number), instance.transform));
+
+                jobs.push_back({&primitives[i], instance.transform, primitives.size() > 1 ? name + "/" + std::to_string(i) : name});
+            }
+        }
+
+        if (skipped > 0)
+            std::cerr << "Skipped " << skipped << " primitives that aren't triangle lists in " << path << std::endl;
+
+        ImportedModel model;
+        setBounds(model, bounds);
+        model.meshes.resize(jobs.size());
+
+        runParallel(jobSystem, jobs.size(), [&](size_t i) {
+            model.meshes[i].name = jobs[i].name;
+            convertPrimitive(path, gltf, *jobs[i].primitive, jobs[i].transform, model, model.meshes[i]);
+        });
+
+        return model;
+    }
+
+    // OBJ
+
+    constexpr size_t objChunkSize = 4 * 1024 * 1024;
+
+    struct ObjCorner
+    {
+        int32_t position; // 0 based
+        int32_t normal;   // -1 when the face has no normals
+    };
+
+    // Negative indices count back from the last vertex read, which is only known relative to
+    // the chunk until the chunks before it are counted
+    struct ObjFixup
+    {
+        uint32_t corner;
+        int32_t local;
+        bool normal;
+    };
+
+    struct ObjGroup
+    {
+        uint32_t firstCorner;
+        std::string name;
+    };
+
+    struct ObjChunk
+    {
+        const char *begin;
+        const char *end;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors; // empty unless a vertex had one, then padded to positions
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners; // three per triangle
+        std::vector<ObjFixup> fixups;
+        std::vector<ObjGroup> groups;
+        Bounds bounds;
+
+        int32_t positionBase = 0;
+        int32_t normalBase = 0;
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // Accurate to a few ulps, plenty for 16 bit quantized positions and a lot faster than strtof
+    bool parseFloat(const char *&p, const char *end, float &value)
+    {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        while (p < end && isSpace(*p))
+            p++;
+
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool digits = false;
+
+        for (; p < end && *p >= '0' && *p <= '9'; p++, digits = true)
+            mantissa = mantissa * 10.0 + (*p - '0');
+
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits = true, exponent--)
+                mantissa = mantissa * 10.0 + (*p - '0');
+        }
+
+        if (!digits)
+            return false;
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negativeExponent = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+'))
+                p++;
+
+            int value = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
+                value = std::min(value * 10 + (*p - '0'), 1000);
+            exponent += negativeExponent ? -value : value;
+        }
+
+        double scale = std::abs(exponent) <= 22 ? powers[std::abs(exponent)] : std::pow(10.0, std::abs(exponent));
+        double result = exponent < 0 ? mantissa / scale : mantissa * scale;
+        value = static_cast<float>(negative ? -result : result);
+        return true;
+    }
+
+    bool parseInt(const char *&p, const char *end, int32_t &value)
+    {
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            p++;
+
+        if (p >= end || *p < '0' || *p > '9')
+            return false;
+
+        int64_t result = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+
+        value = static_cast<int32_t>(negative ? -result : result);
+        return true;
+    }
+
+    void parseObjChunk(ObjChunk &chunk)
+    {
+        struct PolygonCorner
+        {
+            ObjCorner corner;
+            bool relativePosition;
+            bool relativeNormal;
+        };
+        std::vector<PolygonCorner> polygon;
+
+        for (const char *line = chunk.begin; line < chunk.end;)
+        {
+            const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(chunk.end - line)));
+            if (lineEnd == nullptr)
+                lineEnd = chunk.end;
+
+            const char *p = line;
+            line = lineEnd + 1;
+
+            while (p < lineEnd && isSpace(*p))
+                p++;
+            if (p + 1 >= lineEnd)
+                continue;
+
+            if (p[0] == 'v' && isSpace(p[1]))
+            {
+                p += 2;
+                glm::vec3 position(0.0f), color(1.0f);
+                if (!parseFloat(p, lineEnd, position.x) || !parseFloat(p, lineEnd, position.y) || !parseFloat(p, lineEnd, position.z))
+                    continue;
+
+                chunk.positions.push_back(position);
+                chunk.bounds.add(position);
+
+                // Vertex colors are a common extension, "v x y z r g b"
+                if (parseFloat(p, lineEnd, color.r) && parseFloat(p, lineEnd, color.g) && parseFloat(p, lineEnd, color.b))
+                {
+                    chunk.colors.resize(chunk.positions.size() - 1, glm::vec3(1.0f));
+                    chunk.colors.push_back(color);
+                }
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                p += 2;
+                glm::vec3 normal;
+                if (parseFloat(p, lineEnd, normal.x) && parseFloat(p, lineEnd, normal.y) && parseFloat(p, lineEnd, normal.z))
+                    chunk.normals.push_back(normal);
+            }
+            else if (p[0] == 'f' && isSpace(p[1]))
+            {
+                p += 2;
+                polygon.clear();
+                bool valid = true;
+
+                while (true)
+                {
+                    while (p < lineEnd && isSpace(*p))
+                        p++;
+                    if (p >= lineEnd)
+                        break;
+
+                    PolygonCorner corner = {{0, -1}, false, false};
+                    int32_t index;
+                    if (!parseInt(p, lineEnd, index) || index == 0)
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    corner.relativePosition = index < 0;
+                    corner.corner.position = index < 0 ? static_cast<int32_t>(chunk.positions.size()) + index : index - 1;
+
+                    // Texture coordinates aren't imported, "v/vt/vn" and "v//vn" both lead to the normal
+                    if (p < lineEnd && *p == '/')
+                    {
+                        p++;
+                        while (p < lineEnd && *p != '/' && !isSpace(*p))
+                            p++;
+
+                        if (p < lineEnd && *p == '/')
+                        {
+                            p++;
+                            if (parseInt(p, lineEnd, index) && index != 0)
+                            {
+                                corner.relativeNormal = index < 0;
+                                corner.corner.normal = index < 0 ? static_cast<int32_t>(chunk.normals.size()) + index : index - 1;
+                            }
+                        }
+                    }
+
+                    while (p < lineEnd && !isSpace(*p))
+                        p++;
+                    polygon.push_back(corner);
+                }
+
+                if (!valid || polygon.size() < 3)
+                    continue;
+
+                // Polygons become fans around their first corner
+                for (size_t k = 2; k < polygon.size(); k++)
+                {
+                    for (const PolygonCorner &corner : {polygon[0], polygon[k - 1], polygon[k]})
+                    {
+                        uint32_t slot = static_cast<uint32_t>(chunk.corners.size());
+                        chunk.corners.push_back(corner.corner);
+                        if (corner.relativePosition)
+                            chunk.fixups.push_back({slot, corner.corner.position, false});
+                        if (corner.relativeNormal)
+                            chunk.fixups.push_back({slot, corner.corner.normal, true});
+                    }
+                }
+            }
+            else if ((p[0] == 'o' || p[0] == 'g') && isSpace(p[1]))
+            {
+                const char *nameBegin = p + 2;
+                while (nameBegin < lineEnd && isSpace(*nameBegin))
+                    nameBegin++;
+                const char *nameEnd = lineEnd;
+                while (nameEnd > nameBegin && isSpace(nameEnd[-1]))
+                    nameEnd--;
+
+                chunk.groups.push_back({static_cast<uint32_t>(chunk.corners.size()), std::string(nameBegin, nameEnd)});
+            }
+        }
+
+        if (!chunk.colors.empty())
+            chunk.colors.resize(chunk.positions.size(), glm::vec3(1.0f));
+    }
+
+    struct ObjRange
+    {
+        size_t chunk;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct ObjData
+    {
+        std::vector<ObjChunk> chunks;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colors;
+        std::vector<glm::vec3> normals;
+    };
+
+    void buildObjMesh(const std::string &path, const ObjData &obj, const std::vector<ObjRange> &ranges, const ImportedModel &model, ImportedMesh &mesh)
+    {
+        // One vertex per distinct position and normal pair
+        std::unordered_map<uint64_t, GeometryPool::Index> remap;
+        std::vector<ObjCorner> vertices;
+
+        size_t cornerCount = 0;
+        for (const ObjRange &range : ranges)
+            cornerCount += range.end - range.begin;
+        mesh.indices.reserve(cornerCount);
+        remap.reserve(cornerCount / 2);
+
+        for (const ObjRange &range : ranges)
+        {
+            const std::vector<ObjCorner> &corners = obj.chunks[range.chunk].corners;
+            for (uint32_t i = range.begin; i < range.end; i++)
+            {
+                ObjCorner corner = corners[i];
+                if (corner.position < 0 || static_cast<size_t>(corner.position) >= obj.positions.size() ||
+                    corner.normal < -1 || (corner.normal >= 0 && static_cast<size_t>(corner.normal) >= obj.normals.size()))
+                    fail(path, "face index out of range");
+
+                uint64_t key = static_cast<uint64_t>(corner.position) << 32 | static_cast<uint32_t>(corner.normal + 1);
+                auto [it, inserted] = remap.emplace(key, static_cast<GeometryPool::Index>(vertices.size()));
+                if (inserted)
+                    vertices.push_back(corner);
+
+                mesh.indices.push_back(it->second);
+            }
+        }
+
+        std::vector<glm::vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+            positions[i] = obj.positions[static_cast<size_t>(vertices[i].position)];
+
+        // Vertices without a normal share one per position, summing their faces makes them smooth
+        std::vector<glm::vec3> generatedNormals(vertices.size(), glm::vec3(0.0f));
+        addFaceNormals(positions, mesh.indices, generatedNormals);
+
+        mesh.vertices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const ObjCorner &vertex = vertices[i];
+            glm::vec3 normal = vertex.normal >= 0 ? obj.normals[static_cast<size_t>(vertex.normal)] : generatedNormals[i];
+            glm::vec3 color = obj.colors.empty() ? glm::vec3(1.0f) : obj.colors[static_cast<size_t>(vertex.position)];
+            mesh.vertices[i] = makeVertex(model, positions[i], normal, glm::vec4(color, 1.0f));
+        }
+    }
+
+    ImportedModel loadObj(const std::string &path, JobSystem &jobSystem, ImportStatistics &statistics)
+    {
+        MappedFile file;
+        if (!file.open(path))
+            fail(path, "can't open file");
+        statistics.bytesRead += file.size();
+
+        const char *data = static_cast<const char *>(file.data());
+        const char *end = data + file.size();
+
+        // Chunks end on line breaks, each one is parsed on its own job
+        ObjData obj;
+        for (const char *begin = data; begin < end;)
+        {
+            const char *chunkEnd = begin + std::min(objChunkSize, static_cast<size_t>(end - begin));
+            const char *lineEnd = static_cast<const char *>(std::memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd)));
+            chunkEnd = lineEnd ? lineEnd + 1 : end;
+
+            ObjChunk chunk;
+            chunk.begin = begin;
+            chunk.end = chunkEnd;
+            obj.chunks.push_back(std::move(chunk));
+            begin = chunkEnd;
+        }
+
+        runParallel(jobSystem, obj.chunks.size(), [&](size_t i) { parseObjChunk(obj.chunks[i]); });
+
+        // Indices are global across the file, chunks only know their own counts
+        bool hasColors = false;
+        size_t positionCount = 0, normalCount = 0;
+        Bounds bounds;
+
+        for (ObjChunk &chunk : obj.chunks)
+        {
+            if (positionCount + chunk.positions.size() > INT32_MAX || normalCount + chunk.normals.size() > INT32_MAX)
+                fail(path, "too many vertices");
+
+            chunk.positionBase = static_cast<int32_t>(positionCount);
+            chunk.normalBase = static_cast<int32_t>(normalCount);
+            positionCount += chunk.positions.size();
+            normalCount += chunk.normals.size();
+            hasColors |= !chunk.colors.empty();
+            bounds.add(chunk.bounds);
+
+            for (const ObjFixup &fixup : chunk.fixups)
+            {
+                ObjCorner &corner = chunk.corners[fixup.corner];
+                (fixup.normal ? corner.normal : corner.position) = (fixup.normal ? chunk.normalBase : chunk.positionBase) + fixup.local;
+            }
+        }
+
+        obj.positions.reserve(positionCount);
+        obj.normals.reserve(normalCount);
+        for (ObjChunk &chunk : obj.chunks)
+        {
+            obj.positions.insert(obj.positions.end(), chunk.positions.begin(), chunk.positions.end());
+            obj.normals.insert(obj.normals.end(), chunk.normals.begin(), chunk.normals.end());
+            if (hasColors)
+            {
+                chunk.colors.resize(chunk.positions.size(), glm::vec3(1.0f));
+                obj.colors.insert(obj.colors.end(), chunk.colors.begin(), chunk.colors.end());
+            }
+
+            std::vector<glm::vec3>().swap(chunk.positions);
+            std::vector<glm::vec3>().swap(chunk.normals);
+            std::vector<glm::vec3>().swap(chunk.colors);
+        }
+
+        // Faces of the same group become one mesh, wherever in the file they are
+        std::vector<std::string> names;
+        std::vector<std::vector<ObjRange>> meshRanges;
+        std::unordered_map<std::string, size_t> meshIndices;
+        size_t currentMesh = 0;
+
+        auto selectMesh = [&](const std::string &name) {
+            auto [it, inserted] = meshIndices.emplace(name, names.size());
+            if (inserted)
+            {
+                names.push_back(name);
+                meshRanges.emplace_back();
+            }
+            currentMesh = it->second;
+        };
+        selectMesh("default");
+
+        for (size_t c = 0; c < obj.chunks.size(); c++)
+        {
+            const ObjChunk &chunk = obj.chunks[c];
+            uint32_t begin = 0;
+
+            for (const ObjGroup &group : chunk.groups)
+            {
+                if (group.firstCorner > begin)
+                    meshRanges[currentMesh].push_back({c, begin, group.firstCorner});
+                begin = group.firstCorner;
+                selectMesh(group.name);
+            }
+
+            uint32_t cornerCount = static_cast<uint32_t>(chunk.corners.size());
+            if (cornerCount > begin)
+                meshRanges[currentMesh].push_back({c, begin, cornerCount});
+        }
+
+        ImportedModel model;
+        setBounds(model, bounds);
+
+        std::vector<size_t> nonEmpty;
+        for (size_t i = 0; i < names.size(); i++)
+            if (!meshRanges[i].empty())
+                nonEmpty.push_back(i);
+
+        model.meshes.resize(nonEmpty.size());
+        runParallel(jobSystem, nonEmpty.size(), [&](size_t i) {
+            model.meshes[i].name = names[nonEmpty[i]];
+            buildObjMesh(path, obj, meshRanges[nonEmpty[i]], model, model.meshes[i]);
+        });
+
+        return model;
+    }
+
+    // Splits copies larger than a quarter of the staging ring, waits for earlier batches when it is full
+    void stageCopy(UploadManager &uploadManager, const void *data, VkDeviceSize size, VkBuffer buffer, VkDeviceSize offset)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        VkDeviceSize chunkSize = uploadManager.getStagingSize() / 4;
+
+        for (VkDeviceSize done = 0; done < size;)
+        {
+            VkDeviceSize count = std::min(chunkSize, size - done);
+            VkDeviceSize stagingOffset;
+
+            while (!uploadManager.stage(bytes + done, count, stagingOffset))
+                uploadManager.flush();
+
+            uploadManager.copyToBuffer(stagingOffset, buffer, offset + done, count);
+            done += count;
+        }
+    }
+}
+
+uint64_t ImportedModel::getVertexCount() const
+{
+    uint64_t count = 0;
+    for (const auto &mesh : meshes)
+        count += mesh.vertices.size();
+    return count;
+}
+
+uint64_t ImportedModel::getIndexCount() const
+{
+    uint64_t count = 0;
+    for (const auto &mesh : meshes)
+        count += mesh.indices.size();
+    return count;
+}
+
+void ImportStatistics::print(const std::string &path) const
+{
+    double megabytes = bytesRead / (1024.0 * 1024.0);
+    double uploadMegabytes = uploadBytes / (1024.0 * 1024.0);
+    double parse = std::max(parseSeconds, 1e-9);
+    double upload = std::max(uploadSeconds, 1e-9);
+
+    std::cerr << "Imported " << path << ": " << triangles << " triangles, " << vertices << " vertices from " << megabytes << " MB" << std::endl
+              << "\tparse " << parseSeconds * 1000.0 << " ms, " << megabytes / parse << " MB/s, " << triangles / parse / 1e6 << " Mtriangles/s" << std::endl
+              << "\toptimize " << optimizeSeconds * 1000.0 << " ms, " << lodTriangles << " triangles in lower levels of detail" << std::endl
+              << "\tupload " << uploadSeconds * 1000.0 << " ms, " << uploadMegabytes / upload << " MB/s" << std::endl;
+}
+
+ImportedModel MeshImporter::load(const std::string &path, JobSystem &jobSystem, ImportStatistics &statistics)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    ImportedModel model;
+    if (hasExtension(path, ".gltf") || hasExtension(path, ".glb"))
+        model = loadGltf(path, jobSystem, statistics);
+    else if (hasExtension(path, ".obj"))
+        model = loadObj(path, jobSystem, statistics);
+    else
+        fail(path, "unsupported format");
+
+    statistics.parseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t triangles = model.getIndexCount() / 3;
+    statistics.vertices += model.getVertexCount();
+    statistics.triangles += triangles;
+
+    start = std::chrono::steady_clock::now();
+
+    runParallel(jobSystem, model.meshes.size(), [&](size_t i) {
+        ImportedMesh &mesh = model.meshes[i];
+        mesh.lods = MeshOptimizer::buildLods(mesh.vertices, mesh.indices, model.boundsExtent);
+        mesh.clusters = MeshOptimizer::buildClusters(mesh.vertices, mesh.indices, mesh.lods);
+    });
+
+    statistics.optimizeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    statistics.lodTriangles += model.getIndexCount() / 3 - triangles;
+    return model;
+}
+
+std::vector<LodMesh> MeshImporter::upload(const ImportedModel &model, GeometryPool &geometryPool, UploadManager &uploadManager, ImportStatistics &statistics)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<LodMesh> meshes;
+    for (const ImportedMesh &imported : model.meshes)
+    {
+        if (imported.indices.empty())
+            continue;
+
+        Mesh mesh = geometryPool.allocate(static_cast<uint32_t>(imported.vertices.size()), sizeof(Vertex), static_cast<uint32_t>(imported.indices.size()));
+
+        stageCopy(uploadManager, imported.vertices.data(), imported.vertices.size() * sizeof(Vertex), geometryPool.vertexBuffer.buffer, mesh.vertexByteOffset);
+        stageCopy(uploadManager, imported.indices.data(), imported.indices.size() * sizeof(GeometryPool::Index), geometryPool.indexBuffer.buffer, mesh.indexByteOffset);
+
+        statistics.uploadBytes += imported.vertices.size() * sizeof(Vertex) + imported.indices.size() * sizeof(GeometryPool::Index);
+
+        LodMesh lodMesh;
+        lodMesh.mesh = mesh;
+        lodMesh.lods = imported.lods;
+        lodMesh.positionScale = std::min(model.boundsExtent.x, std::min(model.boundsExtent.y, model.boundsExtent.z));
+        lodMesh.clusters = imported.clusters;
+        meshes.push_back(std::move(lodMesh));
+    }
+
+    uploadManager.flush();
+
+    statistics.uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return meshes;
+}
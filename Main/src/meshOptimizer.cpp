@@ -0,0 +1,682 @@
+#include "meshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    using Index = MeshOptimizer::Index;
+
+    struct Adjacency
+    {
+        std::vector<uint32_t> offsets; // vertexCount + 1 entries into triangles
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<Index> &indices, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (Index index : indices)
+                offsets[index + 1]++;
+            for (size_t i = 0; i < vertexCount; i++)
+                offsets[i + 1] += offsets[i];
+
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            triangles.resize(indices.size());
+            for (size_t i = 0; i < indices.size(); i++)
+                triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        uint32_t count(Index vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+        const uint32_t *begin(Index vertex) const { return triangles.data() + offsets[vertex]; }
+        const uint32_t *end(Index vertex) const { return triangles.data() + offsets[vertex + 1]; }
+    };
+
+    // Sum of squared distances to a set of planes, weighted by triangle area
+    struct Quadric
+    {
+        double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+        double b0 = 0, b1 = 0, b2 = 0, c = 0;
+        double weight = 0;
+
+        void addPlane(glm::dvec3 normal, double distance, double area)
+        {
+            a00 += area * normal.x * normal.x;
+            a11 += area * normal.y * normal.y;
+            a22 += area * normal.z * normal.z;
+            a01 += area * normal.x * normal.y;
+            a02 += area * normal.x * normal.z;
+            a12 += area * normal.y * normal.z;
+            b0 += area * normal.x * distance;
+            b1 += area * normal.y * distance;
+            b2 += area * normal.z * distance;
+            c += area * distance * distance;
+            weight += area;
+        }
+
+        void add(const Quadric &other)
+        {
+            a00 += other.a00, a11 += other.a11, a22 += other.a22;
+            a01 += other.a01, a02 += other.a02, a12 += other.a12;
+            b0 += other.b0, b1 += other.b1, b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // Mean squared distance of the point to the planes
+        double evaluate(glm::vec3 point) const
+        {
+            double x = point.x, y = point.y, z = point.z;
+            double value = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                           2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::max(value, 0.0) / weight : 0.0;
+        }
+    };
+
+    // Vertices sharing a position get the lowest index among them, the simplifier works on
+    // positions while the index buffer keeps pointing at vertices with their attributes
+    std::vector<Index> buildPositionRemap(const std::vector<glm::vec3> &positions)
+    {
+        std::vector<Index> order(positions.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = static_cast<Index>(i);
+
+        std::sort(order.begin(), order.end(), [&](Index a, Index b) {
+            const glm::vec3 &pa = positions[a];
+            const glm::vec3 &pb = positions[b];
+            if (pa.x != pb.x)
+                return pa.x < pb.x;
+            if (pa.y != pb.y)
+                return pa.y < pb.y;
+            if (pa.z != pb.z)
+                return pa.z < pb.z;
+            return a < b;
+        });
+
+        std::vector<Index> remap(positions.size());
+        for (size_t i = 0; i < order.size(); i++)
+            remap[order[i]] = i > 0 && positions[order[i]] == positions[order[i - 1]] ? remap[order[i - 1]] : order[i];
+        return remap;
+    }
+
+    uint64_t getEdgeKey(Index a, Index b)
+    {
+        return a < b ? static_cast<uint64_t>(a) << 32 | b : static_cast<uint64_t>(b) << 32 | a;
+    }
+
+    struct Collapse
+    {
+        Index from;
+        Index to;
+        double cost;
+    };
+
+    // Rejects collapses that turn a triangle over or make it sliver thin
+    bool flipsTriangle(const std::vector<Index> &indices, const std::vector<glm::vec3> &positions, uint32_t triangle, Index from, Index to)
+    {
+        const Index *corners = &indices[triangle * 3];
+        glm::vec3 before[3], after[3];
+        for (int i = 0; i < 3; i++)
+        {
+            before[i] = positions[corners[i]];
+            after[i] = positions[corners[i] == from ? to : corners[i]];
+        }
+
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        return glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter);
+    }
+
+    // The edge may only have the two triangles around it in common, otherwise the collapse
+    // pinches the surface into a non-manifold one
+    bool keepsManifold(const std::vector<Index> &indices, const std::vector<Index> &remap, const Adjacency &adjacency, Index from, Index to,
+                       std::vector<Index> &ring)
+    {
+        ring.clear();
+        for (const uint32_t *t = adjacency.begin(from); t != adjacency.end(from); ++t)
+            for (int i = 0; i < 3; i++)
+                ring.push_back(remap[indices[*t * 3 + i]]);
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+
+        Index fromPosition = remap[from], toPosition = remap[to];
+        uint32_t shared = 0;
+        for (const uint32_t *t = adjacency.begin(to); t != adjacency.end(to); ++t)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                Index vertex = remap[indices[*t * 3 + i]];
+                auto it = std::lower_bound(ring.begin(), ring.end(), vertex);
+                if (vertex == fromPosition || vertex == toPosition || it == ring.end() || *it != vertex)
+                    continue;
+
+                // Each neighbor counts once, taking it out of the ring keeps it from counting again
+                ring.erase(it);
+                shared++;
+            }
+        }
+
+        return shared <= 2;
+    }
+
+    void computeClusterBounds(MeshCluster &cluster, const std::vector<Index> &indices, const std::vector<glm::vec3> &positions)
+    {
+        glm::vec3 minimum(HUGE_VALF), maximum(-HUGE_VALF);
+        for (uint32_t i = 0; i < cluster.indexCount; i++)
+        {
+            minimum = glm::min(minimum, positions[indices[cluster.firstIndex + i]]);
+            maximum = glm::max(maximum, positions[indices[cluster.firstIndex + i]]);
+        }
+
+        cluster.center = (minimum + maximum) * 0.5f;
+        cluster.radius = 0.0f;
+        for (uint32_t i = 0; i < cluster.indexCount; i++)
+            cluster.radius = std::max(cluster.radius, glm::length(positions[indices[cluster.firstIndex + i]] - cluster.center));
+
+        std::vector<glm::vec3> normals;
+        glm::vec3 sum(0.0f);
+        for (uint32_t i = 0; i < cluster.indexCount; i += 3)
+        {
+            glm::vec3 a = positions[indices[cluster.firstIndex + i]];
+            glm::vec3 normal = glm::cross(positions[indices[cluster.firstIndex + i + 1]] - a, positions[indices[cluster.firstIndex + i + 2]] - a);
+            float length = glm::length(normal);
+            if (length == 0.0f)
+                continue;
+
+            normals.push_back(normal / length);
+            sum += normals.back();
+        }
+
+        // Normals spreading over a hemisphere or more always show some front face
+        float sumLength = glm::length(sum);
+        if (sumLength < 1e-6f)
+            return;
+
+        cluster.coneAxis = sum / sumLength;
+        float minDot = 1.0f;
+        for (const glm::vec3 &normal : normals)
+            minDot = std::min(minDot, glm::dot(normal, cluster.coneAxis));
+
+        cluster.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<Index> &indices, size_t vertexCount, std::vector<uint32_t> *clusters, uint32_t cacheSize)
+{
+    if (clusters)
+        clusters->clear();
+
+    size_t triangleCount = indices.size() / 3;
+    indices.resize(triangleCount * 3);
+    if (triangleCount == 0)
+        return;
+
+    Adjacency adjacency;
+    adjacency.build(indices, vertexCount);
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        liveTriangles[i] = adjacency.count(static_cast<Index>(i));
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<Index> deadEnds;
+    std::vector<Index> candidates;
+    std::vector<Index> result;
+    result.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Vertices of recently emitted triangles first, then the next vertex in index order
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnds.empty())
+        {
+            Index vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+
+        for (; cursor < vertexCount; cursor++)
+            if (liveTriangles[cursor] > 0)
+                return static_cast<int64_t>(cursor);
+
+        return -1;
+    };
+
+    int64_t fanning = skipDeadEnd();
+    bool restarted = true;
+
+    while (fanning >= 0)
+    {
+        if (restarted && clusters)
+            clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+
+        candidates.clear();
+        Index vertex = static_cast<Index>(fanning);
+
+        for (const uint32_t *t = adjacency.begin(vertex); t != adjacency.end(vertex); ++t)
+        {
+            if (emitted[*t])
+                continue;
+            emitted[*t] = 1;
+
+            for (int i = 0; i < 3; i++)
+            {
+                Index corner = indices[*t * 3 + i];
+                result.push_back(corner);
+                deadEnds.push_back(corner);
+                candidates.push_back(corner);
+                liveTriangles[corner]--;
+
+                if (time - cacheTime[corner] > cacheSize)
+                    cacheTime[corner] = time++;
+            }
+        }
+
+        // The candidate staying in the cache the longest that still has triangles left
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (Index candidate : candidates)
+        {
+            if (liveTriangles[candidate] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if (time - cacheTime[candidate] + 2 * liveTriangles[candidate] <= cacheSize)
+                priority = time - cacheTime[candidate];
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = candidate;
+            }
+        }
+
+        restarted = next < 0;
+        fanning = restarted ? skipDeadEnd() : next;
+    }
+
+    indices.resize(result.size());
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<Index> &indices, const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2)
+        return;
+
+    struct Cluster
+    {
+        uint32_t begin;
+        uint32_t end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+
+    std::vector<Cluster> sorted(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        Cluster &cluster = sorted[i];
+        cluster.begin = clusters[i];
+        cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : static_cast<uint32_t>(triangleCount);
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+
+        float area = 0.0f;
+        for (uint32_t t = cluster.begin; t < cluster.end; t++)
+        {
+            glm::vec3 a = positions[indices[t * 3]];
+            glm::vec3 b = positions[indices[t * 3 + 1]];
+            glm::vec3 c = positions[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(normal);
+
+            cluster.centroid += (a + b + c) * (triangleArea / 3.0f);
+            cluster.normal += normal;
+            area += triangleArea;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += area;
+        if (area > 0.0f)
+            cluster.centroid /= area;
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Sander et al.: clusters further out along their normal are more likely to occlude others
+    for (Cluster &cluster : sorted)
+    {
+        float length = glm::length(cluster.normal);
+        cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+    std::vector<Index> result;
+    result.reserve(indices.size());
+    for (const Cluster &cluster : sorted)
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(void *vertices, size_t vertexCount, size_t vertexStride, std::vector<Index> &indices)
+{
+    constexpr Index unused = ~Index(0);
+    std::vector<Index> remap(vertexCount, unused);
+    Index next = 0;
+
+    for (Index &index : indices)
+    {
+        if (remap[index] == unused)
+            remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<uint8_t> reordered(static_cast<size_t>(next) * vertexStride);
+    const uint8_t *source = static_cast<const uint8_t *>(vertices);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        if (remap[i] != unused)
+            std::memcpy(reordered.data() + remap[i] * vertexStride, source + i * vertexStride, vertexStride);
+    }
+
+    if (!reordered.empty())
+        std::memcpy(vertices, reordered.data(), reordered.size());
+    return next;
+}
+
+std::vector<Index> MeshOptimizer::simplify(const std::vector<Index> &indices, const std::vector<glm::vec3> &positions, size_t targetIndexCount,
+                                           float maxError, float &error)
+{
+    error = 0.0f;
+
+    std::vector<Index> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    if (result.size() <= targetIndexCount)
+        return result;
+
+    size_t vertexCount = positions.size();
+    std::vector<Index> remap = buildPositionRemap(positions);
+
+    // Seams, borders and non-manifold edges never move. Seams are positions with more
+    // than one vertex, borders are edges with a single triangle.
+    std::vector<uint8_t> locked(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        if (remap[i] != i)
+        {
+            locked[i] = 1;
+            locked[remap[i]] = 1;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    edgeTriangles.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3)
+        for (int e = 0; e < 3; e++)
+            edgeTriangles[getEdgeKey(remap[result[i + e]], remap[result[i + (e + 1) % 3]])]++;
+
+    for (const auto &[key, count] : edgeTriangles)
+    {
+        if (count != 2)
+        {
+            locked[static_cast<Index>(key >> 32)] = 1;
+            locked[static_cast<Index>(key & 0xFFFFFFFF)] = 1;
+        }
+    }
+    for (size_t i = 0; i < vertexCount; i++)
+        locked[i] = locked[remap[i]];
+
+    // One quadric per position
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        glm::dvec3 a = positions[result[i]];
+        glm::dvec3 b = positions[result[i + 1]];
+        glm::dvec3 c = positions[result[i + 2]];
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+
+        normal /= length;
+        for (int k = 0; k < 3; k++)
+            quadrics[remap[result[i + k]]].addPlane(normal, -glm::dot(normal, a), length * 0.5);
+    }
+
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    Adjacency adjacency;
+    std::vector<Collapse> cheapest(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint8_t> removed;
+    std::vector<Index> ring;
+
+    // Each pass collapses the cheapest edges whose neighborhoods don't overlap, then the
+    // adjacency is rebuilt for the next one
+    while (result.size() > targetIndexCount)
+    {
+        adjacency.build(result, vertexCount);
+
+        // The cheapest edge out of every vertex, the others would be blocked by it anyway
+        std::fill(cheapest.begin(), cheapest.end(), Collapse{0, 0, HUGE_VAL});
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                Index from = result[i + e];
+                Index to = result[i + (e + 1) % 3];
+                if (locked[from] || remap[from] == remap[to])
+                    continue;
+
+                double cost = quadrics[from].evaluate(positions[to]);
+                if (cost <= maxCost && cost < cheapest[from].cost)
+                    cheapest[from] = {from, to, cost};
+            }
+        }
+
+        collapses.clear();
+        for (const Collapse &collapse : cheapest)
+            if (collapse.cost != HUGE_VAL)
+                collapses.push_back(collapse);
+
+        if (collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), 0);
+        removed.assign(result.size() / 3, 0);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removedCount = 0;
+
+        for (const Collapse &collapse : collapses)
+        {
+            if (touched[remap[collapse.from]] || touched[remap[collapse.to]])
+                continue;
+
+            bool valid = keepsManifold(result, remap, adjacency, collapse.from, collapse.to, ring);
+            for (const uint32_t *t = adjacency.begin(collapse.from); valid && t != adjacency.end(collapse.from); ++t)
+            {
+                const Index *corners = &result[*t * 3];
+                bool shared = corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to;
+                if (!shared && flipsTriangle(result, positions, *t, collapse.from, collapse.to))
+                    valid = false;
+            }
+
+            if (!valid)
+                continue;
+
+            // Triangles on the edge disappear, the rest of the fan moves over to the kept vertex
+            for (const uint32_t *t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from); ++t)
+            {
+                Index *corners = &result[*t * 3];
+                for (int i = 0; i < 3; i++)
+                    touched[remap[corners[i]]] = 1;
+
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                {
+                    removed[*t] = 1;
+                    removedCount++;
+                }
+                else
+                {
+                    for (int i = 0; i < 3; i++)
+                        if (corners[i] == collapse.from)
+                            corners[i] = collapse.to;
+                }
+            }
+
+            quadrics[remap[collapse.to]].add(quadrics[collapse.from]);
+            error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+
+            if (removedCount >= trianglesToRemove)
+                break;
+        }
+
+        if (removedCount == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t t = 0; t < removed.size(); t++)
+        {
+            if (removed[t])
+                continue;
+            for (int i = 0; i < 3; i++)
+                result[write++] = result[t * 3 + i];
+        }
+        result.resize(write);
+    }
+
+    return result;
+}
+
+void MeshOptimizer::optimize(void *vertices, size_t &vertexCount, size_t vertexStride, std::vector<Index> &indices)
+{
+    optimizeVertexCache(indices, vertexCount);
+    vertexCount = optimizeVertexFetch(vertices, vertexCount, vertexStride, indices);
+}
+
+std::vector<MeshLod> MeshOptimizer::buildLods(std::vector<RenderPipeline::Vertex> &vertices, std::vector<Index> &indices, glm::vec3 positionScale,
+                                               const LodSettings &settings)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        positions[i] = VertexFormat::unpackPosition(vertices[i].pos) * positionScale;
+
+    float maxError = settings.maxError * std::max(positionScale.x, std::max(positionScale.y, positionScale.z));
+
+    // Every level is simplified from the one before, its error bound is the sum along the chain
+    std::vector<std::vector<Index>> levels;
+    std::vector<float> errors;
+    levels.push_back(indices);
+    errors.push_back(0.0f);
+
+    while (levels.size() < settings.maxLevels && levels.back().size() / 3 > settings.minTriangles)
+    {
+        size_t target = static_cast<size_t>(static_cast<float>(levels.back().size()) * settings.reduction) / 3 * 3;
+
+        float error;
+        std::vector<Index> level = simplify(levels.back(), positions, target, maxError - errors.back(), error);
+
+        // Stuck on locked vertices or the error limit, a level this close to the last one isn't worth its memory
+        if (level.empty() || level.size() > levels.back().size() * 9 / 10)
+            break;
+
+        levels.push_back(std::move(level));
+        errors.push_back(errors.back() + error);
+    }
+
+    std::vector<MeshLod> lods;
+    std::vector<uint32_t> clusters;
+    indices.clear();
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        optimizeVertexCache(levels[i], vertices.size(), &clusters);
+        optimizeOverdraw(levels[i], positions, clusters);
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(indices.size());
+        lod.indexCount = static_cast<uint32_t>(levels[i].size());
+        lod.error = errors[i];
+        lods.push_back(lod);
+
+        indices.insert(indices.end(), levels[i].begin(), levels[i].end());
+    }
+
+    // The finest level comes first in the index buffer, so its vertices come first too
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), sizeof(RenderPipeline::Vertex), indices));
+    return lods;
+}
+
+std::vector<MeshCluster> MeshOptimizer::buildClusters(const std::vector<RenderPipeline::Vertex> &vertices, const std::vector<Index> &indices,
+                                                      std::vector<MeshLod> &lods, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        positions[i] = VertexFormat::unpackPosition(vertices[i].pos);
+
+    std::vector<MeshCluster> clusters;
+
+    // Cluster each vertex was last counted in, clusters are numbered across all levels
+    std::vector<uint32_t> lastCluster(vertices.size(), UINT32_MAX);
+
+    for (MeshLod &lod : lods)
+    {
+        lod.firstCluster = static_cast<uint32_t>(clusters.size());
+
+        MeshCluster cluster;
+        uint32_t vertexCount = 0;
+
+        for (uint32_t i = lod.firstIndex; i + 2 < lod.firstIndex + lod.indexCount; i += 3)
+        {
+            uint32_t current = static_cast<uint32_t>(clusters.size());
+            uint32_t newVertices = 0;
+            for (int corner = 0; corner < 3; corner++)
+                newVertices += lastCluster[indices[i + corner]] != current;
+
+            if (cluster.indexCount > 0 && (vertexCount + newVertices > maxVertices || cluster.indexCount / 3 >= maxTriangles))
+            {
+                computeClusterBounds(cluster, indices, positions);
+                clusters.push_back(cluster);
+
+                cluster = MeshCluster();
+                vertexCount = 0;
+                current++;
+            }
+
+            if (cluster.indexCount == 0)
+                cluster.firstIndex = i;
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                if (lastCluster[indices[i + corner]] != current)
+                {
+                    lastCluster[indices[i + corner]] = current;
+                    vertexCount++;
+                }
+            }
+            cluster.indexCount += 3;
+        }
+
+        if (cluster.indexCount > 0)
+        {
+            computeClusterBounds(cluster, indices, positions);
+            clusters.push_back(cluster);
+        }
+
+        lod.clusterCount = static_cast<uint32_t>(clusters.size()) - lod.firstCluster;
+    }
+
+    return clusters;
+}
@@ -0,0 +1,399 @@
+#include "mipGenerator.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    struct LayoutAccess
+    {
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+    };
+
+    // What last wrote level 0 in the layout it is handed over in
+    LayoutAccess getWriteAccess(VkImageLayout layout)
+    {
+        switch (layout)
+        {
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: // final layout of the render pass
+            return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+        case VK_IMAGE_LAYOUT_GENERAL:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT};
+        default:
+            // Uploads leave it in SHADER_READ_ONLY_OPTIMAL after a fence, nothing to wait for
+            return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0};
+        }
+    }
+
+    // What reads the finished chain in its final layout
+    LayoutAccess getReadAccess(VkImageLayout layout)
+    {
+        switch (layout)
+        {
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        case VK_IMAGE_LAYOUT_GENERAL:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        default:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+        }
+    }
+
+    VkImageMemoryBarrier makeBarrier(VkImage image, uint32_t baseMip, uint32_t mipCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                     VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = baseMip;
+        barrier.subresourceRange.levelCount = mipCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        return barrier;
+    }
+}
+
+uint32_t MipGenerator::getMipCount(VkExtent2D extent)
+{
+    uint32_t mipCount = 1;
+    for (uint32_t size = std::max(extent.width, extent.height); size > 1; size /= 2)
+        mipCount++;
+    return mipCount;
+}
+
+void MipGenerator::init(const MipGeneratorCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    deviceProfile = createInfo.deviceProfile;
+    allocator = createInfo.allocator;
+    layoutCache = createInfo.layoutCache;
+
+    VkFormatProperties properties = deviceProfile->getFormatProperties(VK_FORMAT_R8G8B8A8_UNORM);
+    computeSupported = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+
+    if (!computeSupported)
+        return;
+
+    downsamplePipeline.init(device, layoutCache, createInfo.shaderStore, createInfo.pipelineCache, "shaders/downsample.comp.spv");
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+
+    sampler = createInfo.samplerCache->get(samplerInfo);
+
+    // Workgroups count how many of them finished, the last one writes the smallest levels
+    CreateBufferInfo bufferCreateInfo = {};
+    bufferCreateInfo.size = sizeof(uint32_t);
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    createBuffer(bufferCreateInfo, allocator, counterBuffer.allocation, counterBuffer.buffer);
+}
+
+void MipGenerator::cleanup()
+{
+    for (auto &[image, imageViews] : views)
+    {
+        vkDestroyImageView(device, imageViews.source, nullptr);
+        for (VkImageView view : imageViews.mips)
+            if (view != VK_NULL_HANDLE)
+                vkDestroyImageView(device, view, nullptr);
+    }
+    views.clear();
+
+    if (computeSupported)
+    {
+        vmaDestroyBuffer(allocator, counterBuffer.buffer, counterBuffer.allocation);
+        downsamplePipeline.cleanup();
+    }
+}
+
+MipMethod MipGenerator::chooseMethod(VkFormat format, uint32_t mipLevels) const
+{
+    if (computeSupported && mipLevels <= maxComputeMips && getStorageFormat(format) != VK_FORMAT_UNDEFINED)
+        return MipMethod::Compute;
+
+    VkFormatProperties properties = deviceProfile->getFormatProperties(format);
+
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((properties.optimalTilingFeatures & blitFeatures) == blitFeatures)
+        return MipMethod::Blit;
+
+    return MipMethod::Unsupported;
+}
+
+VkImageUsageFlags MipGenerator::getImageUsage(VkFormat format, uint32_t mipLevels) const
+{
+    switch (chooseMethod(format, mipLevels))
+    {
+    case MipMethod::Compute:
+        return VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    case MipMethod::Blit:
+        return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    default:
+        return 0;
+    }
+}
+
+VkImageCreateFlags MipGenerator::getImageFlags(VkFormat format, uint32_t mipLevels) const
+{
+    // sRGB formats can't be storage images, the levels are written through UNORM views
+    if (chooseMethod(format, mipLevels) == MipMethod::Compute && getStorageFormat(format) != format)
+        return VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+
+    return 0;
+}
+
+void MipGenerator::generate(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const MipTarget &target,
+                            VkImageLayout srcLayout, VkImageLayout finalLayout)
+{
+    if (target.mipLevels <= 1)
+    {
+        transition(commandBuffer, target, srcLayout, finalLayout);
+        return;
+    }
+
+    switch (chooseMethod(target.format, target.mipLevels))
+    {
+    case MipMethod::Compute:
+        generateCompute(commandBuffer, descriptorAllocator, target, srcLayout, finalLayout);
+        break;
+    case MipMethod::Blit:
+        generateBlit(commandBuffer, target, srcLayout, finalLayout);
+        break;
+    default:
+        throw std::runtime_error("failed to generate mips, the format supports neither storage nor blits!");
+    }
+
+    levelsGenerated += target.mipLevels - 1;
+}
+
+void MipGenerator::request(const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout)
+{
+    requests.push_back({target, srcLayout, finalLayout});
+}
+
+void MipGenerator::record(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator)
+{
+    for (const auto &pending : requests)
+        generate(commandBuffer, descriptorAllocator, pending.target, pending.srcLayout, pending.finalLayout);
+    requests.clear();
+}
+
+void MipGenerator::forget(VkImage image)
+{
+    auto it = views.find(image);
+    if (it == views.end())
+        return;
+
+    vkDestroyImageView(device, it->second.source, nullptr);
+    for (VkImageView view : it->second.mips)
+        if (view != VK_NULL_HANDLE)
+            vkDestroyImageView(device, view, nullptr);
+
+    views.erase(it);
+}
+
+void MipGenerator::printStatistics() const
+{
+    std::cerr << "Mip generator: " << dispatches << " dispatches, " << blitChains << " blit chains, "
+              << levelsGenerated << " levels generated, " << views.size() << " images with cached views" << std::endl;
+}
+
+VkFormat MipGenerator::getStorageFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+const MipGenerator::Views &MipGenerator::getViews(const MipTarget &target)
+{
+    auto it = views.find(target.image);
+    if (it != views.end())
+        return it->second;
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = target.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    Views imageViews = {};
+    if (vkCreateImageView(device, &viewInfo, nullptr, &imageViews.source) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create mip source image view!");
+    }
+
+    viewInfo.format = getStorageFormat(target.format);
+    for (uint32_t mip = 1; mip < target.mipLevels; mip++)
+    {
+        viewInfo.subresourceRange.baseMipLevel = mip;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &imageViews.mips[mip - 1]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip storage image view!");
+        }
+    }
+
+    return views.emplace(target.image, imageViews).first->second;
+}
+
+void MipGenerator::generateCompute(VkCommandBuffer commandBuffer, DescriptorAllocator &descriptorAllocator, const MipTarget &target,
+                                   VkImageLayout srcLayout, VkImageLayout finalLayout)
+{
+    const Views &imageViews = getViews(target);
+    LayoutAccess source = getWriteAccess(srcLayout);
+
+    // Earlier frames may still sample the lower levels, and the previous dispatch may still
+    // be counting workgroups, before they are overwritten
+    std::array<VkImageMemoryBarrier, 2> imageBarriers = {
+        makeBarrier(target.image, 0, 1, srcLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, source.access, VK_ACCESS_SHADER_READ_BIT),
+        makeBarrier(target.image, 1, target.mipLevels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT),
+    };
+
+    VkBufferMemoryBarrier counterBarrier = {};
+    counterBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    counterBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    counterBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    counterBarrier.buffer = counterBuffer.buffer;
+    counterBarrier.offset = 0;
+    counterBarrier.size = VK_WHOLE_SIZE;
+    counterBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, source.stage | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &counterBarrier,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    vkCmdFillBuffer(commandBuffer, counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+    counterBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &counterBarrier, 0, nullptr);
+
+    VkDescriptorSetLayout setLayout = downsamplePipeline.getDescriptorSetLayout(0);
+    VkDescriptorSet descriptorSet = descriptorAllocator.allocate(setLayout);
+
+    // Binding order, array slots past the last level repeat it, the shader never writes them
+    std::array<DescriptorInfo, maxComputeMips + 1> descriptors{};
+    descriptors[0].image = {sampler, imageViews.source, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    for (uint32_t mip = 1; mip < maxComputeMips; mip++)
+        descriptors[mip].image = {VK_NULL_HANDLE, imageViews.mips[std::min(mip, target.mipLevels - 1) - 1], VK_IMAGE_LAYOUT_GENERAL};
+    descriptors[maxComputeMips].buffer = {counterBuffer.buffer, 0, VK_WHOLE_SIZE};
+    layoutCache->update(descriptorSet, setLayout, descriptors.data());
+
+    // 64x64 texels of level 0 per workgroup
+    uint32_t groupsX = (target.extent.width + 63) / 64;
+    uint32_t groupsY = (target.extent.height + 63) / 64;
+
+    PushConstants pushConstants = {};
+    pushConstants.invSize[0] = 1.0f / static_cast<float>(target.extent.width);
+    pushConstants.invSize[1] = 1.0f / static_cast<float>(target.extent.height);
+    pushConstants.mipCount = target.mipLevels - 1;
+    pushConstants.workGroupCount = groupsX * groupsY;
+    pushConstants.srgb = target.format == VK_FORMAT_R8G8B8A8_SRGB;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePipeline.getPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePipeline.getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, downsamplePipeline.getPipelineLayout(), downsamplePipeline.getPushConstantStages(), 0, sizeof(pushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+    LayoutAccess destination = getReadAccess(finalLayout);
+
+    imageBarriers = {
+        makeBarrier(target.image, 0, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, finalLayout, 0, destination.access),
+        makeBarrier(target.image, 1, target.mipLevels - 1, VK_IMAGE_LAYOUT_GENERAL, finalLayout, VK_ACCESS_SHADER_WRITE_BIT, destination.access),
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, destination.stage, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    dispatches++;
+}
+
+void MipGenerator::generateBlit(VkCommandBuffer commandBuffer, const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout)
+{
+    VkFormatProperties properties = deviceProfile->getFormatProperties(target.format);
+    VkFilter filter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    LayoutAccess source = getWriteAccess(srcLayout);
+
+    std::array<VkImageMemoryBarrier, 2> imageBarriers = {
+        makeBarrier(target.image, 0, 1, srcLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, source.access, VK_ACCESS_TRANSFER_READ_BIT),
+        makeBarrier(target.image, 1, target.mipLevels - 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, source.stage | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+    int32_t width = static_cast<int32_t>(target.extent.width);
+    int32_t height = static_cast<int32_t>(target.extent.height);
+
+    for (uint32_t mip = 1; mip < target.mipLevels; mip++)
+    {
+        int32_t mipWidth = std::max(width / 2, 1);
+        int32_t mipHeight = std::max(height / 2, 1);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1};
+        blit.srcOffsets[1] = {width, height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1};
+        blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+
+        vkCmdBlitImage(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+        // The level just written is the source of the next blit
+        VkImageMemoryBarrier barrier = makeBarrier(target.image, mip, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        width = mipWidth;
+        height = mipHeight;
+    }
+
+    LayoutAccess destination = getReadAccess(finalLayout);
+    VkImageMemoryBarrier barrier = makeBarrier(target.image, 0, target.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, finalLayout,
+                                               VK_ACCESS_TRANSFER_WRITE_BIT, destination.access);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, destination.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    blitChains++;
+}
+
+void MipGenerator::transition(VkCommandBuffer commandBuffer, const MipTarget &target, VkImageLayout srcLayout, VkImageLayout finalLayout)
+{
+    LayoutAccess source = getWriteAccess(srcLayout);
+    LayoutAccess destination = getReadAccess(finalLayout);
+
+    VkImageMemoryBarrier barrier = makeBarrier(target.image, 0, 1, srcLayout, finalLayout, source.access, destination.access);
+    vkCmdPipelineBarrier(commandBuffer, source.stage, destination.stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
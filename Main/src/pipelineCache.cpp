@@ -0,0 +1,164 @@
+#include "pipelineCache.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    // Our own prefix in front of the driver blob, catches truncated or corrupted files
+    // before they reach the driver and records the driver version which the Vulkan header lacks.
+    struct CacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t driverVersion;
+        uint32_t reserved;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    constexpr uint32_t cacheFileMagic = 0x43505556; // "VUPC"
+    constexpr uint32_t cacheFileVersion = 1;
+}
+
+void PipelineCache::init(VkDevice _device, const VkPhysicalDeviceProperties &_properties, const std::string &_path)
+{
+    device = _device;
+    path = _path;
+    properties = _properties;
+
+    std::vector<char> data;
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        size_t fileSize = (size_t)file.tellg();
+        CacheFileHeader header = {};
+
+        if (fileSize >= sizeof(header))
+        {
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+            if (header.magic == cacheFileMagic && header.version == cacheFileVersion &&
+                header.driverVersion == properties.driverVersion &&
+                header.dataSize == fileSize - sizeof(header))
+            {
+                data.resize((size_t)header.dataSize);
+                file.read(data.data(), data.size());
+
+                if (!file || Hash::fnv1a(data.data(), data.size()) != header.dataHash || !isCompatible(data))
+                    data.clear();
+            }
+        }
+
+        file.close();
+
+        if (data.empty())
+            std::cerr << "Discarding incompatible pipeline cache: " << path << std::endl;
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    std::cerr << "Loaded pipeline cache: " << data.size() << " bytes" << std::endl;
+
+    savedSize = data.size();
+    lastSave = std::chrono::steady_clock::now();
+}
+
+void PipelineCache::cleanup()
+{
+    save();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS)
+        return;
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+        return;
+    data.resize(dataSize);
+
+    CacheFileHeader header = {};
+    header.magic = cacheFileMagic;
+    header.version = cacheFileVersion;
+    header.driverVersion = properties.driverVersion;
+    header.dataSize = data.size();
+    header.dataHash = Hash::fnv1a(data.data(), data.size());
+
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to write pipeline cache: " << temporaryPath << std::endl;
+            return;
+        }
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        file.flush();
+
+        if (!file)
+        {
+            std::cerr << "Failed to write pipeline cache: " << temporaryPath << std::endl;
+            return;
+        }
+    }
+
+    if (!replaceFile(temporaryPath, path))
+    {
+        std::cerr << "Failed to replace pipeline cache: " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    savedSize = data.size();
+    lastSave = std::chrono::steady_clock::now();
+}
+
+void PipelineCache::saveIfDue(std::chrono::seconds interval)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSave < interval)
+        return;
+
+    lastSave = now;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) == VK_SUCCESS && dataSize != savedSize)
+        save();
+}
+
+bool PipelineCache::isCompatible(const std::vector<char> &data) const
+{
+    VkPipelineCacheHeaderVersionOne header = {};
+    if (data.size() < sizeof(header))
+        return false;
+
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
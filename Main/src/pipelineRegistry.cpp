@@ -0,0 +1,305 @@
+#include "pipelineRegistry.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    struct WarmUpListHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t keySize;
+        uint32_t keyCount;
+    };
+
+    constexpr uint32_t warmUpListMagic = 0x4C575056; // "VPWL"
+    constexpr uint32_t warmUpListVersion = 1;
+}
+
+void PipelineRegistry::init(VkDevice _device, JobSystem *_jobSystem, const std::string &_warmUpPath)
+{
+    device = _device;
+    jobSystem = _jobSystem;
+    warmUpPath = _warmUpPath;
+}
+
+void PipelineRegistry::cleanup()
+{
+    jobSystem->wait();
+
+    saveWarmUpList();
+
+    // Rebuilds that finished after the last frame were never swapped in
+    for (auto &rebuild : rebuilds)
+    {
+        if (!rebuild->failed)
+            rebuild->pipeline->destroy(rebuild->build);
+    }
+    rebuilds.clear();
+
+    for (auto &entry : retired)
+        destroyRetired(entry);
+    retired.clear();
+
+    for (auto &[hash, variant] : variants)
+    {
+        if (variant->pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(device, variant->pipeline, nullptr);
+    }
+
+    variants.clear();
+    pipelines.clear();
+}
+
+void PipelineRegistry::add(GraphicsPipeline *pipeline)
+{
+    pipelines.push_back(pipeline);
+}
+
+void PipelineRegistry::warmUp()
+{
+    std::vector<PipelineStateKey> keys;
+    loadWarmUpList(keys);
+
+    uint32_t queued = 0;
+    for (const auto &key : keys)
+    {
+        for (auto *pipeline : pipelines)
+        {
+            if (pipeline->ownsKey(key))
+            {
+                request(*pipeline, key);
+                queued++;
+                break;
+            }
+        }
+    }
+
+    std::cerr << "Pipeline warm-up: " << queued << " of " << keys.size() << " variants queued on "
+              << jobSystem->getThreadCount() << " threads" << std::endl;
+}
+
+void PipelineRegistry::reload(const std::string &shaderPath)
+{
+    for (auto *pipeline : pipelines)
+    {
+        if (!pipeline->usesShader(shaderPath))
+            continue;
+
+        std::cerr << "Reloading " << shaderPath << std::endl;
+
+        auto rebuild = std::make_unique<Rebuild>();
+        rebuild->pipeline = pipeline;
+
+        Rebuild *job = rebuild.get();
+        rebuilds.push_back(std::move(rebuild));
+
+        jobSystem->submit([job] {
+            try
+            {
+                job->build = job->pipeline->rebuild();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Shader reload failed, keeping the previous pipeline: " << e.what() << std::endl;
+                job->failed = true;
+            }
+            job->done.store(true, std::memory_order_release);
+        });
+    }
+}
+
+void PipelineRegistry::update(uint64_t frameNumber, uint32_t framesInFlight)
+{
+    for (auto it = rebuilds.begin(); it != rebuilds.end();)
+    {
+        Rebuild &rebuild = **it;
+        if (!rebuild.done.load(std::memory_order_acquire))
+        {
+            ++it;
+            continue;
+        }
+
+        if (!rebuild.failed)
+        {
+            GraphicsPipeline::Build previous = rebuild.pipeline->swap(rebuild.build);
+            retired.push_back(Retired{frameNumber, rebuild.pipeline, previous, nullptr});
+            retireVariants(rebuild.pipeline, frameNumber);
+        }
+
+        it = rebuilds.erase(it);
+    }
+
+    for (auto it = retired.begin(); it != retired.end();)
+    {
+        if (frameNumber >= it->frameNumber + framesInFlight && destroyRetired(*it))
+            it = retired.erase(it);
+        else
+            ++it;
+    }
+}
+
+VkPipeline PipelineRegistry::get(GraphicsPipeline &pipeline, const PipelineStateKey &key)
+{
+    VkPipeline variant = tryGet(pipeline, key);
+    return variant != VK_NULL_HANDLE ? variant : pipeline.getPipeline();
+}
+
+VkPipeline PipelineRegistry::tryGet(GraphicsPipeline &pipeline, const PipelineStateKey &key)
+{
+    if (key == pipeline.getDefaultKey())
+        return pipeline.getPipeline();
+
+    Variant *variant = request(pipeline, key);
+    if (variant == nullptr || variant->state.load(std::memory_order_acquire) != VariantState::Ready)
+        return VK_NULL_HANDLE;
+
+    return variant->pipeline;
+}
+
+PipelineRegistry::Variant *PipelineRegistry::request(GraphicsPipeline &pipeline, const PipelineStateKey &key)
+{
+    uint64_t hash = key.hash();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = variants.find(hash);
+    if (it != variants.end())
+    {
+        if (!(it->second->key == key))
+        {
+            std::cerr << "Pipeline state hash collision: " << hash << std::endl;
+            return nullptr;
+        }
+        return it->second.get();
+    }
+
+    auto variant = std::make_unique<Variant>();
+    variant->owner = &pipeline;
+    variant->key = key;
+
+    Variant *result = variant.get();
+    variants.emplace(hash, std::move(variant));
+
+    pendingCount++;
+    jobSystem->submit([this, result] { compile(result); });
+
+    return result;
+}
+
+void PipelineRegistry::compile(Variant *variant)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+        variant->pipeline = variant->owner->createVariant(variant->key);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << "Compiled pipeline variant " << variant->key.hash() << " in " << elapsed.count() << " ms" << std::endl;
+
+        // A retired variant may be destroyed as soon as it leaves Compiling, don't touch it after this
+        variant->state.store(VariantState::Ready, std::memory_order_release);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Pipeline variant " << variant->key.hash() << ": " << e.what() << std::endl;
+        variant->state.store(VariantState::Failed, std::memory_order_release);
+    }
+
+    pendingCount--;
+}
+
+void PipelineRegistry::retireVariants(GraphicsPipeline *pipeline, uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Dropped from the map so the next request compiles them against the new shaders
+    for (auto it = variants.begin(); it != variants.end();)
+    {
+        if (it->second->owner == pipeline)
+        {
+            retired.push_back(Retired{frameNumber, pipeline, {}, std::move(it->second)});
+            it = variants.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+bool PipelineRegistry::destroyRetired(Retired &entry)
+{
+    if (entry.variant)
+    {
+        // Still owned by its compile job
+        if (entry.variant->state.load(std::memory_order_acquire) == VariantState::Compiling)
+            return false;
+
+        if (entry.variant->pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(device, entry.variant->pipeline, nullptr);
+        return true;
+    }
+
+    entry.pipeline->destroy(entry.build);
+    return true;
+}
+
+void PipelineRegistry::loadWarmUpList(std::vector<PipelineStateKey> &keys) const
+{
+    std::ifstream file(warmUpPath, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return;
+
+    size_t fileSize = (size_t)file.tellg();
+    WarmUpListHeader header = {};
+    if (fileSize < sizeof(header))
+        return;
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    // A changed key layout makes the whole list useless, the next run writes a new one
+    if (!file || header.magic != warmUpListMagic || header.version != warmUpListVersion ||
+        header.keySize != sizeof(PipelineStateKey))
+        return;
+
+    // The count comes from disk, a corrupted one must not decide how much is allocated
+    if (header.keyCount > (fileSize - sizeof(header)) / sizeof(PipelineStateKey))
+    {
+        std::cerr << "Discarding corrupted pipeline warm-up list: " << warmUpPath << std::endl;
+        return;
+    }
+
+    keys.resize(header.keyCount);
+    file.read(reinterpret_cast<char *>(keys.data()), keys.size() * sizeof(PipelineStateKey));
+
+    if (!file)
+        keys.clear();
+}
+
+void PipelineRegistry::saveWarmUpList() const
+{
+    std::vector<PipelineStateKey> keys;
+    for (const auto &[hash, variant] : variants)
+    {
+        if (variant->state.load() == VariantState::Ready)
+            keys.push_back(variant->key);
+    }
+
+    std::ofstream file(warmUpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write pipeline warm-up list: " << warmUpPath << std::endl;
+        return;
+    }
+
+    WarmUpListHeader header = {};
+    header.magic = warmUpListMagic;
+    header.version = warmUpListVersion;
+    header.keySize = sizeof(PipelineStateKey);
+    header.keyCount = static_cast<uint32_t>(keys.size());
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(PipelineStateKey));
+}
@@ -11,15 +11,16 @@ ShaderInfo PresentPipeline::getVertexShader()
 
 ShaderInfo PresentPipeline::getFragmentShader()
 {
-    return ShaderInfo{"shaders/present.frag.spv", "main"};
-}
+    if (filter == PresentFilter::EdgeAdaptive)
+        return ShaderInfo{"shaders/present_upscale.frag.spv", "main"};
 
-std::vector<VkVertexInputBindingDescription> PresentPipeline::getBindingDescription()
-{
-    return {Vertex::getBindingDescription()};
+    if (bindless)
+        return ShaderInfo{"shaders/present_bindless.frag.spv", "main"};
+
+    return ShaderInfo{"shaders/present.frag.spv", "main"};
 }
 
-std::vector<VkVertexInputAttributeDescription> PresentPipeline::getAttributeDescriptions()
+VertexInputDescription PresentPipeline::getVertexInput()
 {
-    return Vertex::getAttributeDescriptions();
+    return VertexInputDescription::of<VertexDescription>();
 }
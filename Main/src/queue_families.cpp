@@ -1,247 +1,288 @@
 #include "queue_families.hpp"
 #include <algorithm>
-#include <iostream>
+#include <array>
+#include <map>
+#include <set>
 
 namespace __QueueFamilies_Impl
 {
+    enum Role : uint32_t
+    {
+        Graphics,
+        Compute,
+        Transfer,
+        Present,
+        RoleCount
+    };
 
-    QueueFamilyOptions findQueueFamily(
-        const std::vector<VkQueueFamilyProperties> &queueFamilies,
-        std::function<bool(VkQueueFamilyProperties, uint32_t index)> matchOnlyRequiredFlag,
-        std::function<bool(VkQueueFamilyProperties, uint32_t index)> matchOptionalFlag)
+    bool serves(const QueueFamilyInfo &family, uint32_t role)
     {
+        switch (role)
+        {
+        case Graphics:
+            return family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        case Compute:
+            return family.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        case Transfer:
+            return family.queueFlags & VK_QUEUE_TRANSFER_BIT;
+        case Present:
+            return family.presentSupport;
+        default:
+            return false;
+        }
+    }
 
-        std::vector<QueueFamilyIndex> onlyRequiredFlagQueue;
-        std::vector<QueueFamilyIndex> requiredAndOptionalFlagQueue;
+    uint32_t countRoles(uint32_t roles)
+    {
+        uint32_t count = 0;
+        for (; roles; roles &= roles - 1)
+            count++;
+        return count;
+    }
 
-        for (size_t i = 0; i < queueFamilies.size(); i++)
+    // Depth first over the roles in order, candidates in preference order. Families that
+    // serve the same roles only differ in how many queues they have left, so whether the
+    // remaining roles can be placed only depends on how many families of each such group
+    // have 0, 1, ... queues left, capped at the number of roles left, and on whether present
+    // can share the graphics family. Failed states are remembered, and a candidate of the
+    // same group with as many queues left as one already tried at that step is skipped,
+    // which keeps the search linear in the number of families even when nothing fits.
+    struct Solver
+    {
+        static constexpr uint32_t maxLeft = RoleCount; // queues beyond one per role look the same
+
+        const std::vector<QueueFamilyInfo> &table;
+        QueueFamilySolveStats &stats;
+
+        std::vector<uint32_t> servedRoles; // bit per role
+        std::vector<uint32_t> groups;      // of every family, families of a group serve the same roles
+        std::vector<uint32_t> groupRoles;
+        std::vector<std::array<uint32_t, maxLeft + 1>> groupLeft; // families of a group by queues left
+        std::array<std::vector<uint32_t>, RoleCount> candidates = {};
+        std::array<uint32_t, RoleCount> chosen = {};
+        std::vector<uint32_t> used;
+        std::set<std::vector<uint32_t>> failed;
+
+        Solver(const std::vector<QueueFamilyInfo> &_table, QueueFamilySolveStats &_stats)
+            : table(_table), stats(_stats), servedRoles(_table.size(), 0), groups(_table.size(), 0), used(_table.size(), 0)
         {
-            auto queueFamily = queueFamilies[i];
-            if (matchOnlyRequiredFlag(queueFamily, (uint32_t)i) && !matchOptionalFlag(queueFamily, (uint32_t)i))
+            std::array<uint32_t, 1u << RoleCount> groupOfRoles;
+            groupOfRoles.fill(UINT32_MAX);
+
+            for (uint32_t family = 0; family < table.size(); family++)
             {
-                onlyRequiredFlagQueue.push_back(
-                    QueueFamilyIndex{
-                        (uint32_t)i,
-                        queueFamily.queueCount,
-                    });
+                for (uint32_t role = 0; role < RoleCount; role++)
+                {
+                    if (serves(table[family], role))
+                        servedRoles[family] |= 1u << role;
+                }
+
+                uint32_t &group = groupOfRoles[servedRoles[family]];
+                if (group == UINT32_MAX)
+                {
+                    group = static_cast<uint32_t>(groupRoles.size());
+                    groupRoles.push_back(servedRoles[family]);
+                    groupLeft.push_back({});
+                }
+
+                groups[family] = group;
+                groupLeft[group][left(family)]++;
             }
 
-            if (matchOptionalFlag(queueFamily, (uint32_t)i) && matchOnlyRequiredFlag(queueFamily, (uint32_t)i))
+            // Families that serve fewer of the other roles first
+            for (uint32_t role = 0; role < RoleCount; role++)
             {
-                requiredAndOptionalFlagQueue.push_back(
-                    QueueFamilyIndex{
-                        (uint32_t)i,
-                        queueFamily.queueCount,
-                    });
+                std::vector<std::pair<uint32_t, uint32_t>> ranked;
+                for (uint32_t family = 0; family < table.size(); family++)
+                {
+                    if (servedRoles[family] & (1u << role))
+                        ranked.push_back({countRoles(servedRoles[family] & ~(1u << role)), family});
+                }
+
+                std::sort(ranked.begin(), ranked.end());
+                for (const auto &candidate : ranked)
+                    candidates[role].push_back(candidate.second);
             }
         }
 
-        return QueueFamilyOptions{
-            onlyRequiredFlagQueue,
-            requiredAndOptionalFlagQueue};
-    }
-
- 
-
-    void tryIncrement(QueueFamilyIndices& indices, std::vector<QueueFamilyFindData*>& findData)
-    {
-
-        if (indices.isComplete()) {
-            return;
+        bool hasCandidates() const
+        {
+            return std::none_of(candidates.begin(), candidates.end(), [](const std::vector<uint32_t> &families)
+                                { return families.empty(); });
         }
 
-        for(auto data : findData) {
-            if(data->canIncrement() && !data->output.has_value()) {
-                data->queueFamilyIndex++;
+        uint32_t queuesNeeded(uint32_t role, uint32_t family) const
+        {
+            return role == Present && chosen[Graphics] == family ? 0 : 1;
+        }
 
-                tryIndices(indices, findData);
+        uint32_t left(uint32_t family) const
+        {
+            return std::min(table[family].queueCount - used[family], maxLeft);
+        }
 
-                if(indices.isComplete()) 
-                    return;
-                else 
-                    data->queueFamilyIndex--;
+        void use(uint32_t family, uint32_t queues)
+        {
+            groupLeft[groups[family]][left(family)]--;
+            used[family] += queues;
+            groupLeft[groups[family]][left(family)]++;
+        }
 
-            }
+        void release(uint32_t family, uint32_t queues)
+        {
+            groupLeft[groups[family]][left(family)]--;
+            used[family] -= queues;
+            groupLeft[groups[family]][left(family)]++;
         }
 
-        
-    };
+        std::vector<uint32_t> stateKey(uint32_t role) const
+        {
+            bool sharesPresent = role > Graphics && (servedRoles[chosen[Graphics]] & (1u << Present));
+            std::vector<uint32_t> key = {role, sharesPresent ? 1u : 0u};
 
-    uint32_t countEqual(QueueFamilyIndex a, std::vector<QueueFamilyIndex> b)
-    {
-        return (uint32_t)std::count_if(b.begin(), b.end(), [&](QueueFamilyIndex c)
-                             { return a.family == c.family; });
-    };
+            // Groups none of the roles left can use don't matter
+            uint32_t rolesLeft = RoleCount - role;
+            uint32_t rolesLeftMask = ((1u << RoleCount) - 1) & ~((1u << role) - 1);
+            for (uint32_t group = 0; group < groupRoles.size(); group++)
+            {
+                if (!(groupRoles[group] & rolesLeftMask))
+                    continue;
 
+                uint32_t enough = 0;
+                for (uint32_t queues = 0; queues <= maxLeft; queues++)
+                {
+                    if (queues < rolesLeft)
+                        key.push_back(groupLeft[group][queues]);
+                    else
+                        enough += groupLeft[group][queues];
+                }
+                key.push_back(enough);
+            }
 
-    void tryIndices(QueueFamilyIndices& indices, std::vector<QueueFamilyFindData*>& findData)
-    {
-        if (indices.isComplete()) {
-            return;
+            return key;
         }
 
-        for (auto data : findData)
+        bool solve(uint32_t role)
         {
-            if( data->output.has_value() ) {
-                continue;
-            }
+            if (role == RoleCount)
+                return true;
 
-            if (data->queueFamilyOptions().size() == 0)
+            std::vector<uint32_t> key = stateKey(role);
+            if (failed.count(key))
             {
-                return;
+                stats.memoHits++;
+                return false;
             }
 
-            auto count = countEqual(data->getQueueFamily(), data->getIncrementIfSame());
-
-            if(data->getQueueFamily().queueCount > count) {
-                
-                uint32_t queueIndex = 0;
-                for(auto noIncrement : data->noIncrementIfSame) {
-                    if(!noIncrement->output.has_value() && noIncrement->getFamily() == data->getFamily()) {
-                        noIncrement->output = QueueFamilyIndex {
-                            data->getFamily(),
-                            data->getQueueFamily().queueCount, 
-                            queueIndex                        
-                        };
-                    }
-                }
+            auto tryFamily = [&](uint32_t family)
+            {
+                stats.visited++;
 
-                data->output = QueueFamilyIndex {
-                    data->getFamily(),
-                    data->getQueueFamily().queueCount, 
-                    queueIndex++                        
-                };
-
-                for(auto increment : data->incrementIfSame) {
-                    if(!increment->output.has_value() && increment->getFamily() == data->getFamily()) {
-                        increment->output = QueueFamilyIndex {
-                            data->getFamily(),
-                            data->getQueueFamily().queueCount, 
-                            queueIndex++                        
-                        };
-                    }
-                }
+                uint32_t needed = queuesNeeded(role, family);
+                if (used[family] + needed > table[family].queueCount)
+                    return false;
 
-            }
-            else {
-                tryIncrement( indices, findData );
+                use(family, needed);
+                chosen[role] = family;
 
+                if (solve(role + 1))
+                    return true;
 
-            }        
-        }
+                release(family, needed);
+                return false;
+            };
 
-    }
+            // Presenting from the graphics queue needs no second queue and no ownership transfers
+            bool presentWithGraphics = role == Present && (servedRoles[chosen[Graphics]] & (1u << Present));
+            if (presentWithGraphics && tryFamily(chosen[Graphics]))
+                return true;
 
-    QueueFamilyIndices findQueueFamilies(
-        VkPhysicalDevice device,
-        VkSurfaceKHR surface)
-    {
-        QueueFamilyIndices indices;
+            // Another family of a group with as many queues left as one that failed here leaves
+            // the same state behind
+            uint32_t rolesLeft = RoleCount - role;
+            std::vector<bool> tried(groupRoles.size() * (maxLeft + 1), false);
 
-        uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+            for (uint32_t family : candidates[role])
+            {
+                if (presentWithGraphics && family == chosen[Graphics])
+                    continue;
 
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+                size_t equivalent = groups[family] * (maxLeft + 1) + std::min(left(family), rolesLeft);
+                if (tried[equivalent])
+                    continue;
+                tried[equivalent] = true;
 
+                if (tryFamily(family))
+                    return true;
+            }
 
-        auto checkPresentSupport = [&](uint32_t i)
-        {
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-            return presentSupport;
-        };
-
-        std::vector<QueueFamilyFindData*> findData = {};
-
-        QueueFamilyFindData graphicsFamily = {
-            "Graphics",
-            findQueueFamily(
-                queueFamilies,
-                [](VkQueueFamilyProperties queueFamily, uint32_t index)
-                {
-                    (void)index;
-                    return queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
-                },
-                [&](VkQueueFamilyProperties queueFamily, uint32_t index)
-                {
-                    (void)index;
-                    return queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
-                }),
-            indices.graphicsFamily
-        }; 
-
-        QueueFamilyFindData computeFamily = {
-            "Compute",
-            findQueueFamily(
-                queueFamilies,
-                [](VkQueueFamilyProperties queueFamily, uint32_t index)
-                {
-                    (void)index;
-                    return queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
-                },
-                [&](VkQueueFamilyProperties queueFamily, uint32_t index)
-                {
-                    return queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT || queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT ||  checkPresentSupport(index);
-                    ;
-                }),
-            indices.computeFamily
-        };
-
-        QueueFamilyFindData transferFamily = {
-            "Transfer",
-            findQueueFamily(
-                queueFamilies,
-                [](VkQueueFamilyProperties queueFamily, uint32_t)
-                {
-                    return queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
-                },
-                [&](VkQueueFamilyProperties queueFamily, uint32_t index)
-                {
-                    return queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT || queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT || checkPresentSupport(index);
-                    ;
-                }),
-            indices.transferFamily
-        };
-
-        QueueFamilyFindData presentFamily = {
-            "Present",
-            findQueueFamily(
-                queueFamilies,
-                [&](VkQueueFamilyProperties, uint32_t index)
-                {
-                    return checkPresentSupport(index);
-                },
-                [&](VkQueueFamilyProperties queueFamily, uint32_t)
-                {
-                    return queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT || queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
-                }),
-            indices.presentFamily
-        };
+            failed.insert(key);
+            return false;
+        }
+    };
+
+} // namespace Impl
 
-        graphicsFamily.incrementIfSame = {&computeFamily, &transferFamily};
-        graphicsFamily.noIncrementIfSame = {&presentFamily};
+std::vector<QueueFamilyInfo> queryQueueFamilyTable(
+    const DeviceProfile &profile,
+    VkSurfaceKHR surface)
+{
+    std::vector<QueueFamilyInfo> table(profile.queueFamilies.size());
+    for (uint32_t i = 0; i < table.size(); i++)
+    {
+        VkBool32 presentSupport = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(profile.physicalDevice, i, surface, &presentSupport);
 
-        computeFamily.incrementIfSame = {&graphicsFamily, &transferFamily, &presentFamily};
-        
-        transferFamily.incrementIfSame = {&graphicsFamily, &computeFamily, &presentFamily};
+        table[i].queueFlags = profile.queueFamilies[i].queueFlags;
+        table[i].queueCount = profile.queueFamilies[i].queueCount;
+        table[i].presentSupport = presentSupport == VK_TRUE;
+    }
 
-        presentFamily.incrementIfSame = {&computeFamily, &transferFamily};
-        presentFamily.noIncrementIfSame = {&graphicsFamily};
+    return table;
+}
 
-        findData = {&graphicsFamily, &computeFamily, &transferFamily, &presentFamily};
+QueueFamilyIndices solveQueueFamilies(
+    const std::vector<QueueFamilyInfo> &table,
+    QueueFamilySolveStats *stats)
+{
+    using namespace __QueueFamilies_Impl;
 
+    QueueFamilySolveStats localStats = {};
+    Solver solver(table, stats ? *stats : localStats);
 
-        tryIndices(indices, findData);
-        
+    QueueFamilyIndices indices;
+    if (!solver.hasCandidates() || !solver.solve(Graphics))
         return indices;
+
+    // Queues of a family are handed out in role order, present reuses the graphics queue
+    std::map<uint32_t, uint32_t> nextQueue;
+    std::array<QueueFamilyIndex, RoleCount> assigned = {};
+    for (uint32_t role = 0; role < RoleCount; role++)
+    {
+        uint32_t family = solver.chosen[role];
+        uint32_t queueIndex = solver.queuesNeeded(role, family) ? nextQueue[family]++ : assigned[Graphics].queueIndex;
+        assigned[role] = QueueFamilyIndex{family, table[family].queueCount, queueIndex};
     }
 
+    indices.graphicsFamily = assigned[Graphics];
+    indices.computeFamily = assigned[Compute];
+    indices.transferFamily = assigned[Transfer];
+    indices.presentFamily = assigned[Present];
+    return indices;
 }
 
 QueueFamilyIndices findQueueFamilies(
-    VkPhysicalDevice device,
+    const DeviceProfile &profile,
     VkSurfaceKHR surface)
 {
-    return __QueueFamilies_Impl::findQueueFamilies(device, surface);
-}
\ No newline at end of file
+    static std::map<std::pair<VkPhysicalDevice, VkSurfaceKHR>, QueueFamilyIndices> solved;
+
+    auto key = std::make_pair(profile.physicalDevice, surface);
+    auto found = solved.find(key);
+    if (found != solved.end())
+        return found->second;
+
+    QueueFamilyIndices indices = solveQueueFamilies(queryQueueFamilyTable(profile, surface));
+    solved.emplace(key, indices);
+    return indices;
+}
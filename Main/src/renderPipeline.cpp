@@ -2,6 +2,9 @@
 
 ShaderInfo RenderPipeline::getVertexShader()
 {
+    if (vertexInputMode == VertexInputMode::Pulling)
+        return ShaderInfo{"shaders/simple_pull.vert.spv", "main"};
+
     return ShaderInfo{"shaders/simple.vert.spv", "main"};
 }
 
@@ -10,12 +13,19 @@ ShaderInfo RenderPipeline::getFragmentShader()
     return ShaderInfo{"shaders/simple.frag.spv", "main"};
 }
 
-std::vector<VkVertexInputBindingDescription> RenderPipeline::getBindingDescription()
+VkPipelineDepthStencilStateCreateInfo RenderPipeline::getDepthStencilInfo()
 {
-    return {Vertex::getBindingDescription()};
+    VkPipelineDepthStencilStateCreateInfo depthStencil = GraphicsPipeline::getDepthStencilInfo();
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    return depthStencil;
 }
 
-std::vector<VkVertexInputAttributeDescription> RenderPipeline::getAttributeDescriptions()
+VertexInputDescription RenderPipeline::getVertexInput()
 {
-    return Vertex::getAttributeDescriptions();
+    if (vertexInputMode == VertexInputMode::Pulling)
+        return {};
+
+    return VertexInputDescription::of<VertexDescription>();
 }
@@ -0,0 +1,315 @@
+#include "renderTargetPool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    // Every stage a render target is written or read in
+    constexpr VkPipelineStageFlags targetStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                                  VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    constexpr VkAccessFlags targetWrites = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+}
+
+void RenderTargetPool::init(const RenderTargetPoolCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    allocator = createInfo.allocator;
+    pool = createInfo.pool;
+    mipGenerator = createInfo.mipGenerator;
+}
+
+void RenderTargetPool::cleanup()
+{
+    clear();
+}
+
+void RenderTargetPool::update(uint64_t _frameNumber, uint32_t framesInFlight)
+{
+    frameNumber = _frameNumber;
+
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if ((*it)->lastFrame + framesInFlight <= frameNumber)
+        {
+            destroyEntry(**it);
+            it = entries.erase(it);
+        }
+        else
+        {
+            (*it)->acquired = false;
+            ++it;
+        }
+    }
+
+    for (auto &memory : memories)
+        memory->held = false;
+}
+
+const RenderTarget &RenderTargetPool::acquire(VkCommandBuffer commandBuffer, const RenderTargetDesc &desc)
+{
+    Entry *entry = nullptr;
+    for (auto &candidate : entries)
+    {
+        if (!candidate->acquired && !candidate->memory->held && candidate->target.desc == desc)
+        {
+            entry = candidate.get();
+            break;
+        }
+    }
+
+    if (!entry)
+        entry = &createEntry(desc);
+
+    entry->acquired = true;
+    entry->lastFrame = frameNumber;
+
+    Memory &memory = *entry->memory;
+    memory.held = true;
+
+    // Whichever target had the memory before, earlier in this frame or in a frame still in
+    // flight, is done with it before the new one is written. The contents are discarded,
+    // only the old writes have to land first.
+    if (memory.used)
+    {
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = targetWrites;
+        barrier.dstAccessMask = targetWrites | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, targetStages, targetStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    memory.used = true;
+
+    acquires++;
+    return entry->target;
+}
+
+void RenderTargetPool::release(const RenderTarget &target)
+{
+    for (auto &entry : entries)
+    {
+        if (&entry->target == &target)
+        {
+            entry->acquired = false;
+            entry->memory->held = false;
+            return;
+        }
+    }
+}
+
+VkFramebuffer RenderTargetPool::getFramebuffer(VkRenderPass renderPass, const std::vector<const RenderTarget *> &attachments)
+{
+    std::vector<VkImageView> views;
+    for (const RenderTarget *attachment : attachments)
+        views.push_back(attachment->attachmentView);
+
+    for (const auto &cached : framebuffers)
+        if (cached.renderPass == renderPass && cached.views == views)
+            return cached.framebuffer;
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = attachments[0]->desc.extent.width;
+    framebufferInfo.height = attachments[0]->desc.extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create framebuffer!");
+    }
+
+    framebuffers.push_back({renderPass, views, framebuffer});
+    return framebuffer;
+}
+
+void RenderTargetPool::clear()
+{
+    for (auto &entry : entries)
+        destroyEntry(*entry);
+    entries.clear();
+}
+
+void RenderTargetPool::printStatistics() const
+{
+    VkDeviceSize bytes = 0;
+    size_t lazyCount = 0;
+    for (const auto &memory : memories)
+    {
+        bytes += memory->size;
+        lazyCount += memory->lazy;
+    }
+
+    std::cerr << "Render target pool: " << entries.size() << " targets in " << memories.size() << " allocations (" << lazyCount << " lazily allocated), "
+              << bytes / (1024 * 1024) << " MB, peak " << peakBytes / (1024 * 1024) << " MB, " << acquires << " acquires, "
+              << imagesCreated << " images created, " << aliasedImages << " aliased, " << lazyAllocations << " lazy allocations" << std::endl;
+}
+
+RenderTargetPool::Entry &RenderTargetPool::createEntry(const RenderTargetDesc &desc)
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = desc.extent.width;
+    imageInfo.extent.height = desc.extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = desc.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = desc.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = desc.usage | (desc.transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.flags = desc.flags;
+
+    auto entry = std::make_unique<Entry>();
+    entry->target.desc = desc;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &entry->target.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create render target image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, entry->target.image, &requirements);
+
+    entry->memory = findMemory(requirements, desc.transient);
+    if (entry->memory)
+        aliasedImages++;
+    else
+        entry->memory = allocateMemory(requirements, desc.transient);
+
+    if (vmaBindImageMemory(allocator, entry->memory->allocation, entry->target.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to bind render target memory!");
+    }
+    entry->memory->targetCount++;
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = entry->target.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = desc.format;
+    viewInfo.subresourceRange.aspectMask = desc.aspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &entry->target.attachmentView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create render target image view!");
+    }
+
+    viewInfo.subresourceRange.levelCount = desc.mipLevels;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &entry->target.imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create render target image view!");
+    }
+
+    imagesCreated++;
+    entries.push_back(std::move(entry));
+    return *entries.back();
+}
+
+RenderTargetPool::Memory *RenderTargetPool::findMemory(const VkMemoryRequirements &requirements, bool transient) const
+{
+    // Smallest free allocation the image fits in, lazily allocated memory only for transient targets
+    Memory *best = nullptr;
+    for (const auto &memory : memories)
+    {
+        if (memory->held || (memory->lazy && !transient) || memory->size < requirements.size || memory->offset % requirements.alignment != 0 ||
+            (requirements.memoryTypeBits & (1u << memory->memoryType)) == 0)
+            continue;
+
+        if (!best || memory->size < best->size)
+            best = memory.get();
+    }
+
+    return best;
+}
+
+RenderTargetPool::Memory *RenderTargetPool::allocateMemory(const VkMemoryRequirements &requirements, bool transient)
+{
+    auto memory = std::make_unique<Memory>();
+
+    // Allocated from the requirements alone, nothing ties the memory to the first image bound to it
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+    if (transient)
+    {
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        memory->lazy = vmaAllocateMemory(allocator, &requirements, &allocInfo, &memory->allocation, nullptr) == VK_SUCCESS;
+    }
+
+    if (!memory->lazy)
+    {
+        // The pool's memory type was picked for color targets, other formats may need another one
+        allocInfo.requiredFlags = 0;
+        allocInfo.pool = pool;
+        if (pool == VK_NULL_HANDLE || vmaAllocateMemory(allocator, &requirements, &allocInfo, &memory->allocation, nullptr) != VK_SUCCESS)
+        {
+            allocInfo.pool = VK_NULL_HANDLE;
+            allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            if (vmaAllocateMemory(allocator, &requirements, &allocInfo, &memory->allocation, nullptr) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate render target memory!");
+            }
+        }
+    }
+
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator, memory->allocation, &info);
+    memory->size = info.size;
+    memory->offset = info.offset;
+    memory->memoryType = info.memoryType;
+
+    lazyAllocations += memory->lazy;
+
+    VkDeviceSize bytes = 0;
+    for (const auto &other : memories)
+        bytes += other->size;
+    peakBytes = std::max(peakBytes, bytes + memory->size);
+
+    memories.push_back(std::move(memory));
+    return memories.back().get();
+}
+
+void RenderTargetPool::destroyEntry(Entry &entry)
+{
+    if (mipGenerator)
+        mipGenerator->forget(entry.target.image);
+
+    for (auto it = framebuffers.begin(); it != framebuffers.end();)
+    {
+        if (std::find(it->views.begin(), it->views.end(), entry.target.attachmentView) != it->views.end())
+        {
+            vkDestroyFramebuffer(device, it->framebuffer, nullptr);
+            it = framebuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    vkDestroyImageView(device, entry.target.attachmentView, nullptr);
+    vkDestroyImageView(device, entry.target.imageView, nullptr);
+    vkDestroyImage(device, entry.target.image, nullptr);
+
+    if (--entry.memory->targetCount > 0)
+        return;
+
+    vmaFreeMemory(allocator, entry.memory->allocation);
+    memories.erase(std::find_if(memories.begin(), memories.end(), [&](const auto &memory) { return memory.get() == entry.memory; }));
+}
@@ -0,0 +1,93 @@
+#include "resolutionController.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void ResolutionController::init(const ResolutionControllerCreateInfo &createInfo)
+{
+    info = createInfo;
+    scale = info.maxScale;
+    lowestScale = scale;
+}
+
+void ResolutionController::setOutputExtent(VkExtent2D extent)
+{
+    outputExtent = extent;
+    targetExtent = {0, 0};
+    resize();
+}
+
+void ResolutionController::update(double gpuMilliseconds)
+{
+    if (gpuMilliseconds <= 0.0)
+        return;
+
+    frames++;
+    if (gpuMilliseconds > info.targetMilliseconds)
+        framesOverBudget++;
+
+    // Frames still in flight when the scale changed were drawn at the old one
+    if (++framesSinceChange <= info.settleFrames)
+    {
+        averageMilliseconds = gpuMilliseconds;
+        return;
+    }
+
+    averageMilliseconds += (gpuMilliseconds - averageMilliseconds) * 0.2;
+
+    // Aims below the budget so single slow frames don't go over it, and only reacts outside
+    // a band around the aim so the scale doesn't wander with noise
+    double aim = info.targetMilliseconds * 0.85;
+    float wanted = scale * static_cast<float>(std::sqrt(aim / averageMilliseconds));
+
+    if (averageMilliseconds > info.targetMilliseconds * 0.95)
+        wanted = std::max(wanted, scale * 0.8f);
+    else if (averageMilliseconds < info.targetMilliseconds * 0.7)
+        wanted = std::min(wanted, scale * 1.05f);
+    else
+        return;
+
+    wanted = std::clamp(wanted, info.minScale, info.maxScale);
+    if (std::abs(wanted - scale) < 0.01f)
+        return;
+
+    scale = wanted;
+    lowestScale = std::min(lowestScale, scale);
+    framesSinceChange = 0;
+    scaleChanges++;
+
+    resize();
+}
+
+void ResolutionController::printStatistics() const
+{
+    std::cerr << "Resolution controller: scale " << scale << " (lowest " << lowestScale << "), " << renderExtent.width << "x" << renderExtent.height
+              << " drawn in a " << targetExtent.width << "x" << targetExtent.height << " target for " << outputExtent.width << "x" << outputExtent.height
+              << ", " << framesOverBudget << " of " << frames << " frames over " << info.targetMilliseconds << " ms, " << scaleChanges << " scale changes, "
+              << targetResizes << " target resizes" << std::endl;
+}
+
+VkExtent2D ResolutionController::scaleExtent(float _scale) const
+{
+    // Multiples of 8 pixels keep the extent on whole tiles of most GPUs
+    auto scaleAxis = [&](uint32_t size) {
+        uint32_t scaled = static_cast<uint32_t>(std::ceil(size * _scale / 8.0f)) * 8;
+        return std::clamp(scaled, std::min(size, 8u), size);
+    };
+
+    return {scaleAxis(outputExtent.width), scaleAxis(outputExtent.height)};
+}
+
+void ResolutionController::resize()
+{
+    renderExtent = scaleExtent(scale);
+
+    bool outgrown = renderExtent.width > targetExtent.width || renderExtent.height > targetExtent.height;
+    bool shrunk = uint64_t(renderExtent.width) * renderExtent.height * 2 < uint64_t(targetExtent.width) * targetExtent.height;
+    if (!outgrown && !shrunk)
+        return;
+
+    // Some room above the scale, climbing back doesn't reallocate right away
+    targetExtent = scaleExtent(std::min(scale * 1.15f, info.maxScale));
+    targetResizes++;
+}
@@ -0,0 +1,94 @@
+#include "samplerCache.hpp"
+#include "hash.hpp"
+#include <stdexcept>
+
+namespace
+{
+    // Field by field, the struct has padding that memcmp would trip over
+    bool equal(const VkSamplerCreateInfo &a, const VkSamplerCreateInfo &b)
+    {
+        return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter &&
+               a.mipmapMode == b.mipmapMode && a.addressModeU == b.addressModeU &&
+               a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW &&
+               a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable &&
+               a.maxAnisotropy == b.maxAnisotropy && a.compareEnable == b.compareEnable &&
+               a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod &&
+               a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+    }
+
+    uint64_t hash(const VkSamplerCreateInfo &info)
+    {
+        uint64_t result = Hash::offsetBasis;
+        auto add = [&](const auto &field) { result = Hash::fnv1a(&field, sizeof(field), result); };
+
+        add(info.flags);
+        add(info.magFilter);
+        add(info.minFilter);
+        add(info.mipmapMode);
+        add(info.addressModeU);
+        add(info.addressModeV);
+        add(info.addressModeW);
+        add(info.mipLodBias);
+        add(info.anisotropyEnable);
+        add(info.maxAnisotropy);
+        add(info.compareEnable);
+        add(info.compareOp);
+        add(info.minLod);
+        add(info.maxLod);
+        add(info.borderColor);
+        add(info.unnormalizedCoordinates);
+        return result;
+    }
+}
+
+void SamplerCache::init(VkDevice _device)
+{
+    device = _device;
+}
+
+void SamplerCache::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &[key, entry] : samplers)
+        vkDestroySampler(device, entry.second, nullptr);
+
+    samplers.clear();
+}
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo &createInfo)
+{
+    if (createInfo.pNext != nullptr)
+    {
+        throw std::runtime_error("failed to create texture sampler, pNext chains can't be cached!");
+    }
+
+    uint64_t key = hash(createInfo);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = samplers.find(key);
+    if (it != samplers.end())
+    {
+        if (!equal(it->second.first, createInfo))
+        {
+            throw std::runtime_error("failed to create texture sampler, cache key collision!");
+        }
+        return it->second.second;
+    }
+
+    VkSampler sampler;
+    if (vkCreateSampler(device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+
+    samplers.emplace(key, std::make_pair(createInfo, sampler));
+    return sampler;
+}
+
+size_t SamplerCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return samplers.size();
+}
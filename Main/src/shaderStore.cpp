@@ -0,0 +1,199 @@
+#include "shaderStore.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef EMBED_SHADERS
+namespace
+{
+    struct EmbeddedShader
+    {
+        const char *path;
+        const uint32_t *code;
+        size_t size;
+    };
+
+    // Generated by premake5.lua from the glslc -mfmt=c output, defines embeddedShaders[]
+#include "embeddedShaderList.inc"
+
+    const EmbeddedShader *findEmbeddedShader(const std::string &path)
+    {
+        for (const auto &shader : embeddedShaders)
+        {
+            if (path == shader.path)
+                return &shader;
+        }
+        return nullptr;
+    }
+}
+#endif
+
+void ShaderStore::init(VkDevice _device, const AssetArchive *_archive)
+{
+    device = _device;
+    archive = _archive;
+}
+
+void ShaderStore::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto &[hash, module] : modules)
+    {
+        std::cerr << "Shader module " << hash << " leaked with " << module.references << " references" << std::endl;
+        vkDestroyShaderModule(device, module.module, nullptr);
+    }
+
+    modules.clear();
+    paths.clear();
+    moduleHashes.clear();
+}
+
+VkShaderModule ShaderStore::acquire(const std::string &path, bool reload)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        acquireCount++;
+
+        auto it = paths.find(path);
+        if (!reload && it != paths.end())
+        {
+            Module &module = modules.at(it->second);
+            module.references++;
+            return module.module;
+        }
+    }
+
+#ifdef EMBED_SHADERS
+    if (const EmbeddedShader *shader = findEmbeddedShader(path))
+        return acquireCode(path, shader->code, shader->size);
+#endif
+
+    // Reloads are for shaders changed on disk, the archived copy is stale by then
+    size_t archivedSize;
+    const void *archived = archive && !reload ? archive->find(path, AssetType::Shader, archivedSize) : nullptr;
+    if (archived)
+        return acquireCode(path, archived, archivedSize);
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        throw std::runtime_error("failed to open shader file!");
+    }
+
+    return acquireCode(path, file.data(), file.size());
+}
+
+VkShaderModule ShaderStore::acquireCode(const std::string &path, const void *code, size_t size)
+{
+    if (size == 0 || size % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("failed to load shader, invalid SPIR-V size!");
+    }
+
+    uint64_t hash = Hash::fnv1a(code, size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    filesRead++;
+
+    auto it = modules.find(hash);
+    if (it != modules.end())
+    {
+        const std::vector<uint32_t> &resident = it->second.code;
+        if (resident.size() * sizeof(uint32_t) != size || std::memcmp(resident.data(), code, size) != 0)
+        {
+            throw std::runtime_error("failed to load shader, module hash collision!");
+        }
+
+        it->second.references++;
+        paths[path] = hash;
+        return it->second.module;
+    }
+
+    ShaderReflection reflection = SpirvReflect::reflect(static_cast<const uint32_t *>(code), size / sizeof(uint32_t));
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = static_cast<const uint32_t *>(code);
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    const uint32_t *words = static_cast<const uint32_t *>(code);
+    std::vector<uint32_t> copy(words, words + size / sizeof(uint32_t));
+
+    modulesCreated++;
+    modules.emplace(hash, Module{shaderModule, 1, std::move(reflection), std::move(copy)});
+    moduleHashes.emplace(shaderModule, hash);
+    paths[path] = hash;
+
+    return shaderModule;
+}
+
+void ShaderStore::retain(VkShaderModule shaderModule)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto hashIt = moduleHashes.find(shaderModule);
+    if (hashIt == moduleHashes.end())
+    {
+        throw std::runtime_error("failed to retain shader module, not owned by the store!");
+    }
+
+    modules.at(hashIt->second).references++;
+}
+
+void ShaderStore::release(VkShaderModule shaderModule)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto hashIt = moduleHashes.find(shaderModule);
+    if (hashIt == moduleHashes.end())
+    {
+        throw std::runtime_error("failed to release shader module, not owned by the store!");
+    }
+
+    uint64_t hash = hashIt->second;
+    Module &module = modules.at(hash);
+    if (--module.references > 0)
+        return;
+
+    vkDestroyShaderModule(device, module.module, nullptr);
+    modules.erase(hash);
+    moduleHashes.erase(hashIt);
+
+    for (auto it = paths.begin(); it != paths.end();)
+    {
+        if (it->second == hash)
+            it = paths.erase(it);
+        else
+            ++it;
+    }
+}
+
+ShaderReflection ShaderStore::getReflection(VkShaderModule shaderModule) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto hashIt = moduleHashes.find(shaderModule);
+    if (hashIt == moduleHashes.end())
+    {
+        throw std::runtime_error("failed to reflect shader module, not owned by the store!");
+    }
+
+    return modules.at(hashIt->second).reflection;
+}
+
+void ShaderStore::printStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::cerr << "Shader store: " << acquireCount << " acquires, " << filesRead << " files read, "
+              << modulesCreated << " modules created, " << modules.size() << " resident" << std::endl;
+}
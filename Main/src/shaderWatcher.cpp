@@ -0,0 +1,118 @@
+#include "shaderWatcher.hpp"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+#ifdef __linux__
+
+void ShaderWatcher::init(const std::string &_directory)
+{
+    directory = _directory;
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        std::cerr << "Shader hot reload disabled, inotify_init1 failed" << std::endl;
+        return;
+    }
+
+    // glslc writes the output in place, tools writing a temporary and renaming show up as IN_MOVED_TO
+    watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0)
+    {
+        std::cerr << "Shader hot reload disabled, can't watch " << directory << std::endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+}
+
+void ShaderWatcher::cleanup()
+{
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+
+    inotifyFd = -1;
+    watchDescriptor = -1;
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    std::vector<std::string> changed;
+    if (inotifyFd < 0)
+        return changed;
+
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (char *event = buffer; event < buffer + length;)
+        {
+            const inotify_event *info = reinterpret_cast<const inotify_event *>(event);
+            if (info->len > 0)
+                changed.push_back(directory + "/" + info->name);
+            event += sizeof(inotify_event) + info->len;
+        }
+    }
+
+    // A build touches the same file more than once
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+#else
+
+void ShaderWatcher::init(const std::string &_directory)
+{
+    directory = _directory;
+    poll();
+}
+
+void ShaderWatcher::cleanup()
+{
+    modificationTimes.clear();
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    std::vector<std::string> changed;
+
+    // Scanning the directory every frame is wasted work, twice a second is plenty
+    auto now = std::chrono::steady_clock::now();
+    if (!modificationTimes.empty() && now - lastScan < std::chrono::milliseconds(500))
+        return changed;
+    lastScan = now;
+
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file(error))
+            continue;
+
+        std::string path = directory + "/" + entry.path().filename().string();
+        auto time = entry.last_write_time(error).time_since_epoch();
+
+        auto it = modificationTimes.find(path);
+        if (it == modificationTimes.end())
+            modificationTimes.emplace(path, time);
+        else if (it->second != time)
+        {
+            it->second = time;
+            changed.push_back(path);
+        }
+    }
+
+    return changed;
+}
+
+#endif
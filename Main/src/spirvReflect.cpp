@@ -0,0 +1,441 @@
+#include "spirvReflect.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t spirvMagic = 0x07230203;
+
+    enum Op : uint32_t
+    {
+        OpEntryPoint = 15,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+    };
+
+    enum Decoration : uint32_t
+    {
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBuiltIn = 11,
+        DecorationLocation = 30,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35,
+    };
+
+    enum StorageClass : uint32_t
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassInput = 1,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12,
+    };
+
+    enum Dim : uint32_t
+    {
+        DimBuffer = 5,
+        DimSubpassData = 6,
+    };
+
+    constexpr uint32_t unset = ~0u;
+
+    struct Id
+    {
+        const uint32_t *words = nullptr; // the defining instruction, opcode word included
+        uint32_t set = unset;
+        uint32_t binding = unset;
+        uint32_t location = unset;
+        uint32_t arrayStride = 0;
+        bool builtIn = false;
+        bool block = false;
+        bool bufferBlock = false;
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+
+        uint32_t opcode() const { return words ? (words[0] & 0xFFFF) : 0; }
+    };
+
+    struct Module
+    {
+        std::vector<Id> ids;
+
+        const Id &at(uint32_t id) const
+        {
+            if (id >= ids.size() || ids[id].words == nullptr)
+                throw std::runtime_error("failed to reflect shader, undefined id!");
+            return ids[id];
+        }
+
+        uint32_t constant(uint32_t id) const
+        {
+            const Id &value = at(id);
+            if (value.opcode() != OpConstant)
+                throw std::runtime_error("failed to reflect shader, array length is not a constant!");
+            return value.words[3];
+        }
+
+        uint32_t size(uint32_t typeId, uint32_t matrixStride = 0) const
+        {
+            const Id &type = at(typeId);
+            switch (type.opcode())
+            {
+            case OpTypeBool:
+                return 4;
+            case OpTypeInt:
+            case OpTypeFloat:
+                return type.words[2] / 8;
+            case OpTypeVector:
+                return type.words[3] * size(type.words[2]);
+            case OpTypeMatrix:
+                return type.words[3] * (matrixStride ? matrixStride : size(type.words[2]));
+            case OpTypeArray:
+            {
+                uint32_t stride = type.arrayStride ? type.arrayStride : size(type.words[2]);
+                return constant(type.words[3]) * stride;
+            }
+            case OpTypeStruct:
+            {
+                uint32_t result = 0;
+                uint32_t memberCount = (type.words[0] >> 16) - 2;
+                for (uint32_t i = 0; i < memberCount; i++)
+                {
+                    uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+                    uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+                    result = std::max(result, offset + size(type.words[2 + i], stride));
+                }
+                return result;
+            }
+            default:
+                return 0;
+            }
+        }
+    };
+
+    VkShaderStageFlagBits toStage(uint32_t executionModel)
+    {
+        switch (executionModel)
+        {
+        case 0:
+            return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1:
+            return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2:
+            return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3:
+            return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4:
+            return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5:
+            return VK_SHADER_STAGE_COMPUTE_BIT;
+        default:
+            throw std::runtime_error("failed to reflect shader, unsupported execution model!");
+        }
+    }
+
+    VkDescriptorType toDescriptorType(const Id &type, uint32_t storageClass)
+    {
+        switch (type.opcode())
+        {
+        case OpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OpTypeImage:
+        {
+            uint32_t dim = type.words[3];
+            uint32_t sampled = type.words[7];
+            if (dim == DimSubpassData)
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            if (dim == DimBuffer)
+                return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        case OpTypeStruct:
+            if (storageClass == StorageClassStorageBuffer || type.bufferBlock)
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        default:
+            throw std::runtime_error("failed to reflect shader, unsupported descriptor type!");
+        }
+    }
+
+    VkFormat toInputFormat(const Module &module, uint32_t typeId)
+    {
+        const Id *type = &module.at(typeId);
+        uint32_t componentCount = 1;
+        if (type->opcode() == OpTypeVector)
+        {
+            componentCount = type->words[3];
+            type = &module.at(type->words[2]);
+        }
+
+        if (type->words[2] != 32)
+            throw std::runtime_error("failed to reflect shader, only 32 bit vertex inputs are supported!");
+
+        static const VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        static const VkFormat intFormats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        static const VkFormat uintFormats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+        if (componentCount < 1 || componentCount > 4)
+            throw std::runtime_error("failed to reflect shader, unsupported vertex input type!");
+
+        if (type->opcode() == OpTypeFloat)
+            return floatFormats[componentCount - 1];
+        if (type->opcode() == OpTypeInt)
+            return type->words[3] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+
+        throw std::runtime_error("failed to reflect shader, unsupported vertex input type!");
+    }
+
+    enum class NumericClass
+    {
+        Float,
+        Signed,
+        Unsigned
+    };
+
+    NumericClass numericClass(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_R8_SINT:
+        case VK_FORMAT_R8G8_SINT:
+        case VK_FORMAT_R8G8B8A8_SINT:
+        case VK_FORMAT_R16_SINT:
+        case VK_FORMAT_R16G16_SINT:
+        case VK_FORMAT_R16G16B16A16_SINT:
+        case VK_FORMAT_R32_SINT:
+        case VK_FORMAT_R32G32_SINT:
+        case VK_FORMAT_R32G32B32_SINT:
+        case VK_FORMAT_R32G32B32A32_SINT:
+            return NumericClass::Signed;
+        case VK_FORMAT_R8_UINT:
+        case VK_FORMAT_R8G8_UINT:
+        case VK_FORMAT_R8G8B8A8_UINT:
+        case VK_FORMAT_R16_UINT:
+        case VK_FORMAT_R16G16_UINT:
+        case VK_FORMAT_R16G16B16A16_UINT:
+        case VK_FORMAT_R32_UINT:
+        case VK_FORMAT_R32G32_UINT:
+        case VK_FORMAT_R32G32B32_UINT:
+        case VK_FORMAT_R32G32B32A32_UINT:
+            return NumericClass::Unsigned;
+        default:
+            return NumericClass::Float;
+        }
+    }
+}
+
+namespace SpirvReflect
+{
+    ShaderReflection reflect(const uint32_t *code, size_t wordCount)
+    {
+        if (wordCount < 5 || code[0] != spirvMagic)
+        {
+            throw std::runtime_error("failed to reflect shader, not SPIR-V!");
+        }
+
+        Module module;
+        module.ids.resize(code[3]);
+
+        ShaderReflection reflection{};
+        bool hasEntryPoint = false;
+        std::vector<uint32_t> variables;
+
+        auto id = [&](uint32_t value) -> Id & {
+            if (value >= module.ids.size())
+                throw std::runtime_error("failed to reflect shader, id out of bounds!");
+            return module.ids[value];
+        };
+
+        for (size_t offset = 5; offset < wordCount;)
+        {
+            const uint32_t *words = code + offset;
+            uint32_t opcode = words[0] & 0xFFFF;
+            uint32_t length = words[0] >> 16;
+
+            if (length == 0 || offset + length > wordCount)
+            {
+                throw std::runtime_error("failed to reflect shader, truncated instruction!");
+            }
+
+            switch (opcode)
+            {
+            case OpEntryPoint:
+                // Only the first entry point is reflected, every shader here has exactly one
+                if (!hasEntryPoint)
+                {
+                    hasEntryPoint = true;
+                    reflection.stage = toStage(words[1]);
+
+                    const char *name = reinterpret_cast<const char *>(words + 3);
+                    size_t maxLength = (length - 3) * sizeof(uint32_t);
+                    reflection.entryPoint.assign(name, std::find(name, name + maxLength, '\0'));
+                }
+                break;
+
+            case OpTypeBool:
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+                id(words[1]).words = words;
+                break;
+
+            case OpConstant:
+            case OpVariable:
+                id(words[2]).words = words;
+                if (opcode == OpVariable)
+                    variables.push_back(words[2]);
+                break;
+
+            case OpDecorate:
+            {
+                Id &target = id(words[1]);
+                switch (words[2])
+                {
+                case DecorationBlock:
+                    target.block = true;
+                    break;
+                case DecorationBufferBlock:
+                    target.bufferBlock = true;
+                    break;
+                case DecorationArrayStride:
+                    target.arrayStride = words[3];
+                    break;
+                case DecorationBuiltIn:
+                    target.builtIn = true;
+                    break;
+                case DecorationLocation:
+                    target.location = words[3];
+                    break;
+                case DecorationBinding:
+                    target.binding = words[3];
+                    break;
+                case DecorationDescriptorSet:
+                    target.set = words[3];
+                    break;
+                }
+                break;
+            }
+
+            case OpMemberDecorate:
+            {
+                Id &target = id(words[1]);
+                uint32_t member = words[2];
+                if (words[3] == DecorationOffset)
+                {
+                    target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1), 0);
+                    target.memberOffsets[member] = words[4];
+                }
+                else if (words[3] == DecorationMatrixStride)
+                {
+                    target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1), 0);
+                    target.memberMatrixStrides[member] = words[4];
+                }
+                break;
+            }
+            }
+
+            offset += length;
+        }
+
+        if (!hasEntryPoint)
+        {
+            throw std::runtime_error("failed to reflect shader, no entry point!");
+        }
+
+        for (uint32_t variableId : variables)
+        {
+            const Id &variable = module.at(variableId);
+            uint32_t storageClass = variable.words[3];
+            const Id &pointer = module.at(variable.words[1]);
+            uint32_t typeId = pointer.words[3];
+
+            switch (storageClass)
+            {
+            case StorageClassUniformConstant:
+            case StorageClassUniform:
+            case StorageClassStorageBuffer:
+            {
+                if (variable.binding == unset)
+                    break;
+
+                uint32_t count = 1;
+                const Id *type = &module.at(typeId);
+                if (type->opcode() == OpTypeArray)
+                {
+                    count = module.constant(type->words[3]);
+                    type = &module.at(type->words[2]);
+                }
+                else if (type->opcode() == OpTypeRuntimeArray)
+                {
+                    count = 0;
+                    type = &module.at(type->words[2]);
+                }
+
+                ReflectedBinding binding{};
+                binding.set = variable.set == unset ? 0 : variable.set;
+                binding.binding = variable.binding;
+                binding.type = toDescriptorType(*type, storageClass);
+                binding.count = count;
+                reflection.bindings.push_back(binding);
+                break;
+            }
+
+            case StorageClassPushConstant:
+                reflection.pushConstantSize = std::max(reflection.pushConstantSize, module.size(typeId));
+                break;
+
+            case StorageClassInput:
+                // gl_VertexIndex and friends, or gl_PerVertex style blocks
+                if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn || variable.location == unset)
+                    break;
+                if (module.at(typeId).opcode() == OpTypeStruct)
+                    break;
+
+                reflection.inputs.push_back({variable.location, toInputFormat(module, typeId)});
+                break;
+            }
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding &a, const ReflectedBinding &b) {
+            return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+        });
+        std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const ReflectedInput &a, const ReflectedInput &b) {
+            return a.location < b.location;
+        });
+
+        return reflection;
+    }
+
+    bool isCompatibleVertexFormat(VkFormat shaderFormat, VkFormat attributeFormat)
+    {
+        return numericClass(shaderFormat) == numericClass(attributeFormat);
+    }
+}
@@ -0,0 +1,337 @@
+#include "textureStreamer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include <set>
+#include <stdexcept>
+
+void TextureStreamer::init(const TextureStreamerCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    allocator = createInfo.allocator;
+    jobSystem = createInfo.jobSystem;
+    uploadManager = createInfo.uploadManager;
+    samplerCache = createInfo.samplerCache;
+    bindlessHeap = createInfo.bindlessHeap;
+    mipGenerator = createInfo.mipGenerator;
+    formats = createInfo.formats;
+    queueFamilyIndices = createInfo.queueFamilyIndices;
+    uploadBudget = createInfo.uploadBudget;
+}
+
+void TextureStreamer::cleanup()
+{
+    // Decode jobs still hold a pointer to the streamer
+    jobSystem->wait();
+
+    for (auto &entry : retired)
+        vkDestroyImageView(device, entry.imageView, nullptr);
+    retired.clear();
+
+    for (auto &texture : textures)
+    {
+        if (texture->view.imageView != VK_NULL_HANDLE)
+            vkDestroyImageView(device, texture->view.imageView, nullptr);
+
+        if (texture->image != VK_NULL_HANDLE)
+        {
+            if (mipGenerator)
+                mipGenerator->forget(texture->image);
+            vmaDestroyImage(allocator, texture->image, texture->allocation);
+        }
+    }
+    textures.clear();
+}
+
+TextureHandle TextureStreamer::load(const std::string &path)
+{
+    TextureHandle handle = static_cast<TextureHandle>(textures.size());
+
+    auto texture = std::make_unique<Texture>();
+    texture->path = path;
+    textures.push_back(std::move(texture));
+
+    bool cpuMips = mipGenerator == nullptr;
+    jobSystem->submit([this, handle, path, cpuMips]() {
+        try
+        {
+            TextureData data = TextureTranscoder::load(path, formats, cpuMips);
+
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            decoded.emplace_back(handle, std::move(data));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            failed.push_back(handle);
+        }
+    });
+
+    return handle;
+}
+
+void TextureStreamer::setScreenSize(TextureHandle handle, float pixels)
+{
+    textures.at(handle)->screenSize = pixels;
+}
+
+void TextureStreamer::update(uint64_t _frameNumber, uint32_t framesInFlight)
+{
+    frameNumber = _frameNumber;
+
+    std::vector<std::pair<TextureHandle, TextureData>> newlyDecoded;
+    std::vector<TextureHandle> newlyFailed;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        newlyDecoded.swap(decoded);
+        newlyFailed.swap(failed);
+    }
+
+    for (auto &[handle, data] : newlyDecoded)
+    {
+        Texture &texture = *textures[handle];
+        texture.data = std::move(data);
+        createImage(texture);
+        texture.residentMip = texture.data.getMipCount();
+        texture.state = State::Streaming;
+    }
+
+    for (TextureHandle handle : newlyFailed)
+        textures[handle]->state = State::Failed;
+
+    // Views replaced by one with more levels, once no frame in flight can sample them
+    auto done = std::stable_partition(retired.begin(), retired.end(), [&](const Retired &entry) {
+        return frameNumber < entry.frameNumber + framesInFlight;
+    });
+    for (auto it = done; it != retired.end(); ++it)
+        vkDestroyImageView(device, it->imageView, nullptr);
+    retired.erase(done, retired.end());
+
+    // Textures with nothing resident come first, then the ones most magnified on screen
+    std::priority_queue<std::pair<float, TextureHandle>> candidates;
+    for (TextureHandle handle = 0; handle < textures.size(); handle++)
+    {
+        const Texture &texture = *textures[handle];
+        if (texture.state != State::Streaming || texture.uploading || texture.residentMip <= getDesiredMip(texture))
+            continue;
+
+        float priority = HUGE_VALF;
+        if (texture.residentMip < texture.data.getMipCount())
+        {
+            float residentSize = static_cast<float>(std::max(texture.data.getMipWidth(texture.residentMip), texture.data.getMipHeight(texture.residentMip)));
+            float screenSize = texture.screenSize < 0.0f ? static_cast<float>(std::max(texture.data.width, texture.data.height)) : texture.screenSize;
+            priority = screenSize / residentSize;
+        }
+
+        candidates.emplace(priority, handle);
+    }
+
+    // One band per texture and update, the last one may go over the budget by up to a band
+    VkDeviceSize staged = 0;
+    while (!candidates.empty() && staged < uploadBudget)
+    {
+        TextureHandle handle = candidates.top().second;
+        candidates.pop();
+
+        VkDeviceSize size = streamNextBand(handle);
+        if (size == 0)
+            break;
+
+        staged += size;
+    }
+}
+
+TextureStreamer::View TextureStreamer::get(TextureHandle handle) const
+{
+    return textures.at(handle)->view;
+}
+
+void TextureStreamer::printStatistics() const
+{
+    size_t counts[4] = {};
+    for (const auto &texture : textures)
+        counts[static_cast<size_t>(texture->state)]++;
+
+    std::cerr << "Texture streamer: " << textures.size() << " textures (" << counts[static_cast<size_t>(State::Resident)] << " resident, "
+              << counts[static_cast<size_t>(State::Streaming)] << " streaming, " << counts[static_cast<size_t>(State::Decoding)] << " decoding, "
+              << counts[static_cast<size_t>(State::Failed)] << " failed), " << bytesStreamed / (1024 * 1024) << " MB streamed ("
+              << bytesUncompressed / (1024 * 1024) << " MB as RGBA8)" << std::endl;
+}
+
+void TextureStreamer::createImage(Texture &texture)
+{
+    std::set<uint32_t> uniqueQueueFamilyIndices(queueFamilyIndices.begin(), queueFamilyIndices.end());
+    std::vector<uint32_t> families(uniqueQueueFamilyIndices.begin(), uniqueQueueFamilyIndices.end());
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+
+    // Block compressed chains always come complete, they can't be written by the generator
+    texture.generateMips = mipGenerator && !TextureTranscoder::isBlockCompressed(texture.data.format);
+    texture.mipCount = texture.generateMips ? MipGenerator::getMipCount({texture.data.width, texture.data.height}) : texture.data.getMipCount();
+
+    imageInfo.extent = {texture.data.width, texture.data.height, 1};
+    imageInfo.mipLevels = texture.mipCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = texture.data.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (texture.generateMips)
+    {
+        imageInfo.usage |= mipGenerator->getImageUsage(imageInfo.format, imageInfo.mipLevels);
+        imageInfo.flags = mipGenerator->getImageFlags(imageInfo.format, imageInfo.mipLevels);
+    }
+
+    // Uploaded on the transfer queue, sampled on the graphics queue
+    if (families.size() > 1)
+    {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        imageInfo.pQueueFamilyIndices = families.data();
+    }
+    else
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &texture.image, &texture.allocation, nullptr) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image!");
+    }
+}
+
+uint32_t TextureStreamer::getDesiredMip(const Texture &texture) const
+{
+    uint32_t lastMip = texture.data.getMipCount() - 1;
+
+    if (texture.screenSize < 0.0f)
+        return 0;
+    if (texture.screenSize < 1.0f)
+        return lastMip;
+
+    // Level whose size is closest to the on screen size without going under it
+    float size = static_cast<float>(std::max(texture.data.width, texture.data.height));
+    float mip = std::floor(std::log2(std::max(size / texture.screenSize, 1.0f)));
+    return std::min(static_cast<uint32_t>(mip), lastMip);
+}
+
+// Stages the next rows of the level below the resident ones, returns the bytes staged,
+// 0 when the staging ring is full
+VkDeviceSize TextureStreamer::streamNextBand(TextureHandle handle)
+{
+    Texture &texture = *textures[handle];
+    uint32_t mip = texture.residentMip - 1;
+    const std::vector<uint8_t> &texels = texture.data.mips[mip];
+    uint32_t width = texture.data.getMipWidth(mip);
+    uint32_t height = texture.data.getMipHeight(mip);
+
+    // Block compressed levels are stored and copied in rows of 4x4 blocks
+    uint32_t blockHeight = TextureTranscoder::isBlockCompressed(texture.data.format) ? 4 : 1;
+    uint32_t blockRows = (height + blockHeight - 1) / blockHeight;
+    VkDeviceSize rowSize = texels.size() / blockRows;
+
+    // A quarter of the ring at most, like buffer uploads, so bands of a level larger than
+    // the ring fit while earlier ones are still in flight
+    uint32_t bandRows = static_cast<uint32_t>(std::max<VkDeviceSize>(uploadManager->getStagingSize() / 4 / rowSize, 1));
+    uint32_t firstRow = texture.stagedRows / blockHeight;
+    uint32_t rows = std::min(bandRows, blockRows - firstRow);
+    VkDeviceSize size = rows * rowSize;
+
+    VkDeviceSize offset;
+    if (!uploadManager->stage(texels.data() + firstRow * rowSize, size, offset))
+        return 0;
+
+    uint32_t y = firstRow * blockHeight;
+    uint32_t bandHeight = std::min(rows * blockHeight, height - y);
+    uploadManager->copyToImageRows(offset, texture.image, mip, y, {width, bandHeight, 1}, height);
+
+    texture.stagedRows = y + bandHeight;
+    bytesStreamed += size;
+
+    if (texture.stagedRows == height)
+    {
+        uploadManager->onComplete([this, handle, mip]() { onMipResident(handle, mip); });
+
+        texture.stagedRows = 0;
+        texture.uploading = true;
+        bytesUncompressed += static_cast<uint64_t>(width) * height * 4;
+    }
+
+    return size;
+}
+
+void TextureStreamer::onMipResident(TextureHandle handle, uint32_t mip)
+{
+    Texture &texture = *textures[handle];
+    texture.uploading = false;
+    texture.residentMip = mip;
+
+    // Recorded at the start of the next frame, before anything can sample the new view
+    if (texture.generateMips && texture.mipCount > 1)
+    {
+        MipTarget target = {texture.image, texture.data.format, {texture.data.width, texture.data.height}, texture.mipCount};
+        mipGenerator->request(target, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.data.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = mip;
+    viewInfo.subresourceRange.levelCount = texture.mipCount - mip;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    View &view = texture.view;
+
+    // Frames already recorded may still sample the previous view and heap slot
+    if (view.imageView != VK_NULL_HANDLE)
+        retired.push_back({view.imageView, frameNumber});
+
+    if (bindlessHeap)
+    {
+        if (view.bindlessIndex != BindlessHeap::invalidIndex)
+            bindlessHeap->releaseTexture(view.bindlessIndex, frameNumber);
+        view.bindlessIndex = bindlessHeap->addTexture(imageView, samplerCache->get(samplerInfo));
+    }
+
+    view.imageView = imageView;
+    view.sampler = samplerCache->get(samplerInfo);
+    view.residentMip = mip;
+    view.ready = true;
+
+    // Every level is on the GPU, the decoded texels aren't needed anymore
+    if (mip == 0)
+    {
+        texture.state = State::Resident;
+        texture.data.mips.clear();
+        texture.data.mips.shrink_to_fit();
+    }
+}
@@ -0,0 +1,267 @@
+#include "textureTranscoder.hpp"
+#include "blockEncoder.hpp"
+#include "imageLoader.hpp"
+#include "mappedFile.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    [[noreturn]] void fail(const std::string &path, const char *reason)
+    {
+        throw std::runtime_error("failed to load texture " + path + ", " + reason + "!");
+    }
+
+    bool hasExtension(const std::string &path, const char *extension)
+    {
+        size_t length = std::strlen(extension);
+        if (path.size() < length)
+            return false;
+
+        return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == b;
+        });
+    }
+
+    bool isBC(VkFormat format)
+    {
+        return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+
+    bool isETC2(VkFormat format)
+    {
+        return format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK;
+    }
+
+    // Bytes per 4x4 block, 4 for RGBA8 which is addressed per texel instead
+    uint32_t getBlockSize(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+        case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+            return 8;
+        default:
+            return TextureTranscoder::isBlockCompressed(format) ? 16 : 4;
+        }
+    }
+
+    size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+    {
+        if (!TextureTranscoder::isBlockCompressed(format))
+            return static_cast<size_t>(width) * height * 4;
+
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+    }
+
+    // KTX2 levels tagged UNORM hold linear data, the transcoded image has to stay linear too
+    VkFormat toUnorm(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        default:
+            return format;
+        }
+    }
+
+    uint32_t getFullMipCount(uint32_t width, uint32_t height)
+    {
+        uint32_t count = 1;
+        while (width > 1 || height > 1)
+        {
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            count++;
+        }
+        return count;
+    }
+
+    bool hasTransparency(const std::vector<uint8_t> &texels)
+    {
+        for (size_t i = 3; i < texels.size(); i += 4)
+            if (texels[i] != 255)
+                return true;
+        return false;
+    }
+
+    TextureData transcode(ImageData image, const TextureFormats &formats, bool cpuMips, bool srgb)
+    {
+        VkFormat format = hasTransparency(image.mips[0]) ? formats.alpha : formats.opaque;
+
+        TextureData texture;
+        texture.format = srgb ? format : toUnorm(format);
+        texture.width = image.width;
+        texture.height = image.height;
+
+        if (!TextureTranscoder::isBlockCompressed(format))
+        {
+            if (!cpuMips)
+                image.mips.resize(1);
+            else if (image.getMipCount() != getFullMipCount(image.width, image.height))
+                ImageLoader::generateMips(image);
+
+            texture.mips = std::move(image.mips);
+            return texture;
+        }
+
+        // Compressed levels can't be generated on the GPU, the whole chain is encoded here
+        if (image.getMipCount() != getFullMipCount(image.width, image.height))
+            ImageLoader::generateMips(image);
+
+        bool alpha = format == VK_FORMAT_BC3_SRGB_BLOCK;
+        for (uint32_t mip = 0; mip < image.getMipCount(); mip++)
+        {
+            texture.mips.push_back(BlockEncoder::encodeImage(image.mips[mip].data(), image.getMipWidth(mip), image.getMipHeight(mip), alpha));
+
+            // Encoded levels replace the RGBA8 ones, no need to hold on to both
+            std::vector<uint8_t>().swap(image.mips[mip]);
+        }
+
+        return texture;
+    }
+
+    uint32_t readU32(const uint8_t *data)
+    {
+        return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 |
+               static_cast<uint32_t>(data[3]) << 24;
+    }
+
+    uint64_t readU64(const uint8_t *data)
+    {
+        return static_cast<uint64_t>(readU32(data)) | static_cast<uint64_t>(readU32(data + 4)) << 32;
+    }
+
+    // 12 byte identifier, 9 header fields, the index and one 24 byte entry per level.
+    // Only 2D textures without layers, faces or supercompression are accepted.
+    TextureData loadKtx2(const std::string &path, const uint8_t *data, size_t size, const TextureFormats &formats, bool cpuMips)
+    {
+        static const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+        if (size < 80 || std::memcmp(data, identifier, sizeof(identifier)) != 0)
+            fail(path, "not a KTX2 file");
+
+        VkFormat format = static_cast<VkFormat>(readU32(data + 12));
+        uint32_t width = readU32(data + 20);
+        uint32_t height = readU32(data + 24);
+        uint32_t depth = readU32(data + 28);
+        uint32_t layerCount = readU32(data + 32);
+        uint32_t faceCount = readU32(data + 36);
+        uint32_t levelCount = std::max(readU32(data + 40), 1u); // 0 asks for mips to be generated
+        uint32_t supercompression = readU32(data + 44);
+
+        if (supercompression != 0)
+            fail(path, "supercompressed KTX2 is not supported");
+        if (format == VK_FORMAT_UNDEFINED)
+            fail(path, "KTX2 without a Vulkan format is not supported");
+        if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1)
+            fail(path, "only 2D KTX2 textures are supported");
+        if (levelCount > getFullMipCount(width, height) || size < 80 + static_cast<size_t>(levelCount) * 24)
+            fail(path, "malformed KTX2 level index");
+
+        bool rgba8 = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM;
+        if (!rgba8 && !formats.isSupported(format))
+            fail(path, "format is not supported by the device");
+
+        std::vector<std::vector<uint8_t>> levels;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            const uint8_t *entry = data + 80 + level * 24;
+            uint64_t offset = readU64(entry);
+            uint64_t length = readU64(entry + 8);
+
+            uint32_t levelWidth = std::max(width >> level, 1u);
+            uint32_t levelHeight = std::max(height >> level, 1u);
+            if (length != getLevelSize(format, levelWidth, levelHeight) || offset > size || length > size - offset)
+                fail(path, "truncated KTX2 level");
+
+            levels.emplace_back(data + offset, data + offset + length);
+        }
+
+        if (rgba8)
+        {
+            ImageData image;
+            image.width = width;
+            image.height = height;
+            image.mips = std::move(levels);
+            return transcode(std::move(image), formats, cpuMips, format == VK_FORMAT_R8G8B8A8_SRGB);
+        }
+
+        TextureData texture;
+        texture.format = format;
+        texture.width = width;
+        texture.height = height;
+        texture.mips = std::move(levels);
+        return texture;
+    }
+}
+
+TextureFormats TextureFormats::query(const DeviceProfile &profile, const VkPhysicalDeviceFeatures &enabledFeatures)
+{
+    const VkFormatFeatureFlags required =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+    TextureFormats formats;
+
+    for (int value = VK_FORMAT_BC1_RGB_UNORM_BLOCK; value <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK; value++)
+    {
+        VkFormat format = static_cast<VkFormat>(value);
+        if ((isBC(format) && !enabledFeatures.textureCompressionBC) || (isETC2(format) && !enabledFeatures.textureCompressionETC2))
+            continue;
+
+        VkFormatProperties properties = profile.getFormatProperties(format);
+        if ((properties.optimalTilingFeatures & required) == required)
+            formats.supported.push_back(format);
+    }
+
+    // The encoder only writes BC1 and BC3, ETC2 is only used for KTX2 files already in it
+    if (formats.isSupported(VK_FORMAT_BC1_RGB_SRGB_BLOCK) && formats.isSupported(VK_FORMAT_BC1_RGB_UNORM_BLOCK))
+        formats.opaque = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    if (formats.isSupported(VK_FORMAT_BC3_SRGB_BLOCK) && formats.isSupported(VK_FORMAT_BC3_UNORM_BLOCK))
+        formats.alpha = VK_FORMAT_BC3_SRGB_BLOCK;
+
+    return formats;
+}
+
+bool TextureFormats::isSupported(VkFormat format) const
+{
+    return std::find(supported.begin(), supported.end(), format) != supported.end();
+}
+
+bool TextureTranscoder::isBlockCompressed(VkFormat format)
+{
+    return isBC(format) || isETC2(format);
+}
+
+TextureData TextureTranscoder::load(const std::string &path, const TextureFormats &formats, bool cpuMips)
+{
+    if (hasExtension(path, ".ktx2"))
+    {
+        MappedFile file;
+        if (!file.open(path) || file.size() == 0)
+        {
+            fail(path, "can't open file");
+        }
+
+        return loadKtx2(path, static_cast<const uint8_t *>(file.data()), file.size(), formats, cpuMips);
+    }
+
+    return transcode(ImageLoader::load(path), formats, cpuMips, true);
+}
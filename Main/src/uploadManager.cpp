@@ -0,0 +1,278 @@
+#include "uploadManager.hpp"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void UploadManager::init(const UploadManagerCreateInfo &createInfo)
+{
+    device = createInfo.device;
+    allocator = createInfo.allocator;
+    transferQueue = createInfo.transferQueue;
+    stagingSize = createInfo.stagingSize;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = createInfo.transferFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    CreateBufferInfo bufferCreateInfo = {};
+    bufferCreateInfo.size = stagingSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.memoryUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    bufferCreateInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    bufferCreateInfo.pool = createInfo.stagingPool;
+
+    createBuffer(bufferCreateInfo, allocator, stagingBuffer.allocation, stagingBuffer.buffer);
+
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(allocator, stagingBuffer.allocation, &allocationInfo);
+    stagingData = static_cast<uint8_t *>(allocationInfo.pMappedData);
+}
+
+void UploadManager::cleanup()
+{
+    flush();
+
+    for (auto &batch : freeBatches)
+        vkDestroyFence(device, batch.fence, nullptr);
+    freeBatches.clear();
+
+    // Frees the command buffers with it
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    vmaDestroyBuffer(allocator, stagingBuffer.buffer, stagingBuffer.allocation);
+}
+
+bool UploadManager::stage(const void *data, VkDeviceSize size, VkDeviceSize &offset, VkDeviceSize alignment)
+{
+    if (size > stagingSize)
+    {
+        throw std::runtime_error("failed to stage upload, it is larger than the staging ring!");
+    }
+
+    // Nothing staged is in flight, start over at the beginning so a copy larger than half
+    // the ring doesn't keep landing across its end. Batches still pending hold no staging
+    // space then and ended where the ring did.
+    if (tail == head)
+    {
+        for (auto &batch : pendingBatches)
+            batch.ringEnd = 0;
+        head = 0;
+        tail = 0;
+    }
+
+    uint64_t position = (head + alignment - 1) / alignment * alignment;
+    offset = position % stagingSize;
+
+    // Never split a copy across the end of the ring, skip what is left of it instead
+    if (offset + size > stagingSize)
+    {
+        position += stagingSize - offset;
+        offset = 0;
+    }
+
+    if (position + size - tail > stagingSize)
+    {
+        stagingStalls++;
+        return false;
+    }
+
+    getRecordingBatch();
+
+    std::memcpy(stagingData + offset, data, static_cast<size_t>(size));
+    head = position + size;
+    bytesUploaded += size;
+    return true;
+}
+
+void UploadManager::copyToBuffer(VkDeviceSize stagingOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+
+    vkCmdCopyBuffer(getRecordingBatch().commandBuffer, stagingBuffer.buffer, dstBuffer, 1, &copyRegion);
+}
+
+void UploadManager::copyToImage(VkDeviceSize stagingOffset, VkImage dstImage, uint32_t mipLevel, VkExtent3D extent, VkImageAspectFlags aspect)
+{
+    copyToImageRows(stagingOffset, dstImage, mipLevel, 0, extent, extent.height, aspect);
+}
+
+void UploadManager::copyToImageRows(VkDeviceSize stagingOffset, VkImage dstImage, uint32_t mipLevel, uint32_t y, VkExtent3D extent, uint32_t levelHeight,
+                                    VkImageAspectFlags aspect)
+{
+    VkCommandBuffer commandBuffer = getRecordingBatch().commandBuffer;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dstImage;
+    barrier.subresourceRange.aspectMask = aspect;
+    barrier.subresourceRange.baseMipLevel = mipLevel;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    // Later bands are ordered after this transition by the queue, they are disjoint from the
+    // rows already written
+    if (y == 0)
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = stagingOffset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = aspect;
+    region.imageSubresource.mipLevel = mipLevel;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, static_cast<int32_t>(y), 0};
+    region.imageExtent = extent;
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    if (y + extent.height < levelHeight)
+        return;
+
+    // The graphics queue only samples the level after the batch fence signaled, so
+    // there is nothing to wait for on this queue besides the copy itself
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void UploadManager::onComplete(Callback callback)
+{
+    getRecordingBatch().callbacks.push_back(std::move(callback));
+}
+
+void UploadManager::submit()
+{
+    if (!recording)
+        return;
+
+    Batch &batch = recordingBatch;
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    if (vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+
+    batch.ringEnd = head;
+    pendingBatches.push_back(std::move(batch));
+    recordingBatch = {};
+    recording = false;
+    batchesSubmitted++;
+}
+
+void UploadManager::update()
+{
+    while (!pendingBatches.empty() && vkGetFenceStatus(device, pendingBatches.front().fence) == VK_SUCCESS)
+    {
+        Batch batch = std::move(pendingBatches.front());
+        pendingBatches.pop_front();
+        retire(batch);
+    }
+}
+
+void UploadManager::flush()
+{
+    submit();
+
+    while (!pendingBatches.empty())
+    {
+        Batch batch = std::move(pendingBatches.front());
+        pendingBatches.pop_front();
+
+        vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        retire(batch);
+    }
+}
+
+void UploadManager::printStatistics() const
+{
+    std::cerr << "Upload manager: " << bytesUploaded / (1024 * 1024) << " MB in " << batchesSubmitted << " batches, "
+              << stagingStalls << " staging stalls" << std::endl;
+}
+
+UploadManager::Batch &UploadManager::getRecordingBatch()
+{
+    if (recording)
+        return recordingBatch;
+
+    if (!freeBatches.empty())
+    {
+        recordingBatch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+
+        vkResetFences(device, 1, &recordingBatch.fence);
+        vkResetCommandBuffer(recordingBatch.commandBuffer, 0);
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &recordingBatch.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(device, &fenceInfo, nullptr, &recordingBatch.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(recordingBatch.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording upload command buffer!");
+    }
+
+    recording = true;
+    return recordingBatch;
+}
+
+void UploadManager::retire(Batch &batch)
+{
+    tail = batch.ringEnd;
+
+    for (auto &callback : batch.callbacks)
+        callback();
+    batch.callbacks.clear();
+
+    freeBatches.push_back(std::move(batch));
+}
@@ -0,0 +1,212 @@
+#include "queue_families.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+// solveQueueFamilies() against fixed tables of synthetic devices, no Vulkan device needed.
+// Returns non-zero when a check fails.
+
+namespace
+{
+    constexpr VkQueueFlags G = VK_QUEUE_GRAPHICS_BIT;
+    constexpr VkQueueFlags C = VK_QUEUE_COMPUTE_BIT;
+    constexpr VkQueueFlags T = VK_QUEUE_TRANSFER_BIT;
+
+    uint32_t failures = 0;
+
+    void check(bool condition, const std::string &name, const char *what)
+    {
+        if (condition)
+            return;
+
+        std::printf("FAILED %s: %s\n", name.c_str(), what);
+        failures++;
+    }
+
+    struct Expected
+    {
+        uint32_t graphics, compute, transfer, present;
+    };
+
+    // Queues handed to the roles exist and no two roles share one, except present on the graphics queue
+    bool queuesValid(const std::vector<QueueFamilyInfo> &table, const QueueFamilyIndices &indices)
+    {
+        const __QueueFamilies_Impl::QueueFamilyIndex *roles[] = {&*indices.graphicsFamily, &*indices.computeFamily, &*indices.transferFamily, &*indices.presentFamily};
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (roles[i]->family >= table.size() || roles[i]->queueIndex >= table[roles[i]->family].queueCount)
+                return false;
+
+            for (uint32_t j = 0; j < i; j++)
+            {
+                bool sameQueue = roles[i]->family == roles[j]->family && roles[i]->queueIndex == roles[j]->queueIndex;
+                if (sameQueue && !(i == 3 && j == 0))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    void expectSolved(const std::string &name, const std::vector<QueueFamilyInfo> &table, Expected expected)
+    {
+        QueueFamilyIndices indices = solveQueueFamilies(table);
+        check(indices.isComplete(), name, "incomplete");
+        if (!indices.isComplete())
+            return;
+
+        check(indices.graphicsFamily->family == expected.graphics, name, "graphics family");
+        check(indices.computeFamily->family == expected.compute, name, "compute family");
+        check(indices.transferFamily->family == expected.transfer, name, "transfer family");
+        check(indices.presentFamily->family == expected.present, name, "present family");
+        check(queuesValid(table, indices), name, "queue indices");
+    }
+
+    void expectUnsolved(const std::string &name, const std::vector<QueueFamilyInfo> &table)
+    {
+        check(!solveQueueFamilies(table).isComplete(), name, "solved a table without a solution");
+    }
+
+    // Every assignment in preference order, the first one that fits
+    bool bruteForce(const std::vector<QueueFamilyInfo> &table, Expected &result)
+    {
+        auto serves = [&](uint32_t family, uint32_t role)
+        {
+            const VkQueueFlags flags[] = {G, C, T};
+            return role < 3 ? (table[family].queueFlags & flags[role]) != 0 : table[family].presentSupport;
+        };
+
+        std::vector<uint32_t> candidates[4];
+        for (uint32_t role = 0; role < 4; role++)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> ranked;
+            for (uint32_t family = 0; family < table.size(); family++)
+            {
+                if (!serves(family, role))
+                    continue;
+
+                uint32_t others = 0;
+                for (uint32_t other = 0; other < 4; other++)
+                    others += other != role && serves(family, other);
+                ranked.push_back({others, family});
+            }
+
+            std::sort(ranked.begin(), ranked.end());
+            for (const auto &candidate : ranked)
+                candidates[role].push_back(candidate.second);
+        }
+
+        for (uint32_t graphics : candidates[0])
+            for (uint32_t compute : candidates[1])
+                for (uint32_t transfer : candidates[2])
+                {
+                    std::vector<uint32_t> present;
+                    if (serves(graphics, 3))
+                        present.push_back(graphics);
+                    for (uint32_t family : candidates[3])
+                    {
+                        if (!serves(graphics, 3) || family != graphics)
+                            present.push_back(family);
+                    }
+
+                    for (uint32_t family : present)
+                    {
+                        std::map<uint32_t, uint32_t> used;
+                        used[graphics]++;
+                        used[compute]++;
+                        used[transfer]++;
+                        if (family != graphics)
+                            used[family]++;
+
+                        bool fits = std::all_of(used.begin(), used.end(), [&](const std::pair<const uint32_t, uint32_t> &entry)
+                                                { return entry.second <= table[entry.first].queueCount; });
+                        if (fits)
+                        {
+                            result = {graphics, compute, transfer, family};
+                            return true;
+                        }
+                    }
+                }
+
+        return false;
+    }
+
+    void crossCheck(uint32_t tableCount, uint32_t maxFamilies)
+    {
+        std::mt19937 random(7);
+        uint32_t mismatches = 0;
+
+        for (uint32_t i = 0; i < tableCount; i++)
+        {
+            std::vector<QueueFamilyInfo> table(1 + random() % maxFamilies);
+            for (auto &family : table)
+                family = {static_cast<VkQueueFlags>(random() % 8), static_cast<uint32_t>(random() % 4), random() % 3 == 0};
+
+            Expected expected = {};
+            bool solvable = bruteForce(table, expected);
+            QueueFamilyIndices indices = solveQueueFamilies(table);
+
+            bool same = indices.isComplete() == solvable;
+            if (same && solvable)
+            {
+                same = indices.graphicsFamily->family == expected.graphics && indices.computeFamily->family == expected.compute &&
+                       indices.transferFamily->family == expected.transfer && indices.presentFamily->family == expected.present &&
+                       queuesValid(table, indices);
+            }
+
+            mismatches += !same;
+        }
+
+        check(mismatches == 0, "brute force cross-check", "solver and brute force disagree");
+    }
+
+    // Tables without a solution where every graphics family looks alike, the search has to
+    // stay linear in the family count
+    void expectBounded(const std::string &name, uint32_t familyCount, uint32_t presentQueues)
+    {
+        std::vector<QueueFamilyInfo> table(familyCount, {G | T, 1, false});
+        table[0] = {C | T, presentQueues, true};
+
+        QueueFamilySolveStats stats = {};
+        check(!solveQueueFamilies(table, &stats).isComplete(), name, "solved a table without a solution");
+        check(stats.visited <= 4 * familyCount, name, "search not bounded");
+    }
+}
+
+int main()
+{
+    expectUnsolved("single family, one queue", {{G | C | T, 1, true}});
+    expectSolved("single family, three queues", {{G | C | T, 3, true}}, {0, 0, 0, 0});
+
+    // Typical discrete layout, dedicated compute and transfer families
+    expectSolved("separate compute and transfer", {{G | C | T, 16, true}, {T, 2, false}, {C | T, 8, false}}, {0, 2, 1, 0});
+
+    expectSolved("present only on a non-graphics family", {{G | C | T, 3, false}, {0, 1, true}}, {0, 0, 0, 1});
+    expectSolved("present on the async compute family", {{G | T, 2, false}, {C | T, 2, true}}, {0, 1, 0, 1});
+
+    // Exhausted families push roles to the next candidate or leave them without a queue
+    expectUnsolved("queue count exhausted", {{G | C | T, 2, true}});
+    expectSolved("queue count exhausted, transfer moves", {{G | C | T, 2, true}, {G | T, 1, false}}, {0, 0, 1, 0});
+    expectUnsolved("present family without queues", {{G | C | T, 3, false}, {0, 0, true}});
+
+    expectUnsolved("no present family", {{G | C | T, 4, false}, {T, 1, false}});
+    expectUnsolved("no compute family", {{G | T, 4, true}});
+    expectUnsolved("empty table", {});
+
+    crossCheck(100000, 6);
+
+    expectBounded("single compute family, 1024 families", 1024, 1);
+    expectBounded("present family without queues, 1024 families", 1024, 0);
+
+    if (failures > 0)
+    {
+        std::printf("%u checks failed\n", failures);
+        return 1;
+    }
+
+    std::printf("Queue family tests passed\n");
+    return 0;
+}
@@ -5,6 +5,11 @@
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
+newoption {
+    trigger = "embed-shaders",
+    description = "Compile the SPIR-V into the Main executable instead of loading shaders/*.spv at runtime"
+}
+
 workspace "VulkanWorkspace"
 
     -- toolset "clang"
@@ -41,7 +46,7 @@ workspace "VulkanWorkspace"
         objdir ("build/obj/" .. outputdir )
         debugdir ("build/bin/" .. outputdir)
 
-        files { "Main/include/**.hpp", "Main/src/**.cpp", "Main/shaders/**.vert", "Main/shaders/**.frag" }
+        files { "Main/include/**.hpp", "Main/src/**.cpp", "Main/shaders/**.vert", "Main/shaders/**.frag", "Main/shaders/**.comp" }
         includedirs {
             "Main/include",
             "Engine/include",
@@ -49,12 +54,38 @@ workspace "VulkanWorkspace"
             "Engine/vendor/glfw/include",
             "Engine/vendor/glm/include",
             "Engine/vendor/vulkan_memory_allocator/include",
+            "Engine/vendor/stb", -- optional, ImageLoader falls back to PPM/TGA without stb_image.h
         }
         flags { "FatalWarnings" }
         warnings "Extra"
         links { "Engine", "GLFW", "VulkanMemoryAllocator" }
         libdirs { VULKAN_SDK_LIB }
 
+        if _OPTIONS["embed-shaders"] then
+            -- glslc -mfmt=c writes every module as a C initializer list, the generated
+            -- embeddedShaderList.inc ties them to the paths ShaderStore is asked for
+            local embedDir = "build/embedded_shaders"
+            local commands = { "mkdir -p %{wks.location}/" .. embedDir }
+            local arrays = ""
+            local entries = ""
+
+            for i, shader in ipairs(os.matchfiles("Main/shaders/*")) do
+                local name = path.getname(shader)
+                if path.hasextension(shader, { ".vert", ".frag", ".comp" }) then
+                    table.insert(commands, GLSLC .. " -mfmt=c -o %{wks.location}/" .. embedDir .. "/" .. name .. ".inc %{wks.location}/" .. shader)
+                    arrays = arrays .. "const uint32_t shader" .. i .. "[] =\n#include \"" .. name .. ".inc\"\n;\n"
+                    entries = entries .. "    {\"shaders/" .. name .. ".spv\", shader" .. i .. ", sizeof(shader" .. i .. ")},\n"
+                end
+            end
+
+            os.mkdir(embedDir)
+            io.writefile(embedDir .. "/embeddedShaderList.inc", arrays .. "\nconst EmbeddedShader embeddedShaders[] = {\n" .. entries .. "};\n")
+
+            defines { "EMBED_SHADERS" }
+            includedirs { embedDir }
+            prebuildcommands(commands)
+        end
+
         filter "files:**.vert"
             buildcommands {
                 "mkdir -p %{cfg.targetdir}/shaders",
@@ -69,8 +100,15 @@ workspace "VulkanWorkspace"
             }
             buildoutputs { "%{cfg.targetdir}/shaders/%{file.basename}.frag.spv" }
 
+        filter "files:**.comp"
+            buildcommands {
+                "mkdir -p %{cfg.targetdir}/shaders",
+                GLSLC .. " -o %{cfg.targetdir}/shaders/%{file.basename}.comp.spv %{file.relpath}"
+            }
+            buildoutputs { "%{cfg.targetdir}/shaders/%{file.basename}.comp.spv" }
+
         filter "system:linux"
-            links { "vulkan" }
+            links { "vulkan", "pthread" }
 
         filter "system:windows"
             links { "vulkan-1" }
@@ -127,6 +165,61 @@ workspace "VulkanWorkspace"
             }
             buildoutputs { "%{cfg.targetdir}/shaders/%{file.basename}.frag.spv" }
 
+    -- Solver tests and benchmarks build the sources under test on their own, no window or device
+    project "Tests"
+        kind "ConsoleApp"
+        location "Tests"
+        language "C++"
+        cppdialect "C++17"
+        targetdir ("build/bin/" .. outputdir )
+        objdir ("build/obj/" .. outputdir )
+
+        files { "Tests/src/**.cpp", "Main/src/queue_families.cpp" }
+        includedirs {
+            "Main/include",
+            "Engine/include",
+            VULKAN_SDK_INCLUDE,
+            "Engine/vendor/glfw/include",
+            "Engine/vendor/glm/include",
+            "Engine/vendor/vulkan_memory_allocator/include",
+        }
+        flags { "FatalWarnings" }
+        warnings "Extra"
+        libdirs { VULKAN_SDK_LIB }
+
+        filter "system:linux"
+            links { "vulkan" }
+
+        filter "system:windows"
+            links { "vulkan-1" }
+
+    project "Benchmarks"
+        kind "ConsoleApp"
+        location "Benchmarks"
+        language "C++"
+        cppdialect "C++17"
+        targetdir ("build/bin/" .. outputdir )
+        objdir ("build/obj/" .. outputdir )
+
+        files { "Benchmarks/src/**.cpp", "Main/src/queue_families.cpp" }
+        includedirs {
+            "Main/include",
+            "Engine/include",
+            VULKAN_SDK_INCLUDE,
+            "Engine/vendor/glfw/include",
+            "Engine/vendor/glm/include",
+            "Engine/vendor/vulkan_memory_allocator/include",
+        }
+        flags { "FatalWarnings" }
+        warnings "Extra"
+        libdirs { VULKAN_SDK_LIB }
+
+        filter "system:linux"
+            links { "vulkan" }
+
+        filter "system:windows"
+            links { "vulkan-1" }
+
 
 
 